@@ -0,0 +1,55 @@
+#-------------------------------------------------
+#
+# Sources shared by the application and the benchmark
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT += opengl
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+#QMAKE_CXXFLAGS_WARN_ON += -Wno-reorder
+
+
+SOURCES += mainwindow.cpp \
+    unitsphere.cpp \
+    unitcube.cpp \
+    unitplane.cpp \
+    objloader.cpp \
+    frustumculler.cpp \
+    renderqueue.cpp \
+    shadowatlas.cpp \
+    planarpatch.cpp \
+    headlessrenderer.cpp \
+    profiler.cpp \
+    framescheduler.cpp \
+    commandqueue.cpp \
+    renderthread.cpp \
+    meshloader.cpp \
+    texturestreamer.cpp \
+    renderer.cpp
+
+HEADERS  += mainwindow.h \
+    unitsphere.h \
+    unitcube.h \
+    unitplane.h \
+    cyTriMesh.h \
+    cyPoint.h \
+    objloader.h \
+    frustumculler.h \
+    renderqueue.h \
+    shadowatlas.h \
+    planarpatch.h \
+    headlessrenderer.h \
+    profiler.h \
+    framescheduler.h \
+    commandqueue.h \
+    renderthread.h \
+    meshloader.h \
+    texturestreamer.h \
+    renderer.h
+
+RESOURCES += \
+    shaders.qrc \
+    textures.qrc \
+    models.qrc
@@ -4,34 +4,9 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
-QT += opengl
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
 TARGET = ShadowTechniques
 TEMPLATE = app
 
-#QMAKE_CXXFLAGS_WARN_ON += -Wno-reorder
-
-
-SOURCES += main.cpp\
-        mainwindow.cpp \
-    unitsphere.cpp \
-    unitcube.cpp \
-    unitplane.cpp \
-    objloader.cpp \
-    renderer.cpp
-
-HEADERS  += mainwindow.h \
-    unitsphere.h \
-    unitcube.h \
-    unitplane.h \
-    cyTriMesh.h \
-    cyPoint.h \
-    objloader.h \
-    renderer.h
+include(ShadowTechniques.pri)
 
-RESOURCES += \
-    shaders.qrc \
-    textures.qrc \
-    models.qrc
+SOURCES += main.cpp
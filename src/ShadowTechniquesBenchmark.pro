@@ -0,0 +1,15 @@
+#-------------------------------------------------
+#
+# Offscreen benchmark of the shadow methods
+#
+#-------------------------------------------------
+
+TARGET = ShadowTechniquesBenchmark
+TEMPLATE = app
+
+include(ShadowTechniques.pri)
+
+SOURCES += benchmarkmain.cpp \
+    benchmark.cpp
+
+HEADERS += benchmark.h
@@ -0,0 +1,338 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "benchmark.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------------------
+const char* shadowModeNames[NUM_SHADOW_METHODS] =
+{
+    "none", "projective", "shadowmap", "shadowvolume"
+};
+
+const char* shadingModeNames[PHONG_SHADING + 1] =
+{
+    "gouraud", "phong"
+};
+
+const char* metricNames[NUM_BENCHMARK_METRICS] =
+{
+    "cpu_frame_ms",
+    "gpu_shadow_pass_ms",
+    "gpu_main_pass_ms",
+    "gpu_stencil_pass_ms",
+    "gpu_frame_ms"
+};
+
+// the statistics are the mean and these percentiles, 0 and 100 being the min and the max
+const char* statisticNames[NUM_BENCHMARK_STATISTICS] =
+{
+    "mean", "min", "p50", "p90", "p95", "p99", "max"
+};
+
+const double statisticPercentiles[NUM_BENCHMARK_STATISTICS] =
+{
+    -1.0, 0.0, 50.0, 90.0, 95.0, 99.0, 100.0
+};
+
+//------------------------------------------------------------------------------------------
+Benchmark::Benchmark():
+    frameSize(1600, 1200),
+    numWarmupFrames(30),
+    numFrames(300),
+    meshObject(TEAPOT_OBJ),
+    outputBaseName("benchmark")
+{
+}
+
+//------------------------------------------------------------------------------------------
+bool Benchmark::parseArguments(const QStringList& _arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times every shadow method along a scripted path.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH", "1600x1200");
+    QCommandLineOption framesOption("frames", "Measured frames per configuration.", "count",
+                                    "300");
+    QCommandLineOption warmupOption("warmup", "Unmeasured frames per configuration.",
+                                    "count", "30");
+    QCommandLineOption meshOption("mesh", "Mesh object index, 0 is the teapot.", "index",
+                                  "0");
+    QCommandLineOption outputOption("output", "Base name of the .csv and .json results.",
+                                    "name", "benchmark");
+
+    parser.addOption(sizeOption);
+    parser.addOption(framesOption);
+    parser.addOption(warmupOption);
+    parser.addOption(meshOption);
+    parser.addOption(outputOption);
+
+    if(!parser.parse(_arguments))
+    {
+        PRINT_ERROR(parser.errorText());
+        return false;
+    }
+
+    if(parser.isSet("help"))
+    {
+        qInfo().noquote() << parser.helpText();
+        return false;
+    }
+
+    QStringList size = parser.value(sizeOption).split('x');
+
+    if(size.size() != 2 || size.at(0).toInt() <= 0 || size.at(1).toInt() <= 0)
+    {
+        PRINT_ERROR("Invalid frame size " + parser.value(sizeOption));
+        return false;
+    }
+
+    frameSize = QSize(size.at(0).toInt(), size.at(1).toInt());
+    numFrames = qMax(parser.value(framesOption).toInt(), 1);
+    numWarmupFrames = qMax(parser.value(warmupOption).toInt(), 0);
+    meshObject = qBound(0, parser.value(meshOption).toInt(), NUM_MESH_OBJECT - 1);
+    outputBaseName = parser.value(outputOption);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Benchmark::run()
+{
+    headlessRenderer.setFrameSize(frameSize);
+
+    if(!headlessRenderer.initialize())
+    {
+        return false;
+    }
+
+    Renderer* renderer = headlessRenderer.getRenderer();
+    renderer->setMeshObject(meshObject);
+    renderer->enableGPUTimers(true);
+
+    glRendererName = QString((const char*)QOpenGLContext::currentContext()->functions()->
+                             glGetString(GL_RENDERER));
+
+    configurations.clear();
+
+    /////////////////////////////////////////////////////////////////
+    // the scene shading programs, the others only serve internal passes
+    for(int i = 0; i < NUM_SHADOW_METHODS; ++i)
+    {
+        for(int j = GOURAUD_SHADING; j <= PHONG_SHADING; ++j)
+        {
+            Configuration configuration;
+            configuration.shadowMode = static_cast<ShadowModes>(i);
+            configuration.shadingMode = static_cast<ShadingProgram>(j);
+
+            runConfiguration(configuration);
+            configurations.append(configuration);
+
+            qInfo() << shadowModeNames[i] << shadingModeNames[j] << "done";
+        }
+    }
+
+    return writeCSV(outputBaseName + ".csv") && writeJSON(outputBaseName + ".json");
+}
+
+//------------------------------------------------------------------------------------------
+// _t in [0, 1) runs once along the path: the camera orbits the room, the light circles
+// above it and the occluder circles below the light, so the shadows sweep over the room
+//------------------------------------------------------------------------------------------
+void Benchmark::setScenePath(float _t)
+{
+    Renderer* renderer = headlessRenderer.getRenderer();
+    float angle = 360.0f * _t;
+    float phase = 2.0f * M_PI * _t;
+
+    QMatrix4x4 cameraMatrix;
+    cameraMatrix.translate(DEFAULT_CAMERA_FOCUS);
+    cameraMatrix.rotate(angle, 0.0f, 1.0f, 0.0f);
+    cameraMatrix.translate(-DEFAULT_CAMERA_FOCUS);
+    renderer->setCamera(cameraMatrix * DEFAULT_CAMERA_POSITION, DEFAULT_CAMERA_FOCUS);
+
+    QMatrix4x4 lightMatrix;
+    lightMatrix.rotate(-angle, 0.0f, 1.0f, 0.0f);
+    QVector3D lightPosition = lightMatrix * QVector3D(DEFAULT_LIGHT_POSITION);
+    lightPosition.setY(lightPosition.y() + 2.0f * sin(phase));
+    renderer->setLightPosition(lightPosition);
+
+    renderer->setOccluderPosition(DEFAULT_OCCLUDER_POSITION +
+                                  QVector3D(3.0f * cos(phase), 0.0f, 3.0f * sin(phase)));
+}
+
+//------------------------------------------------------------------------------------------
+void Benchmark::runConfiguration(Configuration& _configuration)
+{
+    Renderer* renderer = headlessRenderer.getRenderer();
+    renderer->setShadowMethod(_configuration.shadowMode);
+    renderer->setShadingMode(_configuration.shadingMode);
+
+    setScenePath(0.0f);
+
+    for(int i = 0; i < numWarmupFrames; ++i)
+    {
+        headlessRenderer.renderFrame();
+    }
+
+    QElapsedTimer timer;
+
+    for(int i = 0; i < numFrames; ++i)
+    {
+        setScenePath((float)i / (float)numFrames);
+
+        timer.start();
+        headlessRenderer.renderFrame();
+        double frameTime = timer.nsecsElapsed() * 1e-6;
+
+        double passTimes[NUM_TIMED_PASSES];
+        renderer->getGPUPassTimes(passTimes);
+
+        _configuration.samples[METRIC_CPU_FRAME].append(frameTime);
+        _configuration.samples[METRIC_GPU_SHADOW_PASS].append(passTimes[TIMED_SHADOW_PASS]);
+        _configuration.samples[METRIC_GPU_MAIN_PASS].append(passTimes[TIMED_MAIN_PASS]);
+        _configuration.samples[METRIC_GPU_STENCIL_PASS].append(passTimes[TIMED_STENCIL_PASS]);
+        _configuration.samples[METRIC_GPU_FRAME].append(passTimes[TIMED_SHADOW_PASS] +
+                                                        passTimes[TIMED_MAIN_PASS] +
+                                                        passTimes[TIMED_STENCIL_PASS]);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// the percentiles are nearest rank
+//------------------------------------------------------------------------------------------
+void Benchmark::computeStatistics(const QVector<double>& _samples, double* _statistics)
+{
+    QVector<double> sortedSamples = _samples;
+    std::sort(sortedSamples.begin(), sortedSamples.end());
+
+    double sum = 0.0;
+
+    for(int i = 0; i < sortedSamples.size(); ++i)
+    {
+        sum += sortedSamples.at(i);
+    }
+
+    for(int i = 0; i < NUM_BENCHMARK_STATISTICS; ++i)
+    {
+        if(sortedSamples.isEmpty())
+        {
+            _statistics[i] = 0.0;
+        }
+        else if(statisticPercentiles[i] < 0.0)
+        {
+            _statistics[i] = sum / sortedSamples.size();
+        }
+        else
+        {
+            int rank = (int)ceil(statisticPercentiles[i] / 100.0 * sortedSamples.size());
+            _statistics[i] = sortedSamples.at(qBound(0, rank - 1, sortedSamples.size() - 1));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------
+bool Benchmark::writeCSV(const QString& _fileName)
+{
+    QFile file(_fileName);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        PRINT_ERROR("Cannot write " + _fileName);
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "shadow,shading,metric,frames";
+
+    for(int i = 0; i < NUM_BENCHMARK_STATISTICS; ++i)
+    {
+        stream << "," << statisticNames[i];
+    }
+
+    stream << "\n";
+
+    for(int i = 0; i < configurations.size(); ++i)
+    {
+        const Configuration& configuration = configurations.at(i);
+
+        for(int j = 0; j < NUM_BENCHMARK_METRICS; ++j)
+        {
+            double statistics[NUM_BENCHMARK_STATISTICS];
+            computeStatistics(configuration.samples[j], statistics);
+
+            stream << shadowModeNames[configuration.shadowMode] << ","
+                   << shadingModeNames[configuration.shadingMode] << ","
+                   << metricNames[j] << "," << configuration.samples[j].size();
+
+            for(int k = 0; k < NUM_BENCHMARK_STATISTICS; ++k)
+            {
+                stream << "," << statistics[k];
+            }
+
+            stream << "\n";
+        }
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Benchmark::writeJSON(const QString& _fileName)
+{
+    QJsonArray configurationArray;
+
+    for(int i = 0; i < configurations.size(); ++i)
+    {
+        const Configuration& configuration = configurations.at(i);
+        QJsonObject metrics;
+
+        for(int j = 0; j < NUM_BENCHMARK_METRICS; ++j)
+        {
+            double statistics[NUM_BENCHMARK_STATISTICS];
+            computeStatistics(configuration.samples[j], statistics);
+
+            QJsonObject statisticsObject;
+
+            for(int k = 0; k < NUM_BENCHMARK_STATISTICS; ++k)
+            {
+                statisticsObject[statisticNames[k]] = statistics[k];
+            }
+
+            metrics[metricNames[j]] = statisticsObject;
+        }
+
+        QJsonObject configurationObject;
+        configurationObject["shadow"] = shadowModeNames[configuration.shadowMode];
+        configurationObject["shading"] = shadingModeNames[configuration.shadingMode];
+        configurationObject["metrics"] = metrics;
+        configurationArray.append(configurationObject);
+    }
+
+    QJsonObject root;
+    root["renderer"] = glRendererName;
+    root["width"] = frameSize.width();
+    root["height"] = frameSize.height();
+    root["frames"] = numFrames;
+    root["warmupFrames"] = numWarmupFrames;
+    root["configurations"] = configurationArray;
+
+    QFile file(_fileName);
+
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        PRINT_ERROR("Cannot write " + _fileName);
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson());
+
+    return true;
+}
@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QtCore>
+
+#include "headlessrenderer.h"
+
+//------------------------------------------------------------------------------------------
+enum BenchmarkMetric
+{
+    METRIC_CPU_FRAME = 0,
+    METRIC_GPU_SHADOW_PASS,
+    METRIC_GPU_MAIN_PASS,
+    METRIC_GPU_STENCIL_PASS,
+    METRIC_GPU_FRAME,
+    NUM_BENCHMARK_METRICS
+};
+
+#define NUM_BENCHMARK_STATISTICS 7
+
+//------------------------------------------------------------------------------------------
+// Plays the same camera, light and occluder path through every shadow method and shading
+// program with the headless renderer. The CPU time of each frame and the GPU time of each
+// pass are written, as percentiles over the path, to a CSV and a JSON file.
+//------------------------------------------------------------------------------------------
+class Benchmark
+{
+public:
+    Benchmark();
+
+    bool parseArguments(const QStringList& _arguments);
+    bool run();
+
+private:
+    struct Configuration
+    {
+        ShadowModes shadowMode;
+        ShadingProgram shadingMode;
+        QVector<double> samples[NUM_BENCHMARK_METRICS];
+    };
+
+    void setScenePath(float _t);
+    void runConfiguration(Configuration& _configuration);
+    void computeStatistics(const QVector<double>& _samples, double* _statistics);
+    bool writeCSV(const QString& _fileName);
+    bool writeJSON(const QString& _fileName);
+
+    HeadlessRenderer headlessRenderer;
+    QSize frameSize;
+    int numWarmupFrames;
+    int numFrames;
+    int meshObject;
+    QString outputBaseName;
+    QString glRendererName;
+    QVector<Configuration> configurations;
+};
+
+#endif // BENCHMARK_H
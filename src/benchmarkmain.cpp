@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------------------
+// benchmarkmain.cpp
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include <QApplication>
+#include <QSurfaceFormat>
+
+#include "benchmark.h"
+
+int main(int argc, char *argv[])
+{
+    // the benchmark never opens a window
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication a(argc, argv);
+
+    QSurfaceFormat format;
+    format.setVersion(4, 0);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    Benchmark benchmark;
+
+    if(!benchmark.parseArguments(a.arguments()) || !benchmark.run())
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "commandqueue.h"
+
+//------------------------------------------------------------------------------------------
+CommandQueue::CommandQueue():
+    postedCommands(NULL)
+{
+}
+
+//------------------------------------------------------------------------------------------
+CommandQueue::~CommandQueue()
+{
+    CommandNode* node = postedCommands.fetchAndStoreAcquire(NULL);
+
+    while(node)
+    {
+        CommandNode* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void CommandQueue::post(const Command& _command)
+{
+    CommandNode* node = new CommandNode;
+    node->command = _command;
+
+    do
+    {
+        node->next = postedCommands.loadAcquire();
+    }
+    while(!postedCommands.testAndSetRelease(node->next, node));
+}
+
+//------------------------------------------------------------------------------------------
+// the list is newest first, it is reversed to run the commands in posting order
+//------------------------------------------------------------------------------------------
+int CommandQueue::execute()
+{
+    CommandNode* node = postedCommands.fetchAndStoreAcquire(NULL);
+    CommandNode* reversed = NULL;
+
+    while(node)
+    {
+        CommandNode* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    int numCommands = 0;
+
+    while(reversed)
+    {
+        CommandNode* next = reversed->next;
+        reversed->command();
+        delete reversed;
+        reversed = next;
+        ++numCommands;
+    }
+
+    return numCommands;
+}
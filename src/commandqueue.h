@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <functional>
+#include <QAtomicPointer>
+
+//------------------------------------------------------------------------------------------
+// Lock-free queue of commands posted from any thread and executed in posting order by
+// the one thread that drains it. A post pushes a node onto an atomic list, the drain takes
+// the whole list at once and reverses it, so neither side ever waits for the other.
+//------------------------------------------------------------------------------------------
+class CommandQueue
+{
+public:
+    typedef std::function<void()> Command;
+
+    CommandQueue();
+    ~CommandQueue();
+
+    void post(const Command& _command);
+    int execute();
+
+private:
+    struct CommandNode
+    {
+        Command command;
+        CommandNode* next;
+    };
+
+    QAtomicPointer<CommandNode> postedCommands;
+};
+
+#endif // COMMANDQUEUE_H
@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "framescheduler.h"
+
+#include <QApplication>
+
+//------------------------------------------------------------------------------------------
+FrameScheduler::FrameScheduler(Renderer* _renderer, QObject* _parent):
+    QObject(_parent),
+    renderer(_renderer),
+    currentMode(ON_DEMAND_RENDERING),
+    frameCap(DEFAULT_FRAME_CAP)
+{
+    capTimer.setSingleShot(true);
+    connect(&capTimer, &QTimer::timeout, this, &FrameScheduler::renderFrame);
+    connect(renderer, &QOpenGLWidget::frameSwapped, this,
+            &FrameScheduler::frameSwapped);
+    connect(renderer, &Renderer::redrawRequested, this, &FrameScheduler::requestFrame);
+
+    // any input may change the scene, also through the widgets of the main window
+    qApp->installEventFilter(this);
+
+    frameTimer.start();
+    requestFrame();
+}
+
+//------------------------------------------------------------------------------------------
+SchedulingMode FrameScheduler::getMode()
+{
+    return currentMode;
+}
+
+//------------------------------------------------------------------------------------------
+int FrameScheduler::getFrameCap()
+{
+    return frameCap;
+}
+
+//------------------------------------------------------------------------------------------
+void FrameScheduler::setMode(SchedulingMode _mode)
+{
+    currentMode = _mode;
+    requestFrame();
+}
+
+//------------------------------------------------------------------------------------------
+void FrameScheduler::setFrameCap(int _maxFPS)
+{
+    frameCap = qMax(_maxFPS, 0);
+
+    // a running delay was computed with the old cap
+    if(capTimer.isActive())
+    {
+        capTimer.stop();
+        scheduleFrame();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// the renderer merges the requests until the frame is drawn, only a capped frame waits
+//------------------------------------------------------------------------------------------
+void FrameScheduler::requestFrame()
+{
+    if(!capTimer.isActive())
+    {
+        scheduleFrame();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+bool FrameScheduler::eventFilter(QObject* _object, QEvent* _event)
+{
+    switch(_event->type())
+    {
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::Wheel:
+        requestFrame();
+        break;
+
+    case QEvent::MouseMove:
+        if(static_cast<QMouseEvent*>(_event)->buttons() != Qt::NoButton)
+        {
+            requestFrame();
+        }
+
+        break;
+
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(_object, _event);
+}
+
+//------------------------------------------------------------------------------------------
+// the frame was also swapped when the renderer updated itself, e.g. on a mouse move
+//------------------------------------------------------------------------------------------
+void FrameScheduler::frameSwapped()
+{
+    if(currentMode == CONTINUOUS_RENDERING || renderer->isAnimating())
+    {
+        scheduleFrame();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void FrameScheduler::renderFrame()
+{
+    frameTimer.restart();
+    renderer->requestFrame();
+}
+
+//------------------------------------------------------------------------------------------
+void FrameScheduler::scheduleFrame()
+{
+    if(frameCap > 0)
+    {
+        qint64 frameInterval = 1000 / frameCap;
+        qint64 remainingTime = frameInterval - frameTimer.elapsed();
+
+        if(remainingTime > 0)
+        {
+            capTimer.start(static_cast<int>(remainingTime));
+            return;
+        }
+    }
+
+    renderFrame();
+}
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "renderer.h"
+
+#define DEFAULT_FRAME_CAP 0
+
+enum SchedulingMode
+{
+    CONTINUOUS_RENDERING = 0,
+    ON_DEMAND_RENDERING,
+    NUM_SCHEDULING_MODES
+};
+
+//------------------------------------------------------------------------------------------
+// Paces the frames of the renderer by its frameSwapped() signal instead of a fixed timer,
+// so the frame rate follows the vsync of the swap. A frame cap above zero delays the next
+// frame until 1/cap seconds after the last one started.
+//
+// In the on-demand mode a frame is only rendered while the renderer is animating or
+// after user input, so an idle scene costs neither CPU nor GPU time.
+//------------------------------------------------------------------------------------------
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    FrameScheduler(Renderer* _renderer, QObject* _parent = 0);
+
+    SchedulingMode getMode();
+    int getFrameCap();
+
+public slots:
+    void setMode(SchedulingMode _mode);
+    void setFrameCap(int _maxFPS);
+    void requestFrame();
+
+protected:
+    bool eventFilter(QObject* _object, QEvent* _event);
+
+private slots:
+    void frameSwapped();
+    void renderFrame();
+
+private:
+    void scheduleFrame();
+
+    Renderer* renderer;
+    SchedulingMode currentMode;
+    int frameCap;
+
+    QTimer capTimer;
+    QElapsedTimer frameTimer;
+};
+
+#endif // FRAMESCHEDULER_H
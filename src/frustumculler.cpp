@@ -0,0 +1,350 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "frustumculler.h"
+
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+FrustumCuller::FrustumCuller():
+    numBoxes(0),
+    numVisibleBoxes(0)
+{
+    for(int i = 0; i < 6; ++i)
+    {
+        planes[i][0] = planes[i][1] = planes[i][2] = 0.0f;
+        planes[i][3] = 1.0f;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// extract the planes from the rows of the view projection matrix (Gribb/Hartmann)
+//------------------------------------------------------------------------------------------
+void FrustumCuller::setFrustum(const QMatrix4x4& _viewProjectionMatrix)
+{
+    QVector4D row0 = _viewProjectionMatrix.row(0);
+    QVector4D row1 = _viewProjectionMatrix.row(1);
+    QVector4D row2 = _viewProjectionMatrix.row(2);
+    QVector4D row3 = _viewProjectionMatrix.row(3);
+
+    QVector4D frustumPlanes[6] =
+    {
+        row3 + row0, // left
+        row3 - row0, // right
+        row3 + row1, // bottom
+        row3 - row1, // top
+        row3 + row2, // near
+        row3 - row2  // far
+    };
+
+    for(int i = 0; i < 6; ++i)
+    {
+        float length = frustumPlanes[i].toVector3D().length();
+
+        if(length < 1e-8f)
+        {
+            length = 1.0f;
+        }
+
+        planes[i][0] = frustumPlanes[i].x() / length;
+        planes[i][1] = frustumPlanes[i].y() / length;
+        planes[i][2] = frustumPlanes[i].z() / length;
+        planes[i][3] = frustumPlanes[i].w() / length;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void FrustumCuller::clearBoxes()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+    visibility.clear();
+    numBoxes = 0;
+    numVisibleBoxes = 0;
+}
+
+//------------------------------------------------------------------------------------------
+// the box is given in object space, its world space AABB encloses the transformed box
+//------------------------------------------------------------------------------------------
+int FrustumCuller::addBox(const QVector3D& _boxMin, const QVector3D& _boxMax,
+                          const QMatrix4x4& _modelMatrix)
+{
+    QVector3D center = _modelMatrix * (0.5f * (_boxMin + _boxMax));
+    QVector3D extent = 0.5f * (_boxMax - _boxMin);
+
+    centerX.append(center.x());
+    centerY.append(center.y());
+    centerZ.append(center.z());
+
+    extentX.append(fabs(_modelMatrix(0, 0)) * extent.x() +
+                   fabs(_modelMatrix(0, 1)) * extent.y() +
+                   fabs(_modelMatrix(0, 2)) * extent.z());
+    extentY.append(fabs(_modelMatrix(1, 0)) * extent.x() +
+                   fabs(_modelMatrix(1, 1)) * extent.y() +
+                   fabs(_modelMatrix(1, 2)) * extent.z());
+    extentZ.append(fabs(_modelMatrix(2, 0)) * extent.x() +
+                   fabs(_modelMatrix(2, 1)) * extent.y() +
+                   fabs(_modelMatrix(2, 2)) * extent.z());
+
+    visibility.append(1);
+
+    return numBoxes++;
+}
+
+//------------------------------------------------------------------------------------------
+// a box is outside if it lies entirely behind one of the planes:
+// dot(n, center) + d + dot(|n|, extent) < 0
+//------------------------------------------------------------------------------------------
+void FrustumCuller::cullBoxes()
+{
+    numVisibleBoxes = 0;
+
+    if(numBoxes == 0)
+    {
+        return;
+    }
+
+#ifdef FRUSTUM_CULLER_SSE
+    // pad the arrays to a multiple of 4, the padded boxes are never reported
+    int numPaddedBoxes = (numBoxes + 3) & ~3;
+    centerX.resize(numPaddedBoxes);
+    centerY.resize(numPaddedBoxes);
+    centerZ.resize(numPaddedBoxes);
+    extentX.resize(numPaddedBoxes);
+    extentY.resize(numPaddedBoxes);
+    extentZ.resize(numPaddedBoxes);
+
+    const __m128 zero = _mm_setzero_ps();
+
+    for(int i = 0; i < numPaddedBoxes; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(centerX.constData() + i);
+        __m128 cy = _mm_loadu_ps(centerY.constData() + i);
+        __m128 cz = _mm_loadu_ps(centerZ.constData() + i);
+        __m128 ex = _mm_loadu_ps(extentX.constData() + i);
+        __m128 ey = _mm_loadu_ps(extentY.constData() + i);
+        __m128 ez = _mm_loadu_ps(extentZ.constData() + i);
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for(int p = 0; p < 6; ++p)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p][0]), cx),
+                                                    _mm_mul_ps(_mm_set1_ps(planes[p][1]), cy)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p][2]), cz),
+                                                    _mm_set1_ps(planes[p][3])));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabs(planes[p][0])), ex),
+                                                  _mm_mul_ps(_mm_set1_ps(fabs(planes[p][1])), ey)),
+                                       _mm_mul_ps(_mm_set1_ps(fabs(planes[p][2])), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+
+        for(int j = 0; j < 4 && i + j < numBoxes; ++j)
+        {
+            visibility[i + j] = (mask >> j) & 1;
+            numVisibleBoxes += visibility[i + j];
+        }
+    }
+
+    centerX.resize(numBoxes);
+    centerY.resize(numBoxes);
+    centerZ.resize(numBoxes);
+    extentX.resize(numBoxes);
+    extentY.resize(numBoxes);
+    extentZ.resize(numBoxes);
+#else
+
+    for(int i = 0; i < numBoxes; ++i)
+    {
+        bool inside = true;
+
+        for(int p = 0; p < 6 && inside; ++p)
+        {
+            float distance = planes[p][0] * centerX[i] + planes[p][1] * centerY[i] +
+                             planes[p][2] * centerZ[i] + planes[p][3];
+            float radius = fabs(planes[p][0]) * extentX[i] + fabs(planes[p][1]) * extentY[i] +
+                           fabs(planes[p][2]) * extentZ[i];
+            inside = (distance + radius >= 0.0f);
+        }
+
+        visibility[i] = inside ? 1 : 0;
+        numVisibleBoxes += visibility[i];
+    }
+
+#endif
+}
+
+//------------------------------------------------------------------------------------------
+// boxes still visible are kept only if the shadow a point light at the origin makes them
+// cast, up to the given distance from the light, intersects the frustum; the shadow is the
+// box pushed away along the light rays and spread with the distance, it lies within the
+// convex hull of the box and of the box scaled about the light by the reach over the
+// distance of the nearest box point, so the support of the swept box along a plane normal
+// is the larger of the two ends; a box holding the light shadows everything
+//------------------------------------------------------------------------------------------
+void FrustumCuller::cullSweptBoxes(const QVector3D& _sweepOrigin, float _sweepLength)
+{
+    numVisibleBoxes = 0;
+
+    if(numBoxes == 0)
+    {
+        return;
+    }
+
+#ifdef FRUSTUM_CULLER_SSE
+    int numPaddedBoxes = (numBoxes + 3) & ~3;
+    centerX.resize(numPaddedBoxes);
+    centerY.resize(numPaddedBoxes);
+    centerZ.resize(numPaddedBoxes);
+    extentX.resize(numPaddedBoxes);
+    extentY.resize(numPaddedBoxes);
+    extentZ.resize(numPaddedBoxes);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(1e-6f);
+    const __m128 sweepLength = _mm_set1_ps(_sweepLength);
+    const __m128 originX = _mm_set1_ps(_sweepOrigin.x());
+    const __m128 originY = _mm_set1_ps(_sweepOrigin.y());
+    const __m128 originZ = _mm_set1_ps(_sweepOrigin.z());
+
+    for(int i = 0; i < numPaddedBoxes; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(centerX.constData() + i);
+        __m128 cy = _mm_loadu_ps(centerY.constData() + i);
+        __m128 cz = _mm_loadu_ps(centerZ.constData() + i);
+        __m128 ex = _mm_loadu_ps(extentX.constData() + i);
+        __m128 ey = _mm_loadu_ps(extentY.constData() + i);
+        __m128 ez = _mm_loadu_ps(extentZ.constData() + i);
+
+        // lower bound of the distance from the light to the box, and the spread of the
+        // far end
+        __m128 dx = _mm_sub_ps(cx, originX);
+        __m128 dy = _mm_sub_ps(cy, originY);
+        __m128 dz = _mm_sub_ps(cz, originZ);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx),
+                                                          _mm_mul_ps(dy, dy)),
+                                               _mm_mul_ps(dz, dz)));
+        __m128 extentLength = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex),
+                                                                _mm_mul_ps(ey, ey)),
+                                                     _mm_mul_ps(ez, ez)));
+        __m128 nearLength = _mm_sub_ps(length, extentLength);
+        __m128 enclosesOrigin = _mm_cmple_ps(nearLength, epsilon);
+        __m128 spread = _mm_max_ps(_mm_div_ps(sweepLength, _mm_max_ps(nearLength, epsilon)),
+                                   one);
+
+        // the far end is centered at origin + spread * (center - origin)
+        __m128 sweep = _mm_sub_ps(spread, one);
+        dx = _mm_mul_ps(dx, sweep);
+        dy = _mm_mul_ps(dy, sweep);
+        dz = _mm_mul_ps(dz, sweep);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for(int p = 0; p < 6; ++p)
+        {
+            __m128 a = _mm_set1_ps(planes[p][0]);
+            __m128 b = _mm_set1_ps(planes[p][1]);
+            __m128 c = _mm_set1_ps(planes[p][2]);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)),
+                                         _mm_add_ps(_mm_mul_ps(c, cz), _mm_set1_ps(planes[p][3])));
+            __m128 sweptDistance = _mm_add_ps(distance,
+                                              _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, dx),
+                                                                    _mm_mul_ps(b, dy)),
+                                                         _mm_mul_ps(c, dz)));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabs(planes[p][0])), ex),
+                                                  _mm_mul_ps(_mm_set1_ps(fabs(planes[p][1])), ey)),
+                                       _mm_mul_ps(_mm_set1_ps(fabs(planes[p][2])), ez));
+            __m128 support = _mm_max_ps(_mm_add_ps(distance, radius),
+                                        _mm_add_ps(sweptDistance, _mm_mul_ps(spread, radius)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(support, zero));
+        }
+
+        int mask = _mm_movemask_ps(_mm_or_ps(inside, enclosesOrigin));
+
+        for(int j = 0; j < 4 && i + j < numBoxes; ++j)
+        {
+            visibility[i + j] = visibility[i + j] & ((mask >> j) & 1);
+            numVisibleBoxes += visibility[i + j];
+        }
+    }
+
+    centerX.resize(numBoxes);
+    centerY.resize(numBoxes);
+    centerZ.resize(numBoxes);
+    extentX.resize(numBoxes);
+    extentY.resize(numBoxes);
+    extentZ.resize(numBoxes);
+#else
+
+    for(int i = 0; i < numBoxes; ++i)
+    {
+        if(!visibility[i])
+        {
+            continue;
+        }
+
+        QVector3D sweep(centerX[i] - _sweepOrigin.x(), centerY[i] - _sweepOrigin.y(),
+                        centerZ[i] - _sweepOrigin.z());
+        float nearLength = sweep.length() -
+                           QVector3D(extentX[i], extentY[i], extentZ[i]).length();
+
+        if(nearLength <= 1e-6f)
+        {
+            numVisibleBoxes += visibility[i];
+            continue;
+        }
+
+        float spread = fmax(_sweepLength / nearLength, 1.0f);
+        sweep *= spread - 1.0f;
+        bool inside = true;
+
+        for(int p = 0; p < 6 && inside; ++p)
+        {
+            float distance = planes[p][0] * centerX[i] + planes[p][1] * centerY[i] +
+                             planes[p][2] * centerZ[i] + planes[p][3];
+            float sweptDistance = distance + planes[p][0] * sweep.x() +
+                                  planes[p][1] * sweep.y() + planes[p][2] * sweep.z();
+            float radius = fabs(planes[p][0]) * extentX[i] + fabs(planes[p][1]) * extentY[i] +
+                           fabs(planes[p][2]) * extentZ[i];
+            inside = (fmax(distance + radius, sweptDistance + spread * radius) >= 0.0f);
+        }
+
+        visibility[i] = inside ? 1 : 0;
+        numVisibleBoxes += visibility[i];
+    }
+
+#endif
+}
+
+//------------------------------------------------------------------------------------------
+bool FrustumCuller::isVisible(int _boxIndex)
+{
+    return (visibility[_boxIndex] != 0);
+}
+
+//------------------------------------------------------------------------------------------
+int FrustumCuller::getNumBoxes()
+{
+    return numBoxes;
+}
+
+//------------------------------------------------------------------------------------------
+int FrustumCuller::getNumVisibleBoxes()
+{
+    return numVisibleBoxes;
+}
@@ -0,0 +1,53 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QVector4D>
+#include <QMatrix4x4>
+
+//------------------------------------------------------------------------------------------
+// Tests world space bounding boxes against the 6 planes of a view frustum.
+// The boxes are stored component by component, thus 4 of them are tested against
+// a plane at once with SSE when it is available.
+//------------------------------------------------------------------------------------------
+class FrustumCuller
+{
+public:
+    FrustumCuller();
+
+    void setFrustum(const QMatrix4x4& _viewProjectionMatrix);
+    void clearBoxes();
+    int addBox(const QVector3D& _boxMin, const QVector3D& _boxMax,
+               const QMatrix4x4& _modelMatrix);
+    void cullBoxes();
+    void cullSweptBoxes(const QVector3D& _sweepOrigin, float _sweepLength);
+
+    bool isVisible(int _boxIndex);
+    int getNumBoxes();
+    int getNumVisibleBoxes();
+
+private:
+    // plane equations (a, b, c, d), the normals point to the inside of the frustum
+    float planes[6][4];
+
+    QVector<float> centerX;
+    QVector<float> centerY;
+    QVector<float> centerZ;
+    QVector<float> extentX;
+    QVector<float> extentY;
+    QVector<float> extentZ;
+    QVector<char> visibility;
+    int numBoxes;
+    int numVisibleBoxes;
+};
+
+#endif // FRUSTUMCULLER_H
@@ -0,0 +1,351 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "headlessrenderer.h"
+
+//------------------------------------------------------------------------------------------
+HeadlessRenderer::HeadlessRenderer():
+    frameSize(1600, 1200),
+    numFrames(1),
+    orbitAngle(0.0f),
+    outputPattern("frame_%1.png"),
+    shadowMode(SHADOW_MAP),
+    shadingMode(PHONG_SHADING),
+    meshObject(TEAPOT_OBJ),
+    roomSize(10),
+    numInstances(DEFAULT_NUM_INSTANCES),
+    cameraPosition(DEFAULT_CAMERA_POSITION),
+    cameraFocus(DEFAULT_CAMERA_FOCUS),
+    lightPosition(QVector3D(DEFAULT_LIGHT_POSITION)),
+    context(NULL),
+    surface(NULL),
+    framebuffer(NULL),
+    renderer(NULL)
+{
+}
+
+//------------------------------------------------------------------------------------------
+HeadlessRenderer::~HeadlessRenderer()
+{
+    if(context && surface)
+    {
+        context->makeCurrent(surface);
+    }
+
+    delete framebuffer;
+    delete renderer;
+    delete surface;
+    delete context;
+}
+
+//------------------------------------------------------------------------------------------
+bool HeadlessRenderer::parseArguments(const QStringList& _arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders the shadow scene offscreen into image files.");
+    parser.addHelpOption();
+
+    QCommandLineOption headlessOption("headless", "Render without a window.");
+    QCommandLineOption sizeOption("size", "Frame size.", "WxH", "1600x1200");
+    QCommandLineOption framesOption("frames", "Number of frames.", "count", "1");
+    QCommandLineOption orbitOption("orbit", "Camera rotation around the focus per frame.",
+                                   "degrees", "0");
+    QCommandLineOption outputOption("output", "Output file name, %1 is the frame number.",
+                                    "pattern", "frame_%1.png");
+    QCommandLineOption shadowOption("shadow",
+                                    "Shadow method: none, projective, shadowmap, shadowvolume.",
+                                    "method", "shadowmap");
+    QCommandLineOption shadingOption("shading", "Shading: gouraud, phong.", "mode", "phong");
+    QCommandLineOption meshOption("mesh", "Mesh object: teapot, bunny, duck, mickey.",
+                                  "name", "teapot");
+    QCommandLineOption roomSizeOption("room-size", "Room size.", "size", "10");
+    QCommandLineOption instancesOption("instances", "Instances per object.", "count", "0");
+    QCommandLineOption cameraOption("camera", "Camera position.", "x,y,z");
+    QCommandLineOption focusOption("focus", "Camera focus.", "x,y,z");
+    QCommandLineOption lightOption("light", "Light position.", "x,y,z");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the frames.", "file");
+
+    parser.addOption(headlessOption);
+    parser.addOption(sizeOption);
+    parser.addOption(framesOption);
+    parser.addOption(orbitOption);
+    parser.addOption(outputOption);
+    parser.addOption(shadowOption);
+    parser.addOption(shadingOption);
+    parser.addOption(meshOption);
+    parser.addOption(roomSizeOption);
+    parser.addOption(instancesOption);
+    parser.addOption(cameraOption);
+    parser.addOption(focusOption);
+    parser.addOption(lightOption);
+    parser.addOption(traceOption);
+
+    if(!parser.parse(_arguments))
+    {
+        PRINT_ERROR(parser.errorText());
+        return false;
+    }
+
+    if(parser.isSet("help"))
+    {
+        qInfo().noquote() << parser.helpText();
+        return false;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // frames
+    QStringList size = parser.value(sizeOption).split('x');
+    bool ok = (size.size() == 2);
+
+    if(ok)
+    {
+        bool okHeight;
+        frameSize = QSize(size.at(0).toInt(&ok), size.at(1).toInt(&okHeight));
+        ok = ok && okHeight && !frameSize.isEmpty();
+    }
+
+    if(!ok)
+    {
+        PRINT_ERROR("Invalid frame size " + parser.value(sizeOption));
+        return false;
+    }
+
+    numFrames = qMax(parser.value(framesOption).toInt(), 1);
+    orbitAngle = parser.value(orbitOption).toFloat();
+    outputPattern = parser.value(outputOption);
+    traceFileName = parser.value(traceOption);
+
+    if(!outputPattern.contains("%1"))
+    {
+        PRINT_ERROR("The output pattern needs %1 for the frame number.");
+        return false;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // scene
+    const char* shadowNames[NUM_SHADOW_METHODS] =
+    {
+        "none", "projective", "shadowmap", "shadowvolume"
+    };
+    const char* meshNames[NUM_MESH_OBJECT] =
+    {
+        "teapot", "bunny", "duck", "mickey"
+    };
+
+    shadowMode = NUM_SHADOW_METHODS;
+
+    for(int i = 0; i < NUM_SHADOW_METHODS; ++i)
+    {
+        if(parser.value(shadowOption) == shadowNames[i])
+        {
+            shadowMode = static_cast<ShadowModes>(i);
+        }
+    }
+
+    meshObject = NUM_MESH_OBJECT;
+
+    for(int i = 0; i < NUM_MESH_OBJECT; ++i)
+    {
+        if(parser.value(meshOption) == meshNames[i])
+        {
+            meshObject = i;
+        }
+    }
+
+    if(shadowMode == NUM_SHADOW_METHODS || meshObject == NUM_MESH_OBJECT)
+    {
+        PRINT_ERROR("Unknown shadow method or mesh object.");
+        return false;
+    }
+
+    if(parser.value(shadingOption) == "gouraud")
+    {
+        shadingMode = GOURAUD_SHADING;
+    }
+    else if(parser.value(shadingOption) == "phong")
+    {
+        shadingMode = PHONG_SHADING;
+    }
+    else
+    {
+        PRINT_ERROR("Unknown shading " + parser.value(shadingOption));
+        return false;
+    }
+
+    roomSize = qBound(4, parser.value(roomSizeOption).toInt(), 100);
+    numInstances = qBound(0, parser.value(instancesOption).toInt(), MAX_NUM_INSTANCES);
+
+    if((parser.isSet(cameraOption) &&
+        !parseVector(parser.value(cameraOption), &cameraPosition)) ||
+       (parser.isSet(focusOption) &&
+        !parseVector(parser.value(focusOption), &cameraFocus)) ||
+       (parser.isSet(lightOption) &&
+        !parseVector(parser.value(lightOption), &lightPosition)))
+    {
+        PRINT_ERROR("Vectors are given as x,y,z.");
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+void HeadlessRenderer::setFrameSize(const QSize& _frameSize)
+{
+    frameSize = _frameSize;
+}
+
+//------------------------------------------------------------------------------------------
+bool HeadlessRenderer::parseVector(const QString& _value, QVector3D* _vector)
+{
+    QStringList components = _value.split(',');
+
+    if(components.size() != 3)
+    {
+        return false;
+    }
+
+    float values[3];
+
+    for(int i = 0; i < 3; ++i)
+    {
+        bool ok;
+        values[i] = components.at(i).toFloat(&ok);
+
+        if(!ok)
+        {
+            return false;
+        }
+    }
+
+    *_vector = QVector3D(values[0], values[1], values[2]);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool HeadlessRenderer::initialize()
+{
+    context = new QOpenGLContext;
+    context->setFormat(QSurfaceFormat::defaultFormat());
+
+    if(!context->create())
+    {
+        PRINT_ERROR("Cannot create OpenGL context.");
+        return false;
+    }
+
+    surface = new QOffscreenSurface;
+    surface->setFormat(context->format());
+    surface->create();
+
+    if(!surface->isValid() || !context->makeCurrent(surface))
+    {
+        PRINT_ERROR("Cannot make the offscreen surface current.");
+        return false;
+    }
+
+    // the stencil is needed by the projective shadows and the shadow volumes
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    framebuffer = new QOpenGLFramebufferObject(frameSize, format);
+
+    if(!framebuffer->isValid())
+    {
+        PRINT_ERROR("Cannot create the framebuffer object.");
+        return false;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // the same scene as the window starts with
+    renderer = new Renderer;
+    renderer->initializeHeadless(context, frameSize);
+
+    renderer->setRoomColor(5.0f / 255.0f, 115.0f / 255.0f, 1.0f);
+    renderer->setCubeColor(0.0f, 1.0f, 50.0f / 255.0f);
+    renderer->setMeshObjectColor(170.0f / 255.0f, 85.0f / 255.0f, 0.0f);
+    renderer->setOccluderColor(1.0f, 26.0f / 255.0f, 153.0f / 255.0f);
+
+    if(meshObject != TEAPOT_OBJ)
+    {
+        renderer->setMeshObject(meshObject);
+    }
+
+    renderer->setRoomSize(roomSize);
+    renderer->setNumInstances(numInstances);
+    renderer->setShadingMode(shadingMode);
+    renderer->setShadowMethod(shadowMode);
+    renderer->setLightPosition(lightPosition);
+    renderer->setCamera(cameraPosition, cameraFocus);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+// the camera orbits around the vertical axis through its focus
+//------------------------------------------------------------------------------------------
+bool HeadlessRenderer::renderFrames()
+{
+    int numDigits = QString::number(numFrames - 1).length();
+    QElapsedTimer timer;
+    timer.start();
+
+    if(!traceFileName.isEmpty())
+    {
+        renderer->startTrace();
+    }
+
+    for(int i = 0; i < numFrames; ++i)
+    {
+        QMatrix4x4 orbitMatrix;
+        orbitMatrix.translate(cameraFocus);
+        orbitMatrix.rotate(i * orbitAngle, 0.0f, 1.0f, 0.0f);
+        orbitMatrix.translate(-cameraFocus);
+        renderer->setCamera(orbitMatrix * cameraPosition, cameraFocus);
+
+        renderFrame();
+
+        QString fileName = outputPattern.arg(i, numDigits, 10, QChar('0'));
+
+        if(!grabFrame().save(fileName))
+        {
+            PRINT_ERROR("Cannot write " + fileName);
+            return false;
+        }
+    }
+
+    qInfo() << "Rendered" << numFrames << "frames in" << timer.elapsed() << "ms";
+
+    if(!traceFileName.isEmpty() && !renderer->writeTrace(traceFileName))
+    {
+        PRINT_ERROR("Cannot write " + traceFileName);
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+Renderer* HeadlessRenderer::getRenderer()
+{
+    return renderer;
+}
+
+//------------------------------------------------------------------------------------------
+// returns when the frame is finished on the GPU
+//------------------------------------------------------------------------------------------
+void HeadlessRenderer::renderFrame()
+{
+    renderer->renderHeadlessFrame(framebuffer);
+}
+
+//------------------------------------------------------------------------------------------
+QImage HeadlessRenderer::grabFrame()
+{
+    return framebuffer->toImage();
+}
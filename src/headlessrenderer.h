@@ -0,0 +1,64 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef HEADLESSRENDERER_H
+#define HEADLESSRENDERER_H
+
+#include <QtGui>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+
+#include "renderer.h"
+
+//------------------------------------------------------------------------------------------
+// Renders the scene of the Renderer into a framebuffer object of an offscreen surface and
+// writes the frames to image files, so that no window and no display are needed. The scene
+// and the camera are given on the command line, the camera may orbit around its focus to
+// produce a sequence of frames.
+//------------------------------------------------------------------------------------------
+class HeadlessRenderer
+{
+public:
+    HeadlessRenderer();
+    ~HeadlessRenderer();
+
+    bool parseArguments(const QStringList& _arguments);
+    void setFrameSize(const QSize& _frameSize);
+    bool initialize();
+    bool renderFrames();
+
+    Renderer* getRenderer();
+    void renderFrame();
+    QImage grabFrame();
+
+private:
+    bool parseVector(const QString& _value, QVector3D* _vector);
+
+    QSize frameSize;
+    int numFrames;
+    float orbitAngle;
+    QString outputPattern;
+    QString traceFileName;
+
+    ShadowModes shadowMode;
+    ShadingProgram shadingMode;
+    int meshObject;
+    int roomSize;
+    int numInstances;
+    QVector3D cameraPosition;
+    QVector3D cameraFocus;
+    QVector3D lightPosition;
+
+    QOpenGLContext* context;
+    QOffscreenSurface* surface;
+    QOpenGLFramebufferObject* framebuffer;
+    Renderer* renderer;
+};
+
+#endif // HEADLESSRENDERER_H
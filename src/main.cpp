@@ -11,9 +11,26 @@
 #include <QtOpenGL/qgl.h>
 
 #include "mainwindow.h"
+#include "headlessrenderer.h"
 
 int main(int argc, char *argv[])
 {
+    bool headless = false;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(QString(argv[i]) == "--headless")
+        {
+            headless = true;
+        }
+    }
+
+    // render nodes have no display, the widgets then live on the offscreen platform
+    if(headless && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
 
     QSurfaceFormat format;
@@ -22,6 +39,20 @@ int main(int argc, char *argv[])
     format.setProfile(QSurfaceFormat::CoreProfile);
     QSurfaceFormat::setDefaultFormat(format);
 
+    if(headless)
+    {
+        HeadlessRenderer headlessRenderer;
+
+        if(!headlessRenderer.parseArguments(a.arguments()) ||
+           !headlessRenderer.initialize() ||
+           !headlessRenderer.renderFrames())
+        {
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     MainWindow mainWindow;
     mainWindow.show();
     mainWindow.setGeometry( QStyle::alignedRect(Qt::LeftToRight, Qt::AlignCenter,
@@ -19,10 +19,6 @@ MainWindow::MainWindow(QWidget* parent) : QWidget(parent)
     setMeshObjectColor(QColor(170, 85, 0));
     setOccluderColor(QColor(255, 26, 153));
 
-    // Update continuously
-    QTimer* timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), renderer, SLOT(update()));
-    timer->start(10);
 }
 
 //------------------------------------------------------------------------------------------
@@ -68,6 +64,8 @@ void MainWindow::keyPressEvent(QKeyEvent* e)
 void MainWindow::setupGUI()
 {
     renderer = new Renderer(this);
+    renderer->enableRenderThread();
+    frameScheduler = new FrameScheduler(renderer, this);
 
     ////////////////////////////////////////////////////////////////////////////////
     // shading modes
@@ -247,8 +245,21 @@ void MainWindow::setupGUI()
 
 
 
+    // shown while a mesh is loaded in the background
+    pgbMeshObjectLoad = new QProgressBar;
+    pgbMeshObjectLoad->setRange(0, 100);
+    pgbMeshObjectLoad->setTextVisible(false);
+    pgbMeshObjectLoad->setFixedHeight(6);
+    pgbMeshObjectLoad->setVisible(false);
+
+    connect(renderer, &Renderer::meshObjectLoadProgress, pgbMeshObjectLoad,
+            &QProgressBar::setValue);
+    connect(renderer, &Renderer::meshObjectLoadProgress, this,
+            &MainWindow::updateMeshObjectLoadProgress);
+
     QVBoxLayout* meshObjectLayout = new QVBoxLayout;
     meshObjectLayout->addWidget(cbMeshObject);
+    meshObjectLayout->addWidget(pgbMeshObjectLoad);
     QGroupBox* meshObjectGroup = new QGroupBox("Mesh Object");
     meshObjectGroup->setLayout(meshObjectLayout);
 
@@ -273,6 +284,23 @@ void MainWindow::setupGUI()
     roomSizeGroup->setLayout(roomSizeLayout);
 
 
+    ////////////////////////////////////////////////////////////////////////////////
+    // instanced objects
+    QSpinBox* spbNumInstances = new QSpinBox;
+    spbNumInstances->setMinimum(0);
+    spbNumInstances->setMaximum(MAX_NUM_INSTANCES);
+    spbNumInstances->setSingleStep(16);
+    spbNumInstances->setValue(DEFAULT_NUM_INSTANCES);
+
+    connect(spbNumInstances, SIGNAL(valueChanged(int)), renderer,
+            SLOT(setNumInstances(int)));
+
+    QVBoxLayout* numInstancesLayout = new QVBoxLayout;
+    numInstancesLayout->addWidget(spbNumInstances);
+    QGroupBox* numInstancesGroup = new QGroupBox("Instances per Object");
+    numInstancesGroup->setLayout(numInstancesLayout);
+
+
     ////////////////////////////////////////////////////////////////////////////////
     // light intensity
     QSlider* sldLightIntensity = new QSlider(Qt::Horizontal);
@@ -321,12 +349,43 @@ void MainWindow::setupGUI()
 
     chkShowShadowVolume = new QCheckBox("Show Shadow Volume");
 
+    QCheckBox* chkBatchedProjectiveShadow = new QCheckBox("Batched Projective Shadow");
+    chkBatchedProjectiveShadow->setEnabled(false);
+
+    connect(chkBatchedProjectiveShadow, &QCheckBox::toggled, renderer,
+            &Renderer::enableBatchedProjectiveShadow);
+    connect(rdbProjectiveShadow, &QRadioButton::toggled, chkBatchedProjectiveShadow,
+            &QCheckBox::setEnabled);
+
+    QCheckBox* chkPointLightShadowVolumes = new QCheckBox("Point Light Shadow Volumes");
+    chkPointLightShadowVolumes->setEnabled(false);
+
+    connect(chkPointLightShadowVolumes, &QCheckBox::toggled, renderer,
+            &Renderer::enablePointLightShadowVolumes);
+    connect(rdbShadowVolume, &QRadioButton::toggled, chkPointLightShadowVolumes,
+            &QCheckBox::setEnabled);
+
+    QSpinBox* spbNumShadowLights = new QSpinBox;
+    spbNumShadowLights->setMinimum(1);
+    spbNumShadowLights->setMaximum(MAX_NUM_SHADOW_LIGHTS);
+    spbNumShadowLights->setValue(DEFAULT_NUM_SHADOW_LIGHTS);
+    spbNumShadowLights->setEnabled(false);
+
+    connect(spbNumShadowLights, SIGNAL(valueChanged(int)), renderer,
+            SLOT(setNumShadowLights(int)));
+    connect(rdbShadowMap, &QRadioButton::toggled, spbNumShadowLights,
+            &QSpinBox::setEnabled);
+
     QGridLayout* shadowLayout = new QGridLayout;
     shadowLayout->addWidget(rdbNoShadow, 0, 0);
     shadowLayout->addWidget(rdbProjectiveShadow, 0, 1);
     shadowLayout->addWidget(rdbShadowMap, 1, 0);
     shadowLayout->addWidget(rdbShadowVolume, 1, 1);
-    shadowLayout->addWidget(chkShowShadowVolume, 2, 0, 1, 2);
+    shadowLayout->addWidget(chkShowShadowVolume, 2, 0);
+    shadowLayout->addWidget(chkPointLightShadowVolumes, 2, 1);
+    shadowLayout->addWidget(new QLabel("Shadow Map Lights"), 3, 0);
+    shadowLayout->addWidget(spbNumShadowLights, 3, 1);
+    shadowLayout->addWidget(chkBatchedProjectiveShadow, 4, 0, 1, 2);
 
     QGroupBox* shadowGroup = new QGroupBox("Shadow Generation");
     shadowGroup->setLayout(shadowLayout);
@@ -344,6 +403,36 @@ void MainWindow::setupGUI()
             &Renderer::enableShowShadowVolume);
     chkShowShadowVolume->setEnabled(false);
 
+    ////////////////////////////////////////////////////////////////////////////////
+    // point lights, drawn by deferred or clustered forward shading
+    QCheckBox* chkEnableDeferredShading = new QCheckBox("Deferred Shading");
+    chkEnableDeferredShading->setChecked(false);
+    connect(chkEnableDeferredShading, &QCheckBox::toggled, renderer,
+            &Renderer::enableDeferredShading);
+
+    QCheckBox* chkEnableClusteredShading = new QCheckBox("Clustered Forward Shading");
+    chkEnableClusteredShading->setChecked(false);
+    connect(chkEnableClusteredShading, &QCheckBox::toggled, renderer,
+            &Renderer::enableClusteredShading);
+
+    QSpinBox* spbNumPointLights = new QSpinBox;
+    spbNumPointLights->setMinimum(0);
+    spbNumPointLights->setMaximum(MAX_NUM_POINT_LIGHTS);
+    spbNumPointLights->setSingleStep(16);
+    spbNumPointLights->setValue(DEFAULT_NUM_POINT_LIGHTS);
+
+    connect(spbNumPointLights, SIGNAL(valueChanged(int)), renderer,
+            SLOT(setNumPointLights(int)));
+
+    QGridLayout* pointLightsLayout = new QGridLayout;
+    pointLightsLayout->addWidget(new QLabel("Number of Lights"), 0, 0);
+    pointLightsLayout->addWidget(spbNumPointLights, 0, 1);
+    pointLightsLayout->addWidget(chkEnableDeferredShading, 1, 0);
+    pointLightsLayout->addWidget(chkEnableClusteredShading, 1, 1);
+
+    QGroupBox* pointLightsGroup = new QGroupBox("Point Lights");
+    pointLightsGroup->setLayout(pointLightsLayout);
+
     ////////////////////////////////////////////////////////////////////////////////
     // mouse drag transformation
     QRadioButton* rdbMoveCamera;
@@ -393,6 +482,73 @@ void MainWindow::setupGUI()
     connect(chkEnableZAxisRotation, &QCheckBox::toggled, renderer,
             &Renderer::enableZAxisRotation);
 
+    QCheckBox* chkEnableMultiDrawIndirect = new QCheckBox("Multi-Draw Indirect Submission");
+    chkEnableMultiDrawIndirect->setChecked(false);
+    connect(chkEnableMultiDrawIndirect, &QCheckBox::toggled, renderer,
+            &Renderer::enableMultiDrawIndirect);
+
+    QCheckBox* chkEnableFrustumCulling = new QCheckBox("Frustum Culling");
+    chkEnableFrustumCulling->setChecked(false);
+    connect(chkEnableFrustumCulling, &QCheckBox::toggled, renderer,
+            &Renderer::enableFrustumCulling);
+
+    QCheckBox* chkEnableOcclusionCulling = new QCheckBox("Occlusion Culling");
+    chkEnableOcclusionCulling->setChecked(false);
+    chkEnableOcclusionCulling->setEnabled(false);
+    connect(chkEnableOcclusionCulling, &QCheckBox::toggled, renderer,
+            &Renderer::enableOcclusionCulling);
+    connect(chkEnableFrustumCulling, &QCheckBox::toggled, chkEnableOcclusionCulling,
+            &QCheckBox::setEnabled);
+
+    QCheckBox* chkEnableDepthPrePass = new QCheckBox("Depth Pre-Pass");
+    chkEnableDepthPrePass->setChecked(false);
+    connect(chkEnableDepthPrePass, &QCheckBox::toggled, renderer,
+            &Renderer::enableDepthPrePass);
+
+    QCheckBox* chkEnableShadingVariants = new QCheckBox("Specialized Shader Variants");
+    chkEnableShadingVariants->setChecked(true);
+    connect(chkEnableShadingVariants, &QCheckBox::toggled, renderer,
+            &Renderer::enableShadingVariants);
+
+    QCheckBox* chkEnableRenderQueue = new QCheckBox("Sorted Render Queue");
+    chkEnableRenderQueue->setChecked(false);
+    connect(chkEnableRenderQueue, &QCheckBox::toggled, renderer,
+            &Renderer::enableRenderQueue);
+
+    QCheckBox* chkEnableProfilerOverlay = new QCheckBox("Profiler Overlay");
+    chkEnableProfilerOverlay->setChecked(false);
+    connect(chkEnableProfilerOverlay, &QCheckBox::toggled, renderer,
+            &Renderer::enableProfilerOverlay);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // frame scheduling
+    QCheckBox* chkOnDemandRendering = new QCheckBox("On-Demand Rendering");
+    chkOnDemandRendering->setChecked(frameScheduler->getMode() == ON_DEMAND_RENDERING);
+    connect(chkOnDemandRendering, &QCheckBox::toggled, this,
+            &MainWindow::changeSchedulingMode);
+
+    QSpinBox* spbFrameCap = new QSpinBox;
+    spbFrameCap->setMinimum(0);
+    spbFrameCap->setMaximum(1000);
+    spbFrameCap->setSingleStep(10);
+    spbFrameCap->setSpecialValueText("VSync");
+    spbFrameCap->setValue(frameScheduler->getFrameCap());
+
+    connect(spbFrameCap, SIGNAL(valueChanged(int)), frameScheduler,
+            SLOT(setFrameCap(int)));
+
+    QGridLayout* frameSchedulingLayout = new QGridLayout;
+    frameSchedulingLayout->addWidget(chkOnDemandRendering, 0, 0, 1, 2);
+    frameSchedulingLayout->addWidget(new QLabel("Frame Cap"), 1, 0);
+    frameSchedulingLayout->addWidget(spbFrameCap, 1, 1);
+
+    QGroupBox* frameSchedulingGroup = new QGroupBox("Frame Scheduling");
+    frameSchedulingGroup->setLayout(frameSchedulingLayout);
+
+    lblCullingStatistics = new QLabel;
+    connect(renderer, &Renderer::cullingStatisticsChanged, this,
+            &MainWindow::updateCullingStatistics);
+
     QPushButton* btnResetObjects = new QPushButton("Reset Object Positions");
     connect(btnResetObjects, SIGNAL(clicked()), this,
             SLOT(resetObjectPositions()));
@@ -411,11 +567,22 @@ void MainWindow::setupGUI()
     parameterLayout->addWidget(meshObjectGroup);
     parameterLayout->addWidget(objectColorGroup);
     parameterLayout->addWidget(roomSizeGroup);
+    parameterLayout->addWidget(numInstancesGroup);
     parameterLayout->addWidget(lightIntensityGroup);
     parameterLayout->addWidget(ambientLightGroup);
     parameterLayout->addWidget(shadowGroup);
+    parameterLayout->addWidget(pointLightsGroup);
     parameterLayout->addWidget(mouseTransformationTargetGroup);
     parameterLayout->addWidget(chkEnableZAxisRotation);
+    parameterLayout->addWidget(chkEnableMultiDrawIndirect);
+    parameterLayout->addWidget(chkEnableDepthPrePass);
+    parameterLayout->addWidget(chkEnableShadingVariants);
+    parameterLayout->addWidget(chkEnableRenderQueue);
+    parameterLayout->addWidget(chkEnableFrustumCulling);
+    parameterLayout->addWidget(chkEnableOcclusionCulling);
+    parameterLayout->addWidget(lblCullingStatistics);
+    parameterLayout->addWidget(chkEnableProfilerOverlay);
+    parameterLayout->addWidget(frameSchedulingGroup);
 
     parameterLayout->addWidget(btnResetObjects);
     parameterLayout->addWidget(btnResetCamera);
@@ -590,6 +757,28 @@ void MainWindow::changeShadowMethod(bool _state)
     renderer->setShadowMethod(rdb2ShadowMethodMap[rdbShadowMethod]);
 }
 
+//------------------------------------------------------------------------------------------
+void MainWindow::updateMeshObjectLoadProgress(int _percent)
+{
+    pgbMeshObjectLoad->setVisible(_percent < 100);
+}
+
+//------------------------------------------------------------------------------------------
+void MainWindow::changeSchedulingMode(bool _onDemand)
+{
+    frameScheduler->setMode(_onDemand ? ON_DEMAND_RENDERING : CONTINUOUS_RENDERING);
+}
+
+//------------------------------------------------------------------------------------------
+void MainWindow::updateCullingStatistics(int _numCameraDrawn, int _numCameraCulled,
+                                         int _numLightDrawn, int _numLightCulled)
+{
+    lblCullingStatistics->setText(QString("Camera pass: %1 drawn, %2 culled\n"
+                                          "Light pass: %3 drawn, %4 culled")
+                                  .arg(_numCameraDrawn).arg(_numCameraCulled)
+                                  .arg(_numLightDrawn).arg(_numLightCulled));
+}
+
 //------------------------------------------------------------------------------------------
 void MainWindow::setRoomColor(QColor _color)
 {
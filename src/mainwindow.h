@@ -14,6 +14,7 @@
 #include <QtWidgets>
 
 #include "renderer.h"
+#include "framescheduler.h"
 
 class MainWindow : public QWidget
 {
@@ -41,6 +42,10 @@ public slots:
     void changeOccluderColor();
     void changeMouseTransformTarget(bool _state);
     void changeShadowMethod(bool _state);
+    void changeSchedulingMode(bool _onDemand);
+    void updateMeshObjectLoadProgress(int _percent);
+    void updateCullingStatistics(int _numCameraDrawn, int _numCameraCulled,
+                                 int _numLightDrawn, int _numLightCulled);
 
 private:
     void setRoomColor(QColor _color);
@@ -49,6 +54,7 @@ private:
     void setOccluderColor(QColor _color);
 
     Renderer* renderer;
+    FrameScheduler* frameScheduler;
 
     QMap<QRadioButton*, ShadingProgram> rdb2ShadingMap;
     QList<QRadioButton*> shadingRDBList;
@@ -70,6 +76,8 @@ private:
     QSlider* sldRoomSize;
 
     QMap<QRadioButton*, MouseTransformationTarget> rdb2MouseTransTargetMap;
+    QLabel* lblCullingStatistics;
+    QProgressBar* pgbMeshObjectLoad;
 
 };
 
@@ -0,0 +1,121 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "meshloader.h"
+#include "renderer.h"
+
+//------------------------------------------------------------------------------------------
+MeshLoader::MeshLoader(Renderer* _renderer):
+    renderer(_renderer),
+    latestRequest(0)
+{
+    thread.setObjectName("MeshLoader");
+    moveToThread(&thread);
+    thread.start();
+}
+
+//------------------------------------------------------------------------------------------
+MeshLoader::~MeshLoader()
+{
+    thread.quit();
+    thread.wait();
+}
+
+//------------------------------------------------------------------------------------------
+void MeshLoader::requestMeshObject(int _meshIndex)
+{
+    int request = latestRequest.fetchAndAddOrdered(1) + 1;
+
+    QMetaObject::invokeMethod(this, "loadRequestedMeshObject", Qt::QueuedConnection,
+                              Q_ARG(int, _meshIndex), Q_ARG(int, request));
+}
+
+//------------------------------------------------------------------------------------------
+const char* MeshLoader::getFileName(int _meshIndex)
+{
+    switch (_meshIndex)
+    {
+    case TEAPOT_OBJ:
+        return ":/obj/teapot.obj";
+
+    case BUNNY_OBJ:
+        return ":/obj/bunny.obj";
+
+    case DUCK_OBJ:
+        return ":/obj/duck.obj";
+
+    case MICKEY_OBJ:
+        return ":/obj/mickey.obj";
+
+    default:
+        return NULL;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// parses the file and computes the normals and bounds, NULL if it cannot be loaded
+//------------------------------------------------------------------------------------------
+OBJLoader* MeshLoader::loadMeshObject(int _meshIndex)
+{
+    const char* fileName = getFileName(_meshIndex);
+    OBJLoader* objLoader = new OBJLoader;
+
+    if(!fileName || !objLoader->loadObjFile(fileName))
+    {
+        delete objLoader;
+        return NULL;
+    }
+
+    return objLoader;
+}
+
+//------------------------------------------------------------------------------------------
+void MeshLoader::loadRequestedMeshObject(int _meshIndex, int _request)
+{
+    // a newer request is waiting behind this one
+    if(_request != latestRequest.loadAcquire())
+    {
+        return;
+    }
+
+    emit progressChanged(0);
+
+    qint64 loadBegin = renderer->getProfilerTime();
+
+    // shared, so the loader is freed even if the queued upload never runs
+    QSharedPointer<OBJLoader> objLoader(loadMeshObject(_meshIndex));
+
+    if(!objLoader)
+    {
+        PRINT_ERROR("Could not load OBJ file!");
+        emit progressChanged(100);
+        return;
+    }
+
+    emit progressChanged(60);
+
+    QVector<PlanarPatch> patches = objLoader->getPlanarPatches(MIN_MESH_RECEIVER_AREA,
+                                                               MAX_NUM_RECEIVER_PLANES);
+
+    if(_request != latestRequest.loadAcquire())
+    {
+        return;
+    }
+
+    emit progressChanged(80);
+
+    // the renderer posts the upload on to its render thread, if it has one, and traces the
+    // load there
+    Renderer* target = renderer;
+    qint64 loadEnd = renderer->getProfilerTime();
+    QMetaObject::invokeMethod(renderer, [target, _meshIndex, objLoader, patches, loadBegin,
+                                         loadEnd]()
+    {
+        target->uploadMeshObject(_meshIndex, objLoader, patches, loadBegin, loadEnd);
+    }, Qt::QueuedConnection);
+}
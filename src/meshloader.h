@@ -0,0 +1,54 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+
+#include "objloader.h"
+#include "planarpatch.h"
+
+class Renderer;
+
+//------------------------------------------------------------------------------------------
+// Loads the mesh objects on a thread of its own: the OBJ file is parsed, its normals and
+// bounds computed and the receiver patches extracted there, then the loaded mesh is handed
+// to Renderer::uploadMeshObject() on the thread of the renderer, which swaps it in with
+// the GPU buffers. Until then the old mesh keeps being drawn. A request replaces the ones
+// still waiting, only the latest mesh is uploaded.
+//------------------------------------------------------------------------------------------
+class MeshLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    MeshLoader(Renderer* _renderer);
+    ~MeshLoader();
+
+    void requestMeshObject(int _meshIndex);
+
+    static const char* getFileName(int _meshIndex);
+    static OBJLoader* loadMeshObject(int _meshIndex);
+
+signals:
+    void progressChanged(int _percent);
+
+private slots:
+    void loadRequestedMeshObject(int _meshIndex, int _request);
+
+private:
+    Renderer* renderer;
+    QThread thread;
+    QAtomicInt latestRequest;
+};
+
+#endif // MESHLOADER_H
@@ -57,6 +57,12 @@ bool OBJLoader::loadObjFile(const char* _fileName)
             texCoordList.append(texCoor.x);
             texCoordList.append(texCoor.y);
         }
+        else
+        {
+            // keep the texture coordinate array the same length as the vertex array
+            texCoordList.append(0.0f);
+            texCoordList.append(0.0f);
+        }
     }
 
     for(int i = 0; i < objObject->NF(); ++i)
@@ -116,6 +122,18 @@ float OBJLoader::getLowestYCoordinate()
     return (boxMin.y / getScalingFactor());
 }
 
+//------------------------------------------------------------------------------------------
+QVector3D OBJLoader::getBoundMin()
+{
+    return QVector3D(boxMin.x, boxMin.y, boxMin.z);
+}
+
+//------------------------------------------------------------------------------------------
+QVector3D OBJLoader::getBoundMax()
+{
+    return QVector3D(boxMax.x, boxMax.y, boxMax.z);
+}
+
 //------------------------------------------------------------------------------------------
 int OBJLoader::getTexCoordOffset()
 {
@@ -146,6 +164,13 @@ GLushort* OBJLoader::getIndices()
     return (GLushort*)indicesList.data();
 }
 
+//------------------------------------------------------------------------------------------
+QVector<PlanarPatch> OBJLoader::getPlanarPatches(float _minAreaFraction, int _maxNumPatches)
+{
+    return PlanarPatchExtractor::extractPatches(getVertices(), getIndices(), getNumIndices(),
+                                                _minAreaFraction, _maxNumPatches);
+}
+
 //------------------------------------------------------------------------------------------
 void OBJLoader::clearData()
 {
@@ -15,6 +15,7 @@
 #include <math.h>
 
 #include "cyTriMesh.h"
+#include "planarpatch.h"
 
 class OBJLoader
 {
@@ -31,11 +32,14 @@ public:
     int getIndexOffset();
     float getScalingFactor();
     float getLowestYCoordinate();
+    QVector3D getBoundMin();
+    QVector3D getBoundMax();
 
     GLfloat* getVertices();
     GLfloat* getNormals();
     GLfloat* getTexureCoordinates();
     GLushort* getIndices();
+    QVector<PlanarPatch> getPlanarPatches(float _minAreaFraction, int _maxNumPatches);
 
 private:
     cyTriMesh* objObject;
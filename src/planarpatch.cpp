@@ -0,0 +1,286 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "planarpatch.h"
+
+#include <QHash>
+#include <math.h>
+
+//------------------------------------------------------------------------------------------
+// the model matrices of the scene only rotate, translate and scale uniformly, so the edges
+// stay orthogonal
+//------------------------------------------------------------------------------------------
+PlanarPatch PlanarPatch::transformed(const QMatrix4x4& _modelMatrix) const
+{
+    PlanarPatch patch;
+    patch.origin = _modelMatrix * origin;
+    patch.edgeU = _modelMatrix * (origin + edgeU) - patch.origin;
+    patch.edgeV = _modelMatrix * (origin + edgeV) - patch.origin;
+
+    QVector3D normal = QVector3D::crossProduct(patch.edgeU, patch.edgeV).normalized();
+
+    // a mirroring matrix must not flip the plane
+    if(QVector3D::dotProduct(normal, _modelMatrix.mapVector(plane.toVector3D())) < 0.0f)
+    {
+        normal = -normal;
+    }
+
+    patch.plane = QVector4D(normal, -QVector3D::dotProduct(normal, patch.origin));
+    patch.area = area * QVector3D::crossProduct(patch.edgeU, patch.edgeV).length() /
+                 fmax(QVector3D::crossProduct(edgeU, edgeV).length(), 1e-12f);
+
+    patch.triangles.resize(triangles.size());
+
+    for(int i = 0; i < triangles.size(); ++i)
+    {
+        patch.triangles[i] = _modelMatrix * triangles.at(i);
+    }
+
+    return patch;
+}
+
+//------------------------------------------------------------------------------------------
+// root of the group of a triangle, the path is halved on the way
+//------------------------------------------------------------------------------------------
+static int findGroup(QVector<int>& _parents, int _triangle)
+{
+    while(_parents.at(_triangle) != _triangle)
+    {
+        _parents[_triangle] = _parents.at(_parents.at(_triangle));
+        _triangle = _parents.at(_triangle);
+    }
+
+    return _triangle;
+}
+
+//------------------------------------------------------------------------------------------
+// the normal is quantized to about 1 degree, the offset and the vertex positions to 1/1000
+// of the mesh size; the vertices are welded by their position, as the faces of a mesh do
+// not always share their indices
+//------------------------------------------------------------------------------------------
+QVector<PlanarPatch> PlanarPatchExtractor::extractPatches(const GLfloat* _vertices,
+                                                          const GLushort* _indices,
+                                                          int _numIndices,
+                                                          float _minAreaFraction,
+                                                          int _maxNumPatches)
+{
+    QVector<PlanarPatch> patches;
+    QVector<QVector<int> > patchTriangles;
+
+    /////////////////////////////////////////////////////////////////
+    // size of the mesh, for the offset quantization
+    QVector3D boundMin(1e10f, 1e10f, 1e10f);
+    QVector3D boundMax(-1e10f, -1e10f, -1e10f);
+
+    for(int i = 0; i < _numIndices; ++i)
+    {
+        const GLfloat* v = &_vertices[3 * _indices[i]];
+        boundMin = QVector3D(fmin(boundMin.x(), v[0]), fmin(boundMin.y(), v[1]),
+                             fmin(boundMin.z(), v[2]));
+        boundMax = QVector3D(fmax(boundMax.x(), v[0]), fmax(boundMax.y(), v[1]),
+                             fmax(boundMax.z(), v[2]));
+    }
+
+    float offsetStep = fmax((boundMax - boundMin).length(), 1e-6f) * 1e-3f;
+
+    /////////////////////////////////////////////////////////////////
+    // weld the vertices
+    QVector<int> weldedIndices(_numIndices);
+    QHash<quint64, int> weldedVertices;
+
+    for(int i = 0; i < _numIndices; ++i)
+    {
+        const GLfloat* v = &_vertices[3 * _indices[i]];
+        quint64 key = (quint64)floor((v[0] - boundMin.x()) / offsetStep + 0.5f) |
+                      ((quint64)floor((v[1] - boundMin.y()) / offsetStep + 0.5f) << 21) |
+                      ((quint64)floor((v[2] - boundMin.z()) / offsetStep + 0.5f) << 42);
+        int vertexIndex = weldedVertices.value(key, -1);
+
+        if(vertexIndex < 0)
+        {
+            vertexIndex = weldedVertices.size();
+            weldedVertices.insert(key, vertexIndex);
+        }
+
+        weldedIndices[i] = vertexIndex;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // cluster the triangles by their plane
+    QVector<QVector4D> clusterPlanes;
+    QVector<QVector<int> > clusterTriangles;
+    QHash<quint64, int> clusterIndices;
+    QVector<float> triangleAreas(_numIndices / 3);
+
+    for(int i = 0; i + 2 < _numIndices; i += 3)
+    {
+        QVector3D v0(_vertices[3 * _indices[i]], _vertices[3 * _indices[i] + 1],
+                     _vertices[3 * _indices[i] + 2]);
+        QVector3D v1(_vertices[3 * _indices[i + 1]], _vertices[3 * _indices[i + 1] + 1],
+                     _vertices[3 * _indices[i + 1] + 2]);
+        QVector3D v2(_vertices[3 * _indices[i + 2]], _vertices[3 * _indices[i + 2] + 1],
+                     _vertices[3 * _indices[i + 2] + 2]);
+        QVector3D normal = QVector3D::crossProduct(v1 - v0, v2 - v0);
+        float doubleArea = normal.length();
+
+        if(doubleArea < 1e-12f)
+        {
+            continue;
+        }
+
+        normal /= doubleArea;
+        float offset = -QVector3D::dotProduct(normal, v0);
+
+        quint64 key = ((quint64)(qint64)floor(normal.x() * 64.0f + 0.5f) & 0xFF) |
+                      (((quint64)(qint64)floor(normal.y() * 64.0f + 0.5f) & 0xFF) << 8) |
+                      (((quint64)(qint64)floor(normal.z() * 64.0f + 0.5f) & 0xFF) << 16) |
+                      (((quint64)(qint64)floor(offset / offsetStep + 0.5f)) << 24);
+
+        int clusterIndex = clusterIndices.value(key, -1);
+
+        if(clusterIndex < 0)
+        {
+            clusterIndex = clusterPlanes.size();
+            clusterIndices.insert(key, clusterIndex);
+            clusterPlanes.append(QVector4D(normal, offset));
+            clusterTriangles.append(QVector<int>());
+        }
+
+        triangleAreas[i / 3] = 0.5f * doubleArea;
+        clusterTriangles[clusterIndex].append(i);
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // split the clusters into the groups of triangles sharing an edge, separate faces lying
+    // in the same plane become separate patches
+    for(int c = 0; c < clusterPlanes.size(); ++c)
+    {
+        const QVector<int>& triangles = clusterTriangles.at(c);
+        QVector<int> parents(triangles.size());
+        QHash<quint64, int> edgeTriangles;
+
+        for(int t = 0; t < triangles.size(); ++t)
+        {
+            parents[t] = t;
+        }
+
+        for(int t = 0; t < triangles.size(); ++t)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                int a = weldedIndices.at(triangles.at(t) + k);
+                int b = weldedIndices.at(triangles.at(t) + (k + 1) % 3);
+                quint64 edge = ((quint64)qMin(a, b) << 32) | (quint64)qMax(a, b);
+                int neighbor = edgeTriangles.value(edge, -1);
+
+                if(neighbor < 0)
+                {
+                    edgeTriangles.insert(edge, t);
+                }
+                else
+                {
+                    parents[findGroup(parents, t)] = findGroup(parents, neighbor);
+                }
+            }
+        }
+
+        QHash<int, int> groupPatches;
+
+        for(int t = 0; t < triangles.size(); ++t)
+        {
+            int group = findGroup(parents, t);
+            int patchIndex = groupPatches.value(group, -1);
+
+            if(patchIndex < 0)
+            {
+                patchIndex = patches.size();
+                groupPatches.insert(group, patchIndex);
+                patches.append(PlanarPatch());
+                patches.last().plane = clusterPlanes.at(c);
+                patchTriangles.append(QVector<int>());
+            }
+
+            patches[patchIndex].area += triangleAreas.at(triangles.at(t) / 3);
+            patchTriangles[patchIndex].append(triangles.at(t));
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // keep the large patches, largest first
+    float totalArea = 0.0f;
+
+    for(int i = 0; i < patches.size(); ++i)
+    {
+        totalArea += patches.at(i).area;
+    }
+
+    QVector<int> order;
+
+    for(int i = 0; i < patches.size(); ++i)
+    {
+        if(patches.at(i).area < _minAreaFraction * totalArea)
+        {
+            continue;
+        }
+
+        int j = order.size();
+        order.append(i);
+
+        while(j > 0 && patches.at(order.at(j - 1)).area < patches.at(i).area)
+        {
+            order[j] = order.at(j - 1);
+            --j;
+        }
+
+        order[j] = i;
+    }
+
+    if(order.size() > _maxNumPatches)
+    {
+        order.resize(_maxNumPatches);
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // bounding rectangle and triangles of each patch in its plane
+    QVector<PlanarPatch> result;
+
+    for(int i = 0; i < order.size(); ++i)
+    {
+        PlanarPatch patch = patches.at(order.at(i));
+        QVector3D normal = patch.plane.toVector3D();
+        QVector3D axis = (fabs(normal.x()) < 0.9f) ? QVector3D(1, 0, 0) : QVector3D(0, 1, 0);
+        QVector3D axisU = QVector3D::crossProduct(normal, axis).normalized();
+        QVector3D axisV = QVector3D::crossProduct(normal, axisU);
+        QVector2D rectMin(1e10f, 1e10f);
+        QVector2D rectMax(-1e10f, -1e10f);
+
+        const QVector<int>& triangles = patchTriangles.at(order.at(i));
+
+        for(int j = 0; j < triangles.size(); ++j)
+        {
+            for(int k = 0; k < 3; ++k)
+            {
+                const GLfloat* v = &_vertices[3 * _indices[triangles.at(j) + k]];
+                QVector3D vertex(v[0], v[1], v[2]);
+                float u = QVector3D::dotProduct(vertex, axisU);
+                float w = QVector3D::dotProduct(vertex, axisV);
+
+                rectMin = QVector2D(fmin(rectMin.x(), u), fmin(rectMin.y(), w));
+                rectMax = QVector2D(fmax(rectMax.x(), u), fmax(rectMax.y(), w));
+                patch.triangles.append(vertex);
+            }
+        }
+
+        patch.origin = -patch.plane.w() * normal + rectMin.x() * axisU + rectMin.y() * axisV;
+        patch.edgeU = (rectMax.x() - rectMin.x()) * axisU;
+        patch.edgeV = (rectMax.y() - rectMin.y()) * axisV;
+        result.append(patch);
+    }
+
+    return result;
+}
@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef PLANARPATCH_H
+#define PLANARPATCH_H
+
+#include <QOpenGLWidget>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+#include <QMatrix4x4>
+
+//------------------------------------------------------------------------------------------
+// A flat part of a mesh, a connected set of coplanar triangles. It is bounded by a
+// rectangle in its plane, spanned from the origin by the two edge vectors, and keeps the
+// corners of its triangles, 3 per triangle.
+//------------------------------------------------------------------------------------------
+struct PlanarPatch
+{
+    PlanarPatch():
+        area(0.0f) {}
+
+    PlanarPatch transformed(const QMatrix4x4& _modelMatrix) const;
+
+    QVector4D plane; // unit normal and offset, dot(normal, p) + w = 0 on the plane
+    QVector3D origin;
+    QVector3D edgeU;
+    QVector3D edgeV;
+    float area;
+    QVector<QVector3D> triangles;
+};
+
+//------------------------------------------------------------------------------------------
+// Clusters the triangles of an indexed mesh by their quantized plane equation, splits the
+// clusters into the groups of triangles connected by their edges, and keeps the groups
+// covering at least a fraction of the mesh surface, largest first.
+//------------------------------------------------------------------------------------------
+class PlanarPatchExtractor
+{
+public:
+    static QVector<PlanarPatch> extractPatches(const GLfloat* _vertices,
+                                               const GLushort* _indices, int _numIndices,
+                                               float _minAreaFraction, int _maxNumPatches);
+};
+
+#endif // PLANARPATCH_H
@@ -0,0 +1,460 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "profiler.h"
+
+#include <QFile>
+#include <QTextStream>
+
+//------------------------------------------------------------------------------------------
+Profiler::Scope::Scope(Profiler* _profiler, const char* _name):
+    profiler(_profiler),
+    name(_name)
+{
+    cpuBegin = profiler->getCPUTime();
+    inFrame = profiler->beginScope(_name);
+}
+
+//------------------------------------------------------------------------------------------
+// a scope outside of the frames only has a CPU time, kept while tracing
+//------------------------------------------------------------------------------------------
+Profiler::Scope::~Scope()
+{
+    if(inFrame)
+    {
+        profiler->endScope();
+    }
+    else
+    {
+        profiler->traceCPUEvent(name, cpuBegin);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+Profiler::Profiler():
+    gl(NULL),
+    enabled(false),
+    inFrame(false),
+    currentFrame(0),
+    gpuToCPUOffset(0),
+    lastClockSyncTime(0),
+    clockSynced(false),
+    tracing(false),
+    numDrawCalls(0),
+    numTriangles(0),
+    numStateChanges(0)
+{
+    cpuTimer.start();
+}
+
+//------------------------------------------------------------------------------------------
+// the functions must be initialized on the context the frames are drawn with
+//------------------------------------------------------------------------------------------
+void Profiler::initialize(QOpenGLFunctions_4_0_Core* _functions)
+{
+    gl = _functions;
+
+    for(int i = 0; i < NUM_PROFILER_FRAMES; ++i)
+    {
+        gl->glGenQueries(1, &frames[i].primitivesQuery);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::setEnabled(bool _state)
+{
+    enabled = _state;
+
+    if(!isActive())
+    {
+        for(int i = 0; i < NUM_PROFILER_FRAMES; ++i)
+        {
+            frames[i].issued = false;
+        }
+
+        scopeTimings.clear();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+bool Profiler::isEnabled()
+{
+    return enabled;
+}
+
+//------------------------------------------------------------------------------------------
+// the frames are profiled for the overlay or the trace
+//------------------------------------------------------------------------------------------
+bool Profiler::isActive()
+{
+    return enabled || tracing;
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::startTrace()
+{
+    traceEvents.clear();
+    traceFrameBegins.clear();
+    tracing = true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Profiler::isTracing()
+{
+    return tracing;
+}
+
+//------------------------------------------------------------------------------------------
+// Ends the trace. The frames still in flight are waited for, oldest first, so a short run
+// such as a single headless frame is not lost; the context must be current. The timestamps
+// of the trace-event format are in microseconds; the interval between the frames is written
+// as a counter, which shows the jitter of the frame cadence.
+//------------------------------------------------------------------------------------------
+bool Profiler::writeTrace(const QString& _fileName)
+{
+    if(gl && !inFrame)
+    {
+        for(int i = 0; i < NUM_PROFILER_FRAMES; ++i)
+        {
+            FrameRecord& frame = frames[(currentFrame + i) % NUM_PROFILER_FRAMES];
+
+            if(frame.issued)
+            {
+                collectFrame(frame, true);
+                frame.issued = false;
+            }
+        }
+    }
+
+    tracing = false;
+    setEnabled(enabled);
+
+    QFile file(_fileName);
+
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+           << TRACE_CPU_THREAD << ", \"args\": {\"name\": \"CPU\"}},\n";
+    stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+           << TRACE_GPU_THREAD << ", \"args\": {\"name\": \"GPU\"}},\n";
+    stream << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+           << TRACE_LOADER_THREAD << ", \"args\": {\"name\": \"Loader\"}}";
+
+    for(int i = 0; i < traceEvents.size(); ++i)
+    {
+        const TraceEvent& event = traceEvents.at(i);
+        stream << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, "
+               << "\"tid\": " << event.thread << ", "
+               << "\"ts\": " << QString::number(event.begin * 1e-3, 'f', 3) << ", "
+               << "\"dur\": " << QString::number(event.duration * 1e-3, 'f', 3) << "}";
+    }
+
+    for(int i = 1; i < traceFrameBegins.size(); ++i)
+    {
+        stream << ",\n{\"name\": \"frameInterval\", \"ph\": \"C\", \"pid\": 1, "
+               << "\"ts\": " << QString::number(traceFrameBegins.at(i) * 1e-3, 'f', 3) << ", "
+               << "\"args\": {\"ms\": "
+               << QString::number((traceFrameBegins.at(i) - traceFrameBegins.at(i - 1)) * 1e-6,
+                                  'f', 3)
+               << "}}";
+    }
+
+    stream << "\n]}\n";
+
+    traceEvents.clear();
+    traceFrameBegins.clear();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+// the slot of the frame is the oldest one, its results are collected before it is reused
+//------------------------------------------------------------------------------------------
+void Profiler::beginFrame()
+{
+    if(!isActive() || !gl)
+    {
+        return;
+    }
+
+    FrameRecord& frame = frames[currentFrame];
+
+    if(frame.issued)
+    {
+        collectFrame(frame, false);
+    }
+
+    frame.scopes.clear();
+    frame.cpuBegin = getCPUTime();
+
+    if(tracing)
+    {
+        traceFrameBegins.append(frame.cpuBegin);
+    }
+
+    frame.numQueries = 0;
+    frame.numDrawCalls = 0;
+    frame.numStateChanges = 0;
+    frame.issued = false;
+    openScopes.clear();
+
+    // the GPU clock differs from the CPU one, both are read at once for the trace; the read
+    // waits for the GPU, so the offset is only resampled now and then as the clocks drift
+    if(!clockSynced || frame.cpuBegin - lastClockSyncTime >= PROFILER_CLOCK_SYNC_INTERVAL)
+    {
+        GLint64 gpuTime = 0;
+        gl->glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        gpuToCPUOffset = getCPUTime() - gpuTime;
+        lastClockSyncTime = frame.cpuBegin;
+        clockSynced = true;
+    }
+
+    frame.gpuToCPUOffset = gpuToCPUOffset;
+
+    gl->glBeginQuery(GL_PRIMITIVES_GENERATED, frame.primitivesQuery);
+    inFrame = true;
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::endFrame()
+{
+    if(!inFrame)
+    {
+        return;
+    }
+
+    // scopes left open are closed with the frame
+    while(!openScopes.isEmpty())
+    {
+        endScope();
+    }
+
+    gl->glEndQuery(GL_PRIMITIVES_GENERATED);
+
+    frames[currentFrame].cpuEnd = getCPUTime();
+    frames[currentFrame].issued = true;
+    currentFrame = (currentFrame + 1) % NUM_PROFILER_FRAMES;
+    inFrame = false;
+}
+
+//------------------------------------------------------------------------------------------
+bool Profiler::beginScope(const char* _name)
+{
+    if(!inFrame)
+    {
+        return false;
+    }
+
+    FrameRecord& frame = frames[currentFrame];
+    ScopeRecord scope;
+    scope.name = _name;
+    scope.depth = openScopes.size();
+    scope.cpuBegin = getCPUTime();
+    scope.cpuEnd = scope.cpuBegin;
+    scope.beginQuery = issueTimestamp();
+    scope.endQuery = scope.beginQuery;
+
+    openScopes.append(frame.scopes.size());
+    frame.scopes.append(scope);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::endScope()
+{
+    if(!inFrame || openScopes.isEmpty())
+    {
+        return;
+    }
+
+    ScopeRecord& scope = frames[currentFrame].scopes[openScopes.last()];
+    scope.cpuEnd = getCPUTime();
+    scope.endQuery = issueTimestamp();
+    openScopes.removeLast();
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::traceCPUEvent(const char* _name, qint64 _cpuBegin)
+{
+    if(tracing)
+    {
+        addTraceEvent(_name, TRACE_CPU_THREAD, _cpuBegin, getCPUTime() - _cpuBegin);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// the times were taken on the loader thread with getCPUTime(), which only reads the timer
+//------------------------------------------------------------------------------------------
+void Profiler::traceLoaderEvent(const char* _name, qint64 _cpuBegin, qint64 _cpuEnd)
+{
+    if(tracing)
+    {
+        addTraceEvent(_name, TRACE_LOADER_THREAD, _cpuBegin, _cpuEnd - _cpuBegin);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+qint64 Profiler::getCPUTime()
+{
+    return cpuTimer.nsecsElapsed();
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::countDrawCall()
+{
+    if(inFrame)
+    {
+        ++frames[currentFrame].numDrawCalls;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::countStateChange()
+{
+    if(inFrame)
+    {
+        ++frames[currentFrame].numStateChanges;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+const QVector<Profiler::ScopeTiming>& Profiler::getScopeTimings()
+{
+    return scopeTimings;
+}
+
+//------------------------------------------------------------------------------------------
+int Profiler::getNumDrawCalls()
+{
+    return numDrawCalls;
+}
+
+//------------------------------------------------------------------------------------------
+int Profiler::getNumTriangles()
+{
+    return numTriangles;
+}
+
+//------------------------------------------------------------------------------------------
+int Profiler::getNumStateChanges()
+{
+    return numStateChanges;
+}
+
+//------------------------------------------------------------------------------------------
+// the query pool of a frame grows to the largest number of scopes seen
+//------------------------------------------------------------------------------------------
+int Profiler::issueTimestamp()
+{
+    FrameRecord& frame = frames[currentFrame];
+
+    if(frame.numQueries == frame.queries.size())
+    {
+        GLuint query;
+        gl->glGenQueries(1, &query);
+        frame.queries.append(query);
+    }
+
+    gl->glQueryCounter(frame.queries.at(frame.numQueries), GL_TIMESTAMP);
+
+    return frame.numQueries++;
+}
+
+//------------------------------------------------------------------------------------------
+// reading the results of a waited frame blocks until the GPU is done with it
+//------------------------------------------------------------------------------------------
+void Profiler::collectFrame(FrameRecord& _frame, bool _wait)
+{
+    GLint available = _wait;
+
+    if(!_wait)
+    {
+        gl->glGetQueryObjectiv(_frame.primitivesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+
+    // the queries complete in order, so the last one tells for all of them
+    if(!_wait && available && _frame.numQueries > 0)
+    {
+        gl->glGetQueryObjectiv(_frame.queries.at(_frame.numQueries - 1),
+                               GL_QUERY_RESULT_AVAILABLE, &available);
+    }
+
+    if(!available)
+    {
+        return;
+    }
+
+    QVector<GLuint64> timestamps(_frame.numQueries);
+
+    for(int i = 0; i < _frame.numQueries; ++i)
+    {
+        gl->glGetQueryObjectui64v(_frame.queries.at(i), GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    scopeTimings.resize(_frame.scopes.size());
+
+    for(int i = 0; i < _frame.scopes.size(); ++i)
+    {
+        const ScopeRecord& scope = _frame.scopes.at(i);
+        ScopeTiming& timing = scopeTimings[i];
+
+        timing.name = scope.name;
+        timing.depth = scope.depth;
+        timing.cpuTime = (scope.cpuEnd - scope.cpuBegin) * 1e-6;
+        timing.gpuTime = (timestamps.at(scope.endQuery) - timestamps.at(scope.beginQuery)) *
+                         1e-6;
+    }
+
+    GLuint numPrimitives = 0;
+    gl->glGetQueryObjectuiv(_frame.primitivesQuery, GL_QUERY_RESULT, &numPrimitives);
+
+    numTriangles = numPrimitives;
+    numDrawCalls = _frame.numDrawCalls;
+    numStateChanges = _frame.numStateChanges;
+
+    if(!tracing)
+    {
+        return;
+    }
+
+    addTraceEvent("frame", TRACE_CPU_THREAD, _frame.cpuBegin,
+                  _frame.cpuEnd - _frame.cpuBegin);
+
+    for(int i = 0; i < _frame.scopes.size(); ++i)
+    {
+        const ScopeRecord& scope = _frame.scopes.at(i);
+        addTraceEvent(scope.name, TRACE_CPU_THREAD, scope.cpuBegin,
+                      scope.cpuEnd - scope.cpuBegin);
+        addTraceEvent(scope.name, TRACE_GPU_THREAD,
+                      timestamps.at(scope.beginQuery) + _frame.gpuToCPUOffset,
+                      timestamps.at(scope.endQuery) - timestamps.at(scope.beginQuery));
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Profiler::addTraceEvent(const char* _name, int _thread, qint64 _begin,
+                             qint64 _duration)
+{
+    if(traceEvents.size() >= MAX_NUM_TRACE_EVENTS)
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.name = _name;
+    event.thread = _thread;
+    event.begin = _begin;
+    event.duration = _duration;
+    traceEvents.append(event);
+}
@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QVector>
+#include <QString>
+#include <QElapsedTimer>
+#include <QOpenGLFunctions_4_0_Core>
+
+#define NUM_PROFILER_FRAMES 3
+#define MAX_NUM_TRACE_EVENTS 1000000
+#define PROFILER_CLOCK_SYNC_INTERVAL 1000000000 // ns
+
+//------------------------------------------------------------------------------------------
+// Hierarchical CPU and GPU timings of the scopes of a frame. Every scope takes a CPU time
+// and a GL_TIMESTAMP query at its begin and end. The queries of a frame are read back
+// NUM_PROFILER_FRAMES - 1 frames later, when the GPU is done with them, so reading never
+// stalls; a frame whose queries are still pending is dropped. Only writing a trace waits
+// for the frames in flight. A GL_PRIMITIVES_GENERATED query around the frame counts the
+// triangles, the draw calls and state changes are counted by the caller.
+//
+// While a trace is recorded, the collected scopes are also kept as events on a CPU and a
+// GPU timeline, together with the CPU scopes outside of the frames such as the mesh
+// uploads, and written as Chrome trace-event JSON. The profiler is used from the render
+// thread only; the mesh loader times its loads on its own thread and hands the times over,
+// they are traced on a loader timeline. The offset between the GPU and the CPU clock is
+// read synchronously, so it is only sampled once every PROFILER_CLOCK_SYNC_INTERVAL.
+//------------------------------------------------------------------------------------------
+class Profiler
+{
+public:
+    // marks the enclosing block as a scope of the current frame
+    class Scope
+    {
+    public:
+        Scope(Profiler* _profiler, const char* _name);
+        ~Scope();
+
+    private:
+        Profiler* profiler;
+        const char* name;
+        qint64 cpuBegin;
+        bool inFrame;
+    };
+
+    struct ScopeTiming
+    {
+        const char* name;
+        int depth;
+        double cpuTime; // ms
+        double gpuTime; // ms
+    };
+
+    Profiler();
+
+    void initialize(QOpenGLFunctions_4_0_Core* _functions);
+    void setEnabled(bool _state);
+    bool isEnabled();
+
+    void startTrace();
+    bool isTracing();
+    bool writeTrace(const QString& _fileName);
+
+    void beginFrame();
+    void endFrame();
+    bool beginScope(const char* _name);
+    void endScope();
+    void traceCPUEvent(const char* _name, qint64 _cpuBegin);
+    void traceLoaderEvent(const char* _name, qint64 _cpuBegin, qint64 _cpuEnd);
+    qint64 getCPUTime();
+    void countDrawCall();
+    void countStateChange();
+
+    const QVector<ScopeTiming>& getScopeTimings();
+    int getNumDrawCalls();
+    int getNumTriangles();
+    int getNumStateChanges();
+
+private:
+    struct ScopeRecord
+    {
+        const char* name;
+        int depth;
+        qint64 cpuBegin;
+        qint64 cpuEnd;
+        int beginQuery;
+        int endQuery;
+    };
+
+    struct FrameRecord
+    {
+        FrameRecord():
+            cpuBegin(0),
+            cpuEnd(0),
+            gpuToCPUOffset(0),
+            numQueries(0),
+            primitivesQuery(0),
+            numDrawCalls(0),
+            numStateChanges(0),
+            issued(false) {}
+
+        QVector<ScopeRecord> scopes;
+        qint64 cpuBegin;
+        qint64 cpuEnd;
+        qint64 gpuToCPUOffset;
+        QVector<GLuint> queries;
+        int numQueries;
+        GLuint primitivesQuery;
+        int numDrawCalls;
+        int numStateChanges;
+        bool issued;
+    };
+
+    // ns on the CPU timeline, the GPU times are moved onto it
+    struct TraceEvent
+    {
+        const char* name;
+        int thread;
+        qint64 begin;
+        qint64 duration;
+    };
+
+    enum TraceThread
+    {
+        TRACE_CPU_THREAD = 1,
+        TRACE_GPU_THREAD,
+        TRACE_LOADER_THREAD
+    };
+
+    bool isActive();
+    int issueTimestamp();
+    void collectFrame(FrameRecord& _frame, bool _wait);
+    void addTraceEvent(const char* _name, int _thread, qint64 _begin, qint64 _duration);
+
+    QOpenGLFunctions_4_0_Core* gl;
+    bool enabled;
+    bool inFrame;
+    QElapsedTimer cpuTimer;
+    FrameRecord frames[NUM_PROFILER_FRAMES];
+    int currentFrame;
+    QVector<int> openScopes;
+    qint64 gpuToCPUOffset;
+    qint64 lastClockSyncTime;
+    bool clockSynced;
+
+    bool tracing;
+    QVector<TraceEvent> traceEvents;
+    QVector<qint64> traceFrameBegins;
+
+    // results of the last collected frame
+    QVector<ScopeTiming> scopeTimings;
+    int numDrawCalls;
+    int numTriangles;
+    int numStateChanges;
+};
+
+#endif // PROFILER_H
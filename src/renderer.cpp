@@ -7,6 +7,11 @@
 //------------------------------------------------------------------------------------------
 
 #include "renderer.h"
+#include "renderthread.h"
+#include "meshloader.h"
+#include "texturestreamer.h"
+
+#include <random>
 
 //------------------------------------------------------------------------------------------
 Renderer::Renderer(QWidget* _parent):
@@ -17,11 +22,29 @@ Renderer::Renderer(QWidget* _parent):
     enabledZAxisRotation(false),
     enabledTextureAnisotropicFiltering(true),
     enabledShowShadowVolume(false),
+    enabledBatchedProjectiveShadow(false),
+    enabledPointLightShadowVolumes(false),
+    enabledMultiDrawIndirect(false),
+    enabledFrustumCulling(false),
+    enabledOcclusionCulling(false),
+    enabledDepthPrePass(false),
+    enabledShadingVariants(true),
+    enabledRenderQueue(false),
+    enabledDeferredShading(false),
+    enabledClusteredShading(false),
+    enabledProfilerOverlay(false),
+    depthFuncBeforePrePass(GL_LESS),
     currentShadowMode(NO_SHADOW),
     iboRoom(QOpenGLBuffer::IndexBuffer),
     iboCube(QOpenGLBuffer::IndexBuffer),
     iboMeshObject(QOpenGLBuffer::IndexBuffer),
     iboBillboard(QOpenGLBuffer::IndexBuffer),
+    iboSceneGeometry(QOpenGLBuffer::IndexBuffer),
+    iboPointLightVolume(QOpenGLBuffer::IndexBuffer),
+    indirectDrawBuffer(0),
+    numSceneVertices(0),
+    multiDrawFunctions(NULL),
+    depthBoundsFunction(NULL),
     specialKeyPressed(Renderer::NO_KEY),
     mouseButtonPressed(Renderer::NO_BUTTON),
     translation(0.0f, 0.0f, 0.0f),
@@ -31,18 +54,71 @@ Renderer::Renderer(QWidget* _parent):
     zooming(0.0f),
     planeObject(NULL),
     cubeObject(NULL),
-    objLoader(NULL),
+    sphereObject(NULL),
+    meshLoader(NULL),
+    textureStreamer(NULL),
+    pboTextureUpload(0),
+    shadingFeatures(0),
+    currentMaterialBinding(BINDING_ROOM_MATERIAL),
+    currentInstancedDraw(false),
     depthTexture(NULL),
     FBODepthMap(NULL),
+    FBOGBuffer(NULL),
+    gBufferDepthTexture(NULL),
+    FBOReceiverId(NULL),
     cameraPosition(DEFAULT_CAMERA_POSITION),
     cameraFocus(DEFAULT_CAMERA_FOCUS),
     cameraUpDirection(0.0f, 1.0f, 0.0f),
+    updateTimeAccumulator(0),
+    previousCameraPosition(DEFAULT_CAMERA_POSITION),
+    previousCameraFocus(DEFAULT_CAMERA_FOCUS),
+    previousCameraUpDirection(0.0f, 1.0f, 0.0f),
+    steppedCameraPosition(DEFAULT_CAMERA_POSITION),
+    steppedCameraFocus(DEFAULT_CAMERA_FOCUS),
+    steppedCameraUpDirection(0.0f, 1.0f, 0.0f),
     currentShadingMode(PHONG_SHADING),
     currentFloorTexture(WOOD1),
     currentMeshObject(TEAPOT_OBJ),
     currentMouseTransTarget(TRANSFORM_CAMERA),
-    ambientLight(0.4)
+    ambientLight(0.4),
+    roomSize(1.0f),
+    numInstances(DEFAULT_NUM_INSTANCES),
+    numPointLights(DEFAULT_NUM_POINT_LIGHTS),
+    numShadowLights(DEFAULT_NUM_SHADOW_LIGHTS),
+    shadowAtlas(SHADOW_ATLAS_SIZE, MIN_SHADOW_TILE_SIZE, MAX_SHADOW_TILE_SIZE),
+    numClusterTilesX(0),
+    numClusterTilesY(0),
+    clusterSliceScale(1.0f),
+    instanceScale(1.0f),
+    currentCullingPass(UNCULLED_PASS),
+    numOccludedObjects(0),
+    headlessContext(NULL),
+    headlessFramebuffer(NULL),
+    enabledRenderThread(false),
+    renderThread(NULL),
+    animating(0),
+    enabledGPUTimers(false),
+    numIssuedTimerQueries(0),
+    currentTimedPass(NO_TIMED_PASS)
 {
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        numUploadedInstances[i] = 0;
+        instanceUploadPass[i] = UNCULLED_PASS;
+        instanceGroupDepth[i] = 0.0f;
+    }
+
+    for(int i = 0; i < NUM_CULLING_PASSES; ++i)
+    {
+        for(int j = 0; j < NUM_SCENE_OBJECTS; ++j)
+        {
+            sceneObjectVisible[i][j] = true;
+        }
+
+        numDrawnObjects[i] = 0;
+        numCulledObjects[i] = 0;
+    }
+
     retinaScale = devicePixelRatio();
     setFocusPolicy(Qt::StrongFocus);
 }
@@ -50,6 +126,9 @@ Renderer::Renderer(QWidget* _parent):
 //------------------------------------------------------------------------------------------
 Renderer::~Renderer()
 {
+    delete meshLoader;
+    delete textureStreamer;
+    delete renderThread;
 }
 
 //------------------------------------------------------------------------------------------
@@ -137,11 +216,43 @@ void Renderer::initScene()
     initSceneMemory();
     initVertexArrayObjects();
     initSharedBlockUniform();
+    initClusteredLighting();
+    initShadowLights();
     initSceneMatrices();
 
     glEnable(GL_DEPTH_TEST);
     setShadingMode(PHONG_SHADING);
 }
+//------------------------------------------------------------------------------------------
+// The shaders are added as source code to be linked from the program binary cache of Qt,
+// which is stored in the cache directory, keyed by the sources and checked against the GL
+// vendor, renderer and version. When there is no binary or the driver rejects it, the
+// shaders are compiled and linked, and the cache entry is written anew.
+// The defines are inserted after the version directive, so every variant of a shader is
+// cached on its own.
+//------------------------------------------------------------------------------------------
+bool Renderer::addCachedShader(QOpenGLShaderProgram* _program,
+                               QOpenGLShader::ShaderType _type, const QString& _fileName,
+                               const QByteArray& _defines)
+{
+    QFile file(_fileName);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QByteArray source = file.readAll();
+
+    if(!_defines.isEmpty())
+    {
+        int versionEnd = source.startsWith("#version") ? source.indexOf('\n') + 1 : 0;
+        source.insert(versionEnd, _defines);
+    }
+
+    return _program->addCacheableShaderFromSourceCode(_type, source);
+}
+
 //------------------------------------------------------------------------------------------
 bool Renderer::initProgram(ShadingProgram _shadingMode)
 {
@@ -153,12 +264,12 @@ bool Renderer::initProgram(ShadingProgram _shadingMode)
     program = glslPrograms[_shadingMode];
     bool success;
 
-    success = program->addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                               vertexShaderSourceMap.value(_shadingMode));
+    success = addCachedShader(program, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(_shadingMode));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
-    success = program->addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                               fragmentShaderSourceMap.value(_shadingMode));
+    success = addCachedShader(program, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(_shadingMode));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
     success = program->link();
@@ -176,6 +287,14 @@ bool Renderer::initProgram(ShadingProgram _shadingMode)
     TRUE_OR_DIE(location >= 0, "Cannot bind attribute texture coordinate.");
     attrTexCoord[_shadingMode] = location;
 
+    location = program->attributeLocation("v_instanceModelMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance model matrix.");
+    attrInstanceModelMatrix[_shadingMode] = location;
+
+    location = program->attributeLocation("v_instanceNormalMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance normal matrix.");
+    attrInstanceNormalMatrix[_shadingMode] = location;
+
 
     location = glGetUniformBlockIndex(program->programId(), "Matrices");
     TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
@@ -186,6 +305,10 @@ bool Renderer::initProgram(ShadingProgram _shadingMode)
     TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
     uniLight[_shadingMode] = location;
 
+    location = glGetUniformBlockIndex(program->programId(), "ShadowLights");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniShadowLights[_shadingMode] = location;
+
 
     location = glGetUniformBlockIndex(program->programId(), "Material");
     TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
@@ -220,6 +343,10 @@ bool Renderer::initProgram(ShadingProgram _shadingMode)
     TRUE_OR_DIE(location >= 0, "Cannot bind uniform hasDepthTex.");
     uniHasDepthTexture[_shadingMode] = location;
 
+    location = program->uniformLocation("instancedDraw");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform instancedDraw.");
+    uniInstancedDraw[_shadingMode] = location;
+
     return true;
 }
 
@@ -231,12 +358,12 @@ bool Renderer::initLightShadingProgram()
     QOpenGLShaderProgram* program = glslPrograms[LIGHT_SHADING];
     bool success;
 
-    success = program->addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                               vertexShaderSourceMap.value(LIGHT_SHADING));
+    success = addCachedShader(program, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(LIGHT_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
-    success = program->addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                               fragmentShaderSourceMap.value(LIGHT_SHADING));
+    success = addCachedShader(program, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(LIGHT_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
     success = program->link();
@@ -262,12 +389,16 @@ bool Renderer::initProjectedObjectShadingProgram()
     projectedShadowProgram = glslPrograms[PROJECTED_OBJECT_SHADING];
     bool success;
 
-    success = projectedShadowProgram->addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                                              vertexShaderSourceMap.value(PROJECTED_OBJECT_SHADING));
+    success = addCachedShader(projectedShadowProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(PROJECTED_OBJECT_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
-    success = projectedShadowProgram->addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                                              fragmentShaderSourceMap.value(PROJECTED_OBJECT_SHADING));
+    success = addCachedShader(projectedShadowProgram, QOpenGLShader::Geometry,
+                              geometryShaderSourceMap.value(PROJECTED_OBJECT_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(projectedShadowProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(PROJECTED_OBJECT_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
     success = projectedShadowProgram->link();
@@ -277,6 +408,10 @@ bool Renderer::initProjectedObjectShadingProgram()
     TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex coordinate.");
     attrVertex[PROJECTED_OBJECT_SHADING] = location;
 
+    location = projectedShadowProgram->attributeLocation("v_instanceModelMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance model matrix.");
+    attrInstanceModelMatrix[PROJECTED_OBJECT_SHADING] = location;
+
     location = glGetUniformBlockIndex(projectedShadowProgram->programId(), "Matrices");
     TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
     uniMatrices[PROJECTED_OBJECT_SHADING] = location;
@@ -293,6 +428,38 @@ bool Renderer::initProjectedObjectShadingProgram()
     TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
     uniShadowIntensity = location;
 
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "planeVectors");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniPlaneVectors = location;
+
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "batchedPlanes");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniBatchedPlanes = location;
+
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "numReceivers");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniNumReceivers = location;
+
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "receiverOrigins");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniReceiverOrigins = location;
+
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "receiverAxesU");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniReceiverAxesU = location;
+
+    location = glGetUniformLocation(projectedShadowProgram->programId(), "receiverAxesV");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform.");
+    uniReceiverAxesV = location;
+
+    location = projectedShadowProgram->uniformLocation("instancedDraw");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform instancedDraw.");
+    uniInstancedDraw[PROJECTED_OBJECT_SHADING] = location;
+
+    projectedShadowProgram->bind();
+    projectedShadowProgram->setUniformValue("receiverIdTex", 0);
+    projectedShadowProgram->release();
+
     return true;
 }
 
@@ -304,12 +471,12 @@ bool Renderer::initShadowMapShadingProgram()
     shadowMapProgram = glslPrograms[SHADOW_MAP_SHADING];
     bool success;
 
-    success = shadowMapProgram->addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                                        vertexShaderSourceMap.value(SHADOW_MAP_SHADING));
+    success = addCachedShader(shadowMapProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(SHADOW_MAP_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
-    success = shadowMapProgram->addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                                        fragmentShaderSourceMap.value(SHADOW_MAP_SHADING));
+    success = addCachedShader(shadowMapProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(SHADOW_MAP_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
     success = shadowMapProgram->link();
@@ -323,6 +490,10 @@ bool Renderer::initShadowMapShadingProgram()
     TRUE_OR_DIE(location >= 0, "Cannot bind attribute texture coordinate.");
     attrTexCoord[SHADOW_MAP_SHADING] = location;
 
+    location = shadowMapProgram->attributeLocation("v_instanceModelMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance model matrix.");
+    attrInstanceModelMatrix[SHADOW_MAP_SHADING] = location;
+
     location = glGetUniformBlockIndex(shadowMapProgram->programId(), "Matrices");
     TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
     uniMatrices[SHADOW_MAP_SHADING] = location;
@@ -335,6 +506,14 @@ bool Renderer::initShadowMapShadingProgram()
     TRUE_OR_DIE(location >= 0, "Cannot bind uniform hasObjTex.");
     uniHasObjTexture[SHADOW_MAP_SHADING] = location;
 
+    location = shadowMapProgram->uniformLocation("instancedDraw");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform instancedDraw.");
+    uniInstancedDraw[SHADOW_MAP_SHADING] = location;
+
+    location = shadowMapProgram->uniformLocation("cameraView");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform cameraView.");
+    uniCameraView = location;
+
     return true;
 }
 
@@ -346,12 +525,12 @@ bool Renderer::initShadowVolumeShadingProgram()
     shadowVolumeProgram = glslPrograms[SHADOW_VOLUME_SHADING];
     bool success;
 
-    success = shadowVolumeProgram->addShaderFromSourceFile(QOpenGLShader::Vertex,
-                                                           vertexShaderSourceMap.value(SHADOW_VOLUME_SHADING));
+    success = addCachedShader(shadowVolumeProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(SHADOW_VOLUME_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
-    success = shadowVolumeProgram->addShaderFromSourceFile(QOpenGLShader::Fragment,
-                                                           fragmentShaderSourceMap.value(SHADOW_VOLUME_SHADING));
+    success = addCachedShader(shadowVolumeProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(SHADOW_VOLUME_SHADING));
     TRUE_OR_DIE(success, "Cannot compile shader from file.");
 
     success = shadowVolumeProgram->link();
@@ -369,6 +548,250 @@ bool Renderer::initShadowVolumeShadingProgram()
     return true;
 }
 
+//------------------------------------------------------------------------------------------
+bool Renderer::initOcclusionQueryShadingProgram()
+{
+    GLint location;
+    glslPrograms[OCCLUSION_QUERY_SHADING] = new QOpenGLShaderProgram;
+    occlusionQueryProgram = glslPrograms[OCCLUSION_QUERY_SHADING];
+    bool success;
+
+    success = addCachedShader(occlusionQueryProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(OCCLUSION_QUERY_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(occlusionQueryProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(OCCLUSION_QUERY_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = occlusionQueryProgram->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    location = occlusionQueryProgram->attributeLocation("v_coord");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex coordinate.");
+    attrVertex[OCCLUSION_QUERY_SHADING] = location;
+
+    location = occlusionQueryProgram->uniformLocation("boxMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform boxMatrix.");
+    uniBoxMatrix = location;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::initGBufferShadingProgram()
+{
+    GLint location;
+    glslPrograms[GBUFFER_SHADING] = new QOpenGLShaderProgram;
+    gBufferProgram = glslPrograms[GBUFFER_SHADING];
+    bool success;
+
+    success = addCachedShader(gBufferProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(GBUFFER_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(gBufferProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(GBUFFER_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = gBufferProgram->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    location = gBufferProgram->attributeLocation("v_coord");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex coordinate.");
+    attrVertex[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->attributeLocation("v_normal");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex normal.");
+    attrNormal[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->attributeLocation("v_texCoord");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute texture coordinate.");
+    attrTexCoord[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->attributeLocation("v_instanceModelMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance model matrix.");
+    attrInstanceModelMatrix[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->attributeLocation("v_instanceNormalMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute instance normal matrix.");
+    attrInstanceNormalMatrix[GBUFFER_SHADING] = location;
+
+    location = glGetUniformBlockIndex(gBufferProgram->programId(), "Matrices");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniMatrices[GBUFFER_SHADING] = location;
+
+    location = glGetUniformBlockIndex(gBufferProgram->programId(), "Material");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniMaterial[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->uniformLocation("objTex");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform objTex.");
+    uniObjTexture[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->uniformLocation("hasObjTex");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform hasObjTex.");
+    uniHasObjTexture[GBUFFER_SHADING] = location;
+
+    location = gBufferProgram->uniformLocation("instancedDraw");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform instancedDraw.");
+    uniInstancedDraw[GBUFFER_SHADING] = location;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::initDeferredLightingShadingProgram()
+{
+    GLint location;
+    glslPrograms[DEFERRED_LIGHTING_SHADING] = new QOpenGLShaderProgram;
+    deferredLightingProgram = glslPrograms[DEFERRED_LIGHTING_SHADING];
+    bool success;
+
+    success = addCachedShader(deferredLightingProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(DEFERRED_LIGHTING_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(deferredLightingProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(DEFERRED_LIGHTING_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = deferredLightingProgram->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    location = glGetUniformBlockIndex(deferredLightingProgram->programId(), "Matrices");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniMatrices[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = glGetUniformBlockIndex(deferredLightingProgram->programId(), "Light");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniLight[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = glGetUniformBlockIndex(deferredLightingProgram->programId(), "ShadowLights");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniShadowLights[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = deferredLightingProgram->uniformLocation("cameraPosition");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform cameraPosition.");
+    uniCameraPosition[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = deferredLightingProgram->uniformLocation("ambientLight");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform ambientLight.");
+    uniAmbientLight[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = deferredLightingProgram->uniformLocation("depthTex");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform depthTex.");
+    uniDepthTexture[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = deferredLightingProgram->uniformLocation("hasDepthTex");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform hasDepthTex.");
+    uniHasDepthTexture[DEFERRED_LIGHTING_SHADING] = location;
+
+    location = deferredLightingProgram->uniformLocation("inverseViewProjectionMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform inverseViewProjectionMatrix.");
+    uniInverseViewProjection[DEFERRED_LIGHTING_SHADING] = location;
+
+    setGBufferSamplers(deferredLightingProgram);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::initPointLightShadingProgram()
+{
+    GLint location;
+    glslPrograms[POINT_LIGHT_SHADING] = new QOpenGLShaderProgram;
+    pointLightProgram = glslPrograms[POINT_LIGHT_SHADING];
+    bool success;
+
+    success = addCachedShader(pointLightProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(POINT_LIGHT_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(pointLightProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(POINT_LIGHT_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = pointLightProgram->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    location = pointLightProgram->attributeLocation("v_coord");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex coordinate.");
+    attrVertex[POINT_LIGHT_SHADING] = location;
+
+    location = pointLightProgram->attributeLocation("v_lightPosition");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute light position.");
+    attrPointLightPosition = location;
+
+    location = pointLightProgram->attributeLocation("v_lightColor");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute light color.");
+    attrPointLightColor = location;
+
+    location = glGetUniformBlockIndex(pointLightProgram->programId(), "Matrices");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniMatrices[POINT_LIGHT_SHADING] = location;
+
+    location = pointLightProgram->uniformLocation("cameraPosition");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform cameraPosition.");
+    uniCameraPosition[POINT_LIGHT_SHADING] = location;
+
+    location = pointLightProgram->uniformLocation("inverseViewProjectionMatrix");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform inverseViewProjectionMatrix.");
+    uniInverseViewProjection[POINT_LIGHT_SHADING] = location;
+
+    setGBufferSamplers(pointLightProgram);
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::initReceiverIdShadingProgram()
+{
+    GLint location;
+    glslPrograms[RECEIVER_ID_SHADING] = new QOpenGLShaderProgram;
+    receiverIdProgram = glslPrograms[RECEIVER_ID_SHADING];
+    bool success;
+
+    success = addCachedShader(receiverIdProgram, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(RECEIVER_ID_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(receiverIdProgram, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(RECEIVER_ID_SHADING));
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = receiverIdProgram->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    location = receiverIdProgram->attributeLocation("v_coord");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute vertex coordinate.");
+    attrVertex[RECEIVER_ID_SHADING] = location;
+
+    location = receiverIdProgram->attributeLocation("v_receiverId");
+    TRUE_OR_DIE(location >= 0, "Cannot bind attribute receiver id.");
+    attrReceiverId = location;
+
+    location = glGetUniformBlockIndex(receiverIdProgram->programId(), "Matrices");
+    TRUE_OR_DIE(location >= 0, "Cannot bind block uniform.");
+    uniMatrices[RECEIVER_ID_SHADING] = location;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+// the G-buffer targets are bound to the first texture units, followed by the depth
+//------------------------------------------------------------------------------------------
+void Renderer::setGBufferSamplers(QOpenGLShaderProgram* _program)
+{
+    _program->bind();
+    _program->setUniformValue("albedoTex", (GLint)GBUFFER_ALBEDO);
+    _program->setUniformValue("normalTex", (GLint)GBUFFER_NORMAL);
+    _program->setUniformValue("specularTex", (GLint)GBUFFER_SPECULAR);
+    _program->setUniformValue("sceneDepthTex", (GLint)NUM_GBUFFER_TARGETS);
+    _program->setUniformValue("depthTex", (GLint)NUM_GBUFFER_TARGETS + 1);
+    _program->release();
+}
+
 //------------------------------------------------------------------------------------------
 bool Renderer::initShaderPrograms()
 {
@@ -381,6 +804,13 @@ bool Renderer::initShaderPrograms()
                                  ":/shaders/shadow-map.vs.glsl");
     vertexShaderSourceMap.insert(SHADOW_VOLUME_SHADING,
                                  ":/shaders/shadow-volume.vs.glsl");
+    vertexShaderSourceMap.insert(OCCLUSION_QUERY_SHADING,
+                                 ":/shaders/occlusion-query.vs.glsl");
+    vertexShaderSourceMap.insert(GBUFFER_SHADING, ":/shaders/gbuffer.vs.glsl");
+    vertexShaderSourceMap.insert(DEFERRED_LIGHTING_SHADING,
+                                 ":/shaders/deferred-lighting.vs.glsl");
+    vertexShaderSourceMap.insert(POINT_LIGHT_SHADING, ":/shaders/point-light.vs.glsl");
+    vertexShaderSourceMap.insert(RECEIVER_ID_SHADING, ":/shaders/receiver-id.vs.glsl");
 
     fragmentShaderSourceMap.insert(GOURAUD_SHADING, ":/shaders/gouraud-shading.fs.glsl");
     fragmentShaderSourceMap.insert(PHONG_SHADING, ":/shaders/phong-shading.fs.glsl");
@@ -391,88 +821,476 @@ bool Renderer::initShaderPrograms()
                                    ":/shaders/shadow-map.fs.glsl");
     fragmentShaderSourceMap.insert(SHADOW_VOLUME_SHADING,
                                    ":/shaders/shadow-volume.fs.glsl");
+    fragmentShaderSourceMap.insert(OCCLUSION_QUERY_SHADING,
+                                   ":/shaders/occlusion-query.fs.glsl");
+    fragmentShaderSourceMap.insert(GBUFFER_SHADING, ":/shaders/gbuffer.fs.glsl");
+    fragmentShaderSourceMap.insert(DEFERRED_LIGHTING_SHADING,
+                                   ":/shaders/deferred-lighting.fs.glsl");
+    fragmentShaderSourceMap.insert(POINT_LIGHT_SHADING, ":/shaders/point-light.fs.glsl");
+    fragmentShaderSourceMap.insert(RECEIVER_ID_SHADING, ":/shaders/receiver-id.fs.glsl");
+
+    geometryShaderSourceMap.insert(PROJECTED_OBJECT_SHADING,
+                                   ":/shaders/projected-object.gs.glsl");
+
+    // the programs are compiled on their first use, see requireShadingProgram()
+    for(int i = 0; i < NUM_SHADING_MODE; ++i)
+    {
+        glslPrograms[i] = NULL;
+    }
 
-    return (initLightShadingProgram() &&
-            initProjectedObjectShadingProgram() &&
-            initShadowMapShadingProgram() &&
-            initShadowVolumeShadingProgram() &&
-            initProgram(GOURAUD_SHADING) &&
-            initProgram(PHONG_SHADING));
+    return (vertexShaderSourceMap.size() == NUM_SHADING_MODE &&
+            fragmentShaderSourceMap.size() == NUM_SHADING_MODE);
 }
 
 //------------------------------------------------------------------------------------------
-bool Renderer::validateShaderPrograms(ShadingProgram _shadingMode)
+// Compiles the program the first time a pass needs it, together with its vertex array
+// objects and block bindings, so a session only pays for the modes it uses. The context
+// must be current, which it is while a frame is drawn.
+//------------------------------------------------------------------------------------------
+QOpenGLShaderProgram* Renderer::requireShadingProgram(ShadingProgram _shadingMode)
 {
-    GLint status;
-    GLint logLen;
-    GLchar log[1024];
+    if(glslPrograms[_shadingMode])
+    {
+        return glslPrograms[_shadingMode];
+    }
 
-    glValidateProgram(glslPrograms[_shadingMode]->programId());
-    glGetProgramiv(glslPrograms[_shadingMode]->programId(), GL_VALIDATE_STATUS, &status);
+    Profiler::Scope profilerScope(&profiler, "requireShadingProgram");
 
-    glGetProgramiv(glslPrograms[_shadingMode]->programId(), GL_INFO_LOG_LENGTH, &logLen);
+    bool success;
 
-    if(logLen > 0)
+    switch(_shadingMode)
     {
-        glGetProgramInfoLog(glslPrograms[_shadingMode]->programId(), logLen, &logLen, log);
+    case LIGHT_SHADING:
+        success = initLightShadingProgram();
+        break;
 
-        if(QString(log).trimmed().length() != 0)
-        {
-            qDebug() << "ShadingMode: " << _shadingMode << ", log: " << log;
-        }
-    }
+    case PROJECTED_OBJECT_SHADING:
+        success = initProjectedObjectShadingProgram();
+        break;
 
-    return (status == GL_TRUE);
-}
+    case SHADOW_MAP_SHADING:
+        success = initShadowMapShadingProgram();
+        break;
 
-//------------------------------------------------------------------------------------------
-void Renderer::initSharedBlockUniform()
-{
-    /////////////////////////////////////////////////////////////////
-    // setup the light and material
-    light.position = DEFAULT_LIGHT_POSITION;
-    light.intensity = 0.8f;
+    case SHADOW_VOLUME_SHADING:
+        success = initShadowVolumeShadingProgram();
+        break;
 
-    roomMaterial.setDiffuse(QVector4D(0.02f, 0.45f, 1.0f, 1.0f));
-    roomMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
-    roomMaterial.shininess = 150.0f;
+    case OCCLUSION_QUERY_SHADING:
+        success = initOcclusionQueryShadingProgram();
+        break;
 
-    cubeMaterial.setDiffuse(QVector4D(0.0f, 1.0f, 0.2f, 1.0f));
-    cubeMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
-    cubeMaterial.shininess = 50.0f;
+    case GBUFFER_SHADING:
+        success = initGBufferShadingProgram();
+        break;
 
-    meshObjectMaterial.setDiffuse(QVector4D(2.0f / 3.0f, 1.0f / 3.0f, 0.0f, 1.0f));
-    meshObjectMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
-    meshObjectMaterial.shininess = 50.0f;
+    case DEFERRED_LIGHTING_SHADING:
+        success = initDeferredLightingShadingProgram();
+        break;
 
-    billboardObjectMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 0.0f));
-    billboardObjectMaterial.shininess = 50.0f;
+    case POINT_LIGHT_SHADING:
+        success = initPointLightShadingProgram();
+        break;
 
-    occluderMaterial.setDiffuse(QVector4D(1.0f, 0.1f, 0.6f, 0.0f));
-    occluderMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 0.0f));
-    occluderMaterial.shininess = 50.0f;
+    case RECEIVER_ID_SHADING:
+        success = initReceiverIdShadingProgram();
+        break;
+
+    default:
+        success = initProgram(_shadingMode);
+        break;
+    }
+
+    TRUE_OR_DIE(success, "Cannot initialize shaders. Exit...");
+
+    initShadingProgramVAOs(_shadingMode);
 
     /////////////////////////////////////////////////////////////////
-    // setup binding points for block uniform
-    for(int i = 0; i < NUM_BINDING_POINTS; ++i)
+    // block bindings and uniforms set once per program
+    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING ||
+       _shadingMode == DEFERRED_LIGHTING_SHADING)
     {
-        UBOBindingIndex[i] = i + 1;
+        glUniformBlockBinding(glslPrograms[_shadingMode]->programId(),
+                              uniShadowLights[_shadingMode],
+                              UBOBindingIndex[BINDING_SHADOW_LIGHTS]);
     }
 
-    /////////////////////////////////////////////////////////////////
-    // setup data for block uniform
-    glGenBuffers(1, &UBOMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 4 * SIZE_OF_MAT4, NULL,
-                 GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if(_shadingMode == PHONG_SHADING)
+    {
+        initClusteredLightingUniforms();
+        shadingVariants[GENERIC_SHADING_VARIANT] =
+            getShadingVariantLocations(glslPrograms[PHONG_SHADING]);
+    }
 
+    return glslPrograms[_shadingMode];
+}
 
-    glGenBuffers(1, &UBOLight);
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
-    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
-                 &light, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+//------------------------------------------------------------------------------------------
+QByteArray Renderer::getShadingFeatureDefines(int _features)
+{
+    static const char* featureNames[NUM_SHADING_FEATURES] =
+    {
+        "FEATURE_AMBIENT_LIGHT",
+        "FEATURE_DIRECT_LIGHT",
+        "FEATURE_DEPTH_TEXTURE",
+        "FEATURE_OBJ_TEXTURE",
+        "FEATURE_DISCARD_TRANSPARENT",
+        "FEATURE_VERTEX_COLOR"
+    };
+
+    QByteArray defines("#define SHADING_FEATURES\n");
+
+    for(int i = 0; i < NUM_SHADING_FEATURES; ++i)
+    {
+        defines += QByteArray("#define ") + featureNames[i] +
+                   ((_features & (1 << i)) ? " 1\n" : " 0\n");
+    }
+
+    return defines;
+}
+
+//------------------------------------------------------------------------------------------
+// the uniforms that a variant compiled out are at location -1, and its blocks at
+// GL_INVALID_INDEX
+//------------------------------------------------------------------------------------------
+ShadingVariant Renderer::getShadingVariantLocations(QOpenGLShaderProgram* _program)
+{
+    ShadingVariant variant;
+    GLuint programID = _program->programId();
+
+    variant.program = _program;
+    variant.uniMatrices = glGetUniformBlockIndex(programID, "Matrices");
+    variant.uniLight = glGetUniformBlockIndex(programID, "Light");
+    variant.uniShadowLights = glGetUniformBlockIndex(programID, "ShadowLights");
+    variant.uniMaterial = glGetUniformBlockIndex(programID, "Material");
+    variant.uniCameraPosition = _program->uniformLocation("cameraPosition");
+    variant.uniLightingMode = _program->uniformLocation("lightingMode");
+    variant.uniAmbientLight = _program->uniformLocation("ambientLight");
+    variant.uniObjTexture = _program->uniformLocation("objTex");
+    variant.uniDepthTexture = _program->uniformLocation("depthTex");
+    variant.uniHasObjTexture = _program->uniformLocation("hasObjTex");
+    variant.uniHasDepthTexture = _program->uniformLocation("hasDepthTex");
+    variant.uniInstancedDraw = _program->uniformLocation("instancedDraw");
+    variant.uniClusteredLighting = _program->uniformLocation("clusteredLighting");
+    variant.uniClusterGrid = _program->uniformLocation("clusterGrid");
+    variant.uniClusterParameters = _program->uniformLocation("clusterParameters");
+
+    return variant;
+}
+
+//------------------------------------------------------------------------------------------
+// Links the phong shading program with the features compiled in as constants, so the
+// branches and texture fetches of the disabled features are removed by the compiler. The
+// variants are linked the first time a draw needs them and go through the program binary
+// cache like the other programs. They share the vertex array objects of the generic
+// program, thus the attributes are bound to its locations.
+//------------------------------------------------------------------------------------------
+const ShadingVariant& Renderer::requireShadingVariant(int _features)
+{
+    QHash<int, ShadingVariant>::const_iterator variant = shadingVariants.constFind(_features);
+
+    if(variant != shadingVariants.constEnd())
+    {
+        return variant.value();
+    }
+
+    Profiler::Scope profilerScope(&profiler, "requireShadingVariant");
+
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram;
+    QByteArray defines = getShadingFeatureDefines(_features);
+    bool success;
+
+    success = addCachedShader(program, QOpenGLShader::Vertex,
+                              vertexShaderSourceMap.value(PHONG_SHADING), defines);
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    success = addCachedShader(program, QOpenGLShader::Fragment,
+                              fragmentShaderSourceMap.value(PHONG_SHADING), defines);
+    TRUE_OR_DIE(success, "Cannot compile shader from file.");
+
+    program->bindAttributeLocation("v_coord", attrVertex[PHONG_SHADING]);
+    program->bindAttributeLocation("v_normal", attrNormal[PHONG_SHADING]);
+    program->bindAttributeLocation("v_texCoord", attrTexCoord[PHONG_SHADING]);
+    program->bindAttributeLocation("v_instanceModelMatrix",
+                                   attrInstanceModelMatrix[PHONG_SHADING]);
+    program->bindAttributeLocation("v_instanceNormalMatrix",
+                                   attrInstanceNormalMatrix[PHONG_SHADING]);
+
+    success = program->link();
+    TRUE_OR_DIE(success, "Cannot link GLSL program.");
+
+    ShadingVariant shadingVariant = getShadingVariantLocations(program);
+
+    if(shadingVariant.uniShadowLights >= 0)
+    {
+        glUniformBlockBinding(program->programId(), shadingVariant.uniShadowLights,
+                              UBOBindingIndex[BINDING_SHADOW_LIGHTS]);
+    }
+
+    program->bind();
+    program->setUniformValue("pointLightTex", CLUSTER_TEXTURE_UNIT + CLUSTER_POINT_LIGHTS);
+    program->setUniformValue("clusterTex", CLUSTER_TEXTURE_UNIT + CLUSTER_GRID);
+    program->setUniformValue("lightIndexTex", CLUSTER_TEXTURE_UNIT + CLUSTER_LIGHT_INDICES);
+    program->release();
+
+    return shadingVariants.insert(_features, shadingVariant).value();
+}
+
+//------------------------------------------------------------------------------------------
+// the code setting up the phong shading reads the locations of the bound variant
+//------------------------------------------------------------------------------------------
+void Renderer::useShadingVariant(const ShadingVariant& _variant)
+{
+    currentShadingProgram = _variant.program;
+
+    uniMatrices[PHONG_SHADING] = _variant.uniMatrices;
+    uniCameraPosition[PHONG_SHADING] = _variant.uniCameraPosition;
+    uniLight[PHONG_SHADING] = _variant.uniLight;
+    uniShadowLights[PHONG_SHADING] = _variant.uniShadowLights;
+    uniLightingMode[PHONG_SHADING] = _variant.uniLightingMode;
+    uniAmbientLight[PHONG_SHADING] = _variant.uniAmbientLight;
+    uniMaterial[PHONG_SHADING] = _variant.uniMaterial;
+    uniObjTexture[PHONG_SHADING] = _variant.uniObjTexture;
+    uniDepthTexture[PHONG_SHADING] = _variant.uniDepthTexture;
+    uniHasObjTexture[PHONG_SHADING] = _variant.uniHasObjTexture;
+    uniHasDepthTexture[PHONG_SHADING] = _variant.uniHasDepthTexture;
+    uniInstancedDraw[PHONG_SHADING] = _variant.uniInstancedDraw;
+    uniClusteredLighting = _variant.uniClusteredLighting;
+    uniClusterGrid = _variant.uniClusterGrid;
+    uniClusterParameters = _variant.uniClusterParameters;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::usesShadingVariants()
+{
+    return enabledShadingVariants && currentShadingMode == PHONG_SHADING;
+}
+
+//------------------------------------------------------------------------------------------
+// starts a pass of the forward shading, the surface features are set for each draw
+//------------------------------------------------------------------------------------------
+void Renderer::bindShadingProgram(int _lightingMode, bool _hasDepthTexture)
+{
+    shadingFeatures = 0;
+
+    if(_lightingMode != DIFFUSE_SPECULAR)
+    {
+        shadingFeatures |= FEATURE_AMBIENT_LIGHT;
+    }
+
+    if(_lightingMode != AMBIENT_LIGHT)
+    {
+        shadingFeatures |= FEATURE_DIRECT_LIGHT;
+    }
+
+    if(_hasDepthTexture)
+    {
+        shadingFeatures |= FEATURE_DEPTH_TEXTURE;
+    }
+
+    applyShadingProgram();
+}
+
+//------------------------------------------------------------------------------------------
+// binds the program for the current features and sets everything that is not constant in
+// it; without variants the features are set as uniforms of the generic program
+//------------------------------------------------------------------------------------------
+void Renderer::applyShadingProgram()
+{
+    if(currentShadingMode == PHONG_SHADING)
+    {
+        useShadingVariant(requireShadingVariant(enabledShadingVariants ? shadingFeatures :
+                                                GENERIC_SHADING_VARIANT));
+    }
+
+    GLuint programID = currentShadingProgram->programId();
+
+    currentShadingProgram->bind();
+    profiler.countStateChange();
+    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
+                                           cameraPosition);
+    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
+    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
+    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
+    currentShadingProgram->setUniformValue(uniInstancedDraw[currentShadingMode],
+                                           currentInstancedDraw);
+
+    glUniformBlockBinding(programID, uniMatrices[currentShadingMode],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glUniformBlockBinding(programID, uniLight[currentShadingMode],
+                          UBOBindingIndex[BINDING_LIGHT]);
+
+    // a variant drawing with vertex colors and without direct light reads no material
+    if(uniMaterial[currentShadingMode] >= 0)
+    {
+        glUniformBlockBinding(programID, uniMaterial[currentShadingMode],
+                              UBOBindingIndex[currentMaterialBinding]);
+    }
+
+    if(!usesShadingVariants())
+    {
+        int lightingMode = ALL_LIGHT;
+
+        if(!(shadingFeatures & FEATURE_DIRECT_LIGHT))
+        {
+            lightingMode = AMBIENT_LIGHT;
+        }
+        else if(!(shadingFeatures & FEATURE_AMBIENT_LIGHT))
+        {
+            lightingMode = DIFFUSE_SPECULAR;
+        }
+
+        currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode],
+                                               lightingMode);
+        currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode],
+                                               (shadingFeatures & FEATURE_DEPTH_TEXTURE) != 0);
+        currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode],
+                                               (shadingFeatures & FEATURE_OBJ_TEXTURE) != 0);
+        currentShadingProgram->setUniformValue("discardTransparentPixel",
+                                               (shadingFeatures & FEATURE_DISCARD_TRANSPARENT) != 0);
+    }
+
+    if(currentShadingMode == PHONG_SHADING)
+    {
+        applyClusteredLightingUniforms();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// switches to another variant only when the features of the draw differ from the last one
+//------------------------------------------------------------------------------------------
+void Renderer::setSurfaceFeatures(bool _hasObjTexture, bool _discardTransparentPixel,
+                                  bool _vertexColor)
+{
+    int features = shadingFeatures & ~SURFACE_FEATURES;
+
+    if(_hasObjTexture)
+    {
+        features |= FEATURE_OBJ_TEXTURE;
+    }
+
+    if(_discardTransparentPixel)
+    {
+        features |= FEATURE_DISCARD_TRANSPARENT;
+    }
+
+    if(_vertexColor)
+    {
+        features |= FEATURE_VERTEX_COLOR;
+    }
+
+    if(!usesShadingVariants())
+    {
+        shadingFeatures = features;
+        currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode],
+                                               _hasObjTexture);
+        currentShadingProgram->setUniformValue("discardTransparentPixel",
+                                               _discardTransparentPixel);
+        return;
+    }
+
+    if(features != shadingFeatures)
+    {
+        shadingFeatures = features;
+        applyShadingProgram();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::setInstancedDraw(bool _instancedDraw)
+{
+    currentInstancedDraw = _instancedDraw;
+    currentShadingProgram->setUniformValue(uniInstancedDraw[currentShadingMode],
+                                           _instancedDraw);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::bindShadingMaterial(UBOBinding _binding, GLuint _UBOMaterial)
+{
+    currentMaterialBinding = _binding;
+
+    if(uniMaterial[currentShadingMode] >= 0)
+    {
+        glUniformBlockBinding(currentShadingProgram->programId(),
+                              uniMaterial[currentShadingMode], UBOBindingIndex[_binding]);
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[_binding], _UBOMaterial);
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::validateShaderPrograms(ShadingProgram _shadingMode)
+{
+    GLint status;
+    GLint logLen;
+    GLchar log[1024];
+
+    glValidateProgram(glslPrograms[_shadingMode]->programId());
+    glGetProgramiv(glslPrograms[_shadingMode]->programId(), GL_VALIDATE_STATUS, &status);
+
+    glGetProgramiv(glslPrograms[_shadingMode]->programId(), GL_INFO_LOG_LENGTH, &logLen);
+
+    if(logLen > 0)
+    {
+        glGetProgramInfoLog(glslPrograms[_shadingMode]->programId(), logLen, &logLen, log);
+
+        if(QString(log).trimmed().length() != 0)
+        {
+            qDebug() << "ShadingMode: " << _shadingMode << ", log: " << log;
+        }
+    }
+
+    return (status == GL_TRUE);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initSharedBlockUniform()
+{
+    /////////////////////////////////////////////////////////////////
+    // setup the light and material
+    light.position = DEFAULT_LIGHT_POSITION;
+    light.intensity = 0.8f;
+
+    roomMaterial.setDiffuse(QVector4D(0.02f, 0.45f, 1.0f, 1.0f));
+    roomMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
+    roomMaterial.shininess = 150.0f;
+
+    cubeMaterial.setDiffuse(QVector4D(0.0f, 1.0f, 0.2f, 1.0f));
+    cubeMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
+    cubeMaterial.shininess = 50.0f;
+
+    meshObjectMaterial.setDiffuse(QVector4D(2.0f / 3.0f, 1.0f / 3.0f, 0.0f, 1.0f));
+    meshObjectMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
+    meshObjectMaterial.shininess = 50.0f;
+
+    billboardObjectMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 0.0f));
+    billboardObjectMaterial.shininess = 50.0f;
+
+    occluderMaterial.setDiffuse(QVector4D(1.0f, 0.1f, 0.6f, 0.0f));
+    occluderMaterial.setSpecular(QVector4D(0.5f, 0.5f, 0.5f, 0.0f));
+    occluderMaterial.shininess = 50.0f;
+
+    /////////////////////////////////////////////////////////////////
+    // setup binding points for block uniform
+    for(int i = 0; i < NUM_BINDING_POINTS; ++i)
+    {
+        UBOBindingIndex[i] = i + 1;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // setup data for block uniform
+    glGenBuffers(1, &UBOMatrices);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferData(GL_UNIFORM_BUFFER, 4 * SIZE_OF_MAT4, NULL,
+                 GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+
+    glGenBuffers(1, &UBOLight);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                 &light, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     glGenBuffers(1, &UBORoomMaterial);
     glBindBuffer(GL_UNIFORM_BUFFER, UBORoomMaterial);
@@ -508,6 +1326,12 @@ void Renderer::initSharedBlockUniform()
 //------------------------------------------------------------------------------------------
 void Renderer::initTexture()
 {
+    if(!textureStreamer)
+    {
+        textureStreamer = new TextureStreamer(this,
+                                              getGLContext()->hasExtension("GL_EXT_texture_compression_s3tc"));
+    }
+
     ////////////////////////////////////////////////////////////////////////////////
     // mesh object texture
 //    meshObjectTexture = new QOpenGLTexture(QImage(":/textures/earth.jpg").mirrored());
@@ -516,35 +1340,33 @@ void Renderer::initTexture()
 
     ////////////////////////////////////////////////////////////////////////////////
     // decal texture
-    decalTexture = new QOpenGLTexture(
-        QImage(":/textures/minion.png").mirrored().convertToFormat(QImage::Format_RGBA8888));
+    decalTexture = createPlaceholderTexture();
     decalTexture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
     decalTexture->setMagnificationFilter(QOpenGLTexture::LinearMipMapLinear);
     decalTexture->setWrapMode(QOpenGLTexture::DirectionS,
                               QOpenGLTexture::ClampToEdge);
     decalTexture->setWrapMode(QOpenGLTexture::DirectionT,
                               QOpenGLTexture::ClampToEdge);
+    streamTexture(&decalTexture, ":/textures/minion.png", true, true);
 
     ////////////////////////////////////////////////////////////////////////////////
     // billboard texture
-    billboardTexture = new QOpenGLTexture(
-        QImage(":/textures/billboardblueflowers.png").convertToFormat(QImage::Format_RGBA8888));
+    billboardTexture = createPlaceholderTexture();
     billboardTexture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
     billboardTexture->setMagnificationFilter(QOpenGLTexture::LinearMipMapLinear);
     billboardTexture->setWrapMode(QOpenGLTexture::DirectionS,
                                   QOpenGLTexture::ClampToEdge);
     billboardTexture->setWrapMode(QOpenGLTexture::DirectionT,
                                   QOpenGLTexture::ClampToEdge);
+    streamTexture(&billboardTexture, ":/textures/billboardblueflowers.png", false, true);
 
     ////////////////////////////////////////////////////////////////////////////////
     // ceiling
-    ceilingTexture = new QOpenGLTexture(QImage(":/textures/ceiling.png").mirrored());
-//    TRUE_OR_DIE(ceilingTexture
-//                && ceilingTexture->isCreated(), "Cannot load texture from file.");
-
+    ceilingTexture = createPlaceholderTexture();
     ceilingTexture->setMinificationFilter(QOpenGLTexture::Linear);
     ceilingTexture->setMagnificationFilter(QOpenGLTexture::Linear);
     ceilingTexture->setWrapMode(QOpenGLTexture::Repeat);
+    streamTexture(&ceilingTexture, ":/textures/ceiling.png", true, false);
 
     ////////////////////////////////////////////////////////////////////////////////
     // floor texture
@@ -565,11 +1387,41 @@ void Renderer::initTexture()
 
         QString texFile = QString(":/textures/%1").arg(floorTexture2StrMap[tex]);
         TRUE_OR_DIE(QFile::exists(texFile), "Cannot load texture from file.");
-        floorTextures[tex] = new QOpenGLTexture(QImage(texFile).mirrored());
+        floorTextures[tex] = createPlaceholderTexture();
         floorTextures[tex]->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
         floorTextures[tex]->setMagnificationFilter(QOpenGLTexture::LinearMipMapLinear);
         floorTextures[tex]->setWrapMode(QOpenGLTexture::Repeat);
+        streamTexture(&floorTextures[tex], texFile, true, true);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// drawn until the streamed texture replaces it, which keeps its filtering and wrap modes
+//------------------------------------------------------------------------------------------
+QOpenGLTexture* Renderer::createPlaceholderTexture()
+{
+    QImage image(1, 1, QImage::Format_RGBA8888);
+    image.fill(QColor(128, 128, 128));
+
+    return new QOpenGLTexture(image);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::streamTexture(QOpenGLTexture** _texture, const QString& _fileName,
+                             bool _mirrored, bool _mipmapped)
+{
+    StreamedTexture request = textureStreamer->createRequest(_texture, _fileName,
+                                                             _mirrored, _mipmapped);
+
+    // headless runs render their first frame right away, with all textures in place
+    if(headlessContext)
+    {
+        TRUE_OR_DIE(textureStreamer->loadTexture(&request), "Cannot load texture from file.");
+        uploadStreamedTexture(request);
+        return;
     }
+
+    textureStreamer->requestTexture(request);
 }
 
 //------------------------------------------------------------------------------------------
@@ -581,6 +1433,10 @@ void Renderer::initSceneMemory()
     initMeshObjectMemory();
     initBillboardMemory();
     initShadowVolumeMemory();
+    initInstanceMemory();
+    initPointLightMemory();
+    initSceneGeometryMemory();
+    initSceneDrawMemory();
 }
 
 //------------------------------------------------------------------------------------------
@@ -671,39 +1527,27 @@ void Renderer::initCubeMemory()
     iboCube.bind();
     iboCube.allocate(cubeObject->getIndices(), cubeObject->getIndexOffset());
     iboCube.release();
+
+    cubePatches = cubeObject->getPlanarPatches();
 }
 
 //------------------------------------------------------------------------------------------
 void Renderer::initMeshObjectMemory()
 {
+    Profiler::Scope profilerScope(&profiler, "initMeshObjectMemory");
+
 //    qDebug() << QString(QDir::currentPath())+QString("/../obj/teapot.obj");
     if(!objLoader)
     {
-        objLoader = new OBJLoader;
+        objLoader.reset(new OBJLoader);
     }
 
     bool result = false;
 
-    switch (currentMeshObject)
     {
-    case TEAPOT_OBJ:
-        result = objLoader->loadObjFile(":/obj/teapot.obj");
-        break;
-
-    case BUNNY_OBJ:
-        result = objLoader->loadObjFile(":/obj/bunny.obj");
-        break;
-
-    case DUCK_OBJ:
-        result = objLoader->loadObjFile(":/obj/duck.obj");
-        break;
-
-    case MICKEY_OBJ:
-        result = objLoader->loadObjFile(":/obj/mickey.obj");
-        break;
-
-    default:
-        break;
+        Profiler::Scope profilerScope(&profiler, "loadObjFile");
+        int meshIndex = currentMeshObject.loadAcquire();
+        result = objLoader->loadObjFile(MeshLoader::getFileName(meshIndex));
     }
 
     if(!result)
@@ -712,6 +1556,15 @@ void Renderer::initMeshObjectMemory()
         return;
     }
 
+    initMeshObjectBuffers();
+
+    meshObjectPatches = objLoader->getPlanarPatches(MIN_MESH_RECEIVER_AREA,
+                                                    MAX_NUM_RECEIVER_PLANES);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initMeshObjectBuffers()
+{
     if(vboMeshObject.isCreated())
     {
         vboMeshObject.destroy();
@@ -804,43 +1657,292 @@ void Renderer::initShadowVolumeMemory()
 }
 
 //------------------------------------------------------------------------------------------
-// record the buffer state by vertex array object
-//------------------------------------------------------------------------------------------
-void Renderer::initVertexArrayObjects()
+void Renderer::initInstanceMemory()
 {
-    initLightVAO();
-
-    initRoomVAO(GOURAUD_SHADING);
-    initRoomVAO(PHONG_SHADING);
-    initRoomVAO(SHADOW_MAP_SHADING);
-
-    initCubeVAO(GOURAUD_SHADING);
-    initCubeVAO(PHONG_SHADING);
-    initCubeVAO(PROJECTED_OBJECT_SHADING);
-    initCubeVAO(SHADOW_MAP_SHADING);
-
-    initMeshObjectVAO(GOURAUD_SHADING);
-    initMeshObjectVAO(PHONG_SHADING);
-    initMeshObjectVAO(PROJECTED_OBJECT_SHADING);
-    initMeshObjectVAO(SHADOW_MAP_SHADING);
-
-    initBillboardVAO(GOURAUD_SHADING);
-    initBillboardVAO(PHONG_SHADING);
-    initBillboardVAO(SHADOW_MAP_SHADING);
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        if(vboInstances[i].isCreated())
+        {
+            vboInstances[i].destroy();
+        }
 
-    initShadowVolumeVAO();
+        ////////////////////////////////////////////////////////////////////////////////
+        // the buffer always holds at least one instance, so that the instance
+        // attributes of the VAOs never point to an empty buffer
+        vboInstances[i].create();
+        vboInstances[i].setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        uploadInstanceMatrices(static_cast<InstancedObject>(i));
+    }
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::initLightVAO()
+// a coarse sphere is the light volume of every point light, drawn instanced with the
+// position, radius and color of the lights
+//------------------------------------------------------------------------------------------
+void Renderer::initPointLightMemory()
 {
-    if(vaoLight.isCreated())
+    if(!sphereObject)
     {
-        vaoLight.destroy();
+        sphereObject = new UnitSphere;
+        sphereObject->generateSphere(8, 12);
     }
 
-    QOpenGLShaderProgram* program = glslPrograms[LIGHT_SHADING];
-
+    if(vboPointLightVolume.isCreated())
+    {
+        vboPointLightVolume.destroy();
+    }
+
+    if(iboPointLightVolume.isCreated())
+    {
+        iboPointLightVolume.destroy();
+    }
+
+    if(vboPointLights.isCreated())
+    {
+        vboPointLights.destroy();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // init memory for light volume
+    vboPointLightVolume.create();
+    vboPointLightVolume.bind();
+    vboPointLightVolume.allocate(sphereObject->getVertices(),
+                                 sphereObject->getVertexOffset());
+    vboPointLightVolume.release();
+    // indices
+    iboPointLightVolume.create();
+    iboPointLightVolume.bind();
+    iboPointLightVolume.allocate(sphereObject->getIndices(), sphereObject->getIndexOffset());
+    iboPointLightVolume.release();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // per-light data
+    vboPointLights.create();
+    vboPointLights.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    vboPointLights.bind();
+    vboPointLights.allocate(MAX_NUM_POINT_LIGHTS * PointLight().getStructSize());
+    vboPointLights.release();
+}
+
+//------------------------------------------------------------------------------------------
+// room, cube, mesh object and billboard are packed into one vertex/index buffer pair,
+// with positions, normals and texture coordinates in consecutive blocks
+//------------------------------------------------------------------------------------------
+void Renderer::initSceneGeometryMemory()
+{
+    if(!cubeObject || !objLoader || !planeObject)
+    {
+        return;
+    }
+
+    if(vboSceneGeometry.isCreated())
+    {
+        vboSceneGeometry.destroy();
+    }
+
+    if(iboSceneGeometry.isCreated())
+    {
+        iboSceneGeometry.destroy();
+    }
+
+    int numMeshVertices[NUM_SCENE_MESHES] =
+    {
+        cubeObject->getNumVertices(),
+        cubeObject->getNumVertices(),
+        objLoader->getNumVertices(),
+        planeObject->getNumVertices()
+    };
+
+    int numMeshIndices[NUM_SCENE_MESHES] =
+    {
+        cubeObject->getNumIndices(),
+        cubeObject->getNumIndices(),
+        objLoader->getNumIndices(),
+        planeObject->getNumIndices()
+    };
+
+    GLushort* meshIndices[NUM_SCENE_MESHES] =
+    {
+        cubeObject->getIndices(),
+        cubeObject->getIndices(),
+        objLoader->getIndices(),
+        planeObject->getIndices()
+    };
+
+    numSceneVertices = 0;
+    int numSceneIndices = 0;
+
+    for(int i = 0; i < NUM_SCENE_MESHES; ++i)
+    {
+        sceneMeshRanges[i].baseVertex = numSceneVertices;
+        sceneMeshRanges[i].firstIndex = numSceneIndices;
+        sceneMeshRanges[i].numIndices = numMeshIndices[i];
+
+        numSceneVertices += numMeshVertices[i];
+        numSceneIndices += numMeshIndices[i];
+    }
+
+    int normalOffset = 3 * numSceneVertices * sizeof(GLfloat);
+    int texCoordOffset = 6 * numSceneVertices * sizeof(GLfloat);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // init memory for the shared vertex buffer
+    vboSceneGeometry.create();
+    vboSceneGeometry.bind();
+    vboSceneGeometry.allocate(8 * numSceneVertices * sizeof(GLfloat));
+
+    // room
+    int base = sceneMeshRanges[SCENE_MESH_ROOM].baseVertex;
+    vboSceneGeometry.write(3 * base * sizeof(GLfloat), cubeObject->getVertices(),
+                           cubeObject->getVertexOffset());
+    vboSceneGeometry.write(normalOffset + 3 * base * sizeof(GLfloat),
+                           cubeObject->getNegativeNormals(), cubeObject->getVertexOffset());
+    vboSceneGeometry.write(texCoordOffset + 2 * base * sizeof(GLfloat),
+                           cubeObject->getTexureCoordinates(roomSize),
+                           cubeObject->getTexCoordOffset());
+
+    // cube
+    base = sceneMeshRanges[SCENE_MESH_CUBE].baseVertex;
+    vboSceneGeometry.write(3 * base * sizeof(GLfloat), cubeObject->getVertices(),
+                           cubeObject->getVertexOffset());
+    vboSceneGeometry.write(normalOffset + 3 * base * sizeof(GLfloat),
+                           cubeObject->getNormals(), cubeObject->getVertexOffset());
+    vboSceneGeometry.write(texCoordOffset + 2 * base * sizeof(GLfloat),
+                           cubeObject->getTexureCoordinates(1.0f),
+                           cubeObject->getTexCoordOffset());
+
+    // mesh object
+    base = sceneMeshRanges[SCENE_MESH_OBJECT].baseVertex;
+    vboSceneGeometry.write(3 * base * sizeof(GLfloat), objLoader->getVertices(),
+                           objLoader->getVertexOffset());
+    vboSceneGeometry.write(normalOffset + 3 * base * sizeof(GLfloat),
+                           objLoader->getNormals(), objLoader->getVertexOffset());
+    vboSceneGeometry.write(texCoordOffset + 2 * base * sizeof(GLfloat),
+                           objLoader->getTexureCoordinates(),
+                           objLoader->getTexCoordOffset());
+
+    // billboard
+    base = sceneMeshRanges[SCENE_MESH_BILLBOARD].baseVertex;
+    vboSceneGeometry.write(3 * base * sizeof(GLfloat), planeObject->getVertices(),
+                           planeObject->getVertexOffset());
+    vboSceneGeometry.write(normalOffset + 3 * base * sizeof(GLfloat),
+                           planeObject->getNormals(), planeObject->getVertexOffset());
+    vboSceneGeometry.write(texCoordOffset + 2 * base * sizeof(GLfloat),
+                           planeObject->getTexureCoordinates(1.0f),
+                           planeObject->getTexCoordOffset());
+    vboSceneGeometry.release();
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // indices are kept relative to each mesh, the base vertex is applied at draw time
+    iboSceneGeometry.create();
+    iboSceneGeometry.bind();
+    iboSceneGeometry.allocate(numSceneIndices * sizeof(GLushort));
+
+    for(int i = 0; i < NUM_SCENE_MESHES; ++i)
+    {
+        iboSceneGeometry.write(sceneMeshRanges[i].firstIndex * sizeof(GLushort),
+                               meshIndices[i], numMeshIndices[i] * sizeof(GLushort));
+    }
+
+    iboSceneGeometry.release();
+}
+
+//------------------------------------------------------------------------------------------
+// the draw data buffer holds one model/normal matrix pair per single object, followed by
+// a fixed size region for the instances of each instanced object
+//------------------------------------------------------------------------------------------
+void Renderer::initSceneDrawMemory()
+{
+    if(vboSceneDrawData.isCreated())
+    {
+        vboSceneDrawData.destroy();
+    }
+
+    vboSceneDrawData.create();
+    vboSceneDrawData.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    vboSceneDrawData.bind();
+    vboSceneDrawData.allocate((NUM_SCENE_OBJECTS + NUM_INSTANCED_OBJECTS * MAX_NUM_INSTANCES) *
+                              SIZE_OF_INSTANCE_DATA);
+    vboSceneDrawData.release();
+
+    if(indirectDrawBuffer == 0)
+    {
+        glGenBuffers(1, &indirectDrawBuffer);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectDrawBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 MAX_NUM_DRAW_COMMANDS * sizeof(DrawElementsIndirectCommand),
+                 NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+//------------------------------------------------------------------------------------------
+// record the buffer state by vertex array object
+//------------------------------------------------------------------------------------------
+void Renderer::initVertexArrayObjects()
+{
+    // the others belong to a program, and are made with it
+    initScreenQuadVAO();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initShadingProgramVAOs(ShadingProgram _shadingMode)
+{
+    switch(_shadingMode)
+    {
+    case GOURAUD_SHADING:
+    case PHONG_SHADING:
+    case SHADOW_MAP_SHADING:
+    case GBUFFER_SHADING:
+        initRoomVAO(_shadingMode);
+        initCubeVAO(_shadingMode);
+        initMeshObjectVAO(_shadingMode);
+        initBillboardVAO(_shadingMode);
+        initSceneGeometryVAO(_shadingMode);
+        break;
+
+    case PROJECTED_OBJECT_SHADING:
+        initCubeVAO(_shadingMode);
+        initMeshObjectVAO(_shadingMode);
+        initSceneGeometryVAO(_shadingMode);
+        break;
+
+    case LIGHT_SHADING:
+        initLightVAO();
+        break;
+
+    case SHADOW_VOLUME_SHADING:
+        initShadowVolumeVAO();
+        break;
+
+    case OCCLUSION_QUERY_SHADING:
+        initBoundingBoxVAO();
+        break;
+
+    case POINT_LIGHT_SHADING:
+        initPointLightVAO();
+        break;
+
+    case RECEIVER_ID_SHADING:
+        initReceiverIdVAO();
+        break;
+
+    default:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initLightVAO()
+{
+    if(vaoLight.isCreated())
+    {
+        vaoLight.destroy();
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[LIGHT_SHADING];
+
     vaoLight.create();
     vaoLight.bind();
 
@@ -903,7 +2005,8 @@ void Renderer::initCubeVAO(ShadingProgram _shadingMode)
     program->enableAttributeArray(attrVertex[_shadingMode]);
     program->setAttributeBuffer(attrVertex[_shadingMode], GL_FLOAT, 0, 3);
 
-    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING)
+    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING ||
+       _shadingMode == GBUFFER_SHADING)
     {
         program->enableAttributeArray(attrNormal[_shadingMode]);
         program->setAttributeBuffer(attrNormal[_shadingMode], GL_FLOAT,
@@ -914,6 +2017,7 @@ void Renderer::initCubeVAO(ShadingProgram _shadingMode)
                                     2 * cubeObject->getVertexOffset(), 2);
     }
 
+    initInstanceAttributes(_shadingMode, &vboInstances[INSTANCED_CUBE]);
     iboCube.bind();
 
     // release vao before vbo and ibo
@@ -940,7 +2044,8 @@ void Renderer::initMeshObjectVAO(ShadingProgram _shadingMode)
     program->enableAttributeArray(attrVertex[_shadingMode]);
     program->setAttributeBuffer(attrVertex[_shadingMode], GL_FLOAT, 0, 3);
 
-    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING)
+    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING ||
+       _shadingMode == GBUFFER_SHADING)
     {
         program->enableAttributeArray(attrNormal[_shadingMode]);
         program->setAttributeBuffer(attrNormal[_shadingMode], GL_FLOAT,
@@ -951,6 +2056,7 @@ void Renderer::initMeshObjectVAO(ShadingProgram _shadingMode)
                                     2 * objLoader->getVertexOffset(), 2);
     }
 
+    initInstanceAttributes(_shadingMode, &vboInstances[INSTANCED_MESH_OBJECT]);
     iboMeshObject.bind();
 
     // release vao before vbo and ibo
@@ -976,7 +2082,8 @@ void Renderer::initBillboardVAO(ShadingProgram _shadingMode)
     program->enableAttributeArray(attrVertex[_shadingMode]);
     program->setAttributeBuffer(attrVertex[_shadingMode], GL_FLOAT, 0, 3);
 
-    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING)
+    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING ||
+       _shadingMode == GBUFFER_SHADING)
     {
         program->enableAttributeArray(attrNormal[_shadingMode]);
         program->setAttributeBuffer(attrNormal[_shadingMode], GL_FLOAT,
@@ -987,6 +2094,7 @@ void Renderer::initBillboardVAO(ShadingProgram _shadingMode)
     program->setAttributeBuffer(attrTexCoord[_shadingMode], GL_FLOAT,
                                 2 * planeObject->getVertexOffset(), 2);
 
+    initInstanceAttributes(_shadingMode, &vboInstances[INSTANCED_BILLBOARD]);
     iboBillboard.bind();
 
     // release vao before vbo and ibo
@@ -1015,6 +2123,196 @@ void Renderer::initShadowVolumeVAO()
     vaoShadowVolume.release();
 }
 
+//------------------------------------------------------------------------------------------
+// the triangles of the receivers are streamed every frame, as a position and an id per
+// vertex
+//------------------------------------------------------------------------------------------
+void Renderer::initReceiverIdVAO()
+{
+    if(vaoReceiverTriangles.isCreated())
+    {
+        vaoReceiverTriangles.destroy();
+    }
+
+    if(!vboReceiverTriangles.isCreated())
+    {
+        vboReceiverTriangles.create();
+        vboReceiverTriangles.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[RECEIVER_ID_SHADING];
+
+    vaoReceiverTriangles.create();
+    vaoReceiverTriangles.bind();
+
+    vboReceiverTriangles.bind();
+    program->enableAttributeArray(attrVertex[RECEIVER_ID_SHADING]);
+    program->setAttributeBuffer(attrVertex[RECEIVER_ID_SHADING], GL_FLOAT, 0, 3,
+                                4 * sizeof(GLfloat));
+    program->enableAttributeArray(attrReceiverId);
+    program->setAttributeBuffer(attrReceiverId, GL_FLOAT, 3 * sizeof(GLfloat), 1,
+                                4 * sizeof(GLfloat));
+
+    vaoReceiverTriangles.release();
+    vboReceiverTriangles.release();
+}
+
+//------------------------------------------------------------------------------------------
+// the unit cube, drawn as the bounding box of the objects tested by occlusion queries
+//------------------------------------------------------------------------------------------
+void Renderer::initBoundingBoxVAO()
+{
+    if(vaoBoundingBox.isCreated())
+    {
+        vaoBoundingBox.destroy();
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[OCCLUSION_QUERY_SHADING];
+
+    vaoBoundingBox.create();
+    vaoBoundingBox.bind();
+
+    vboCube.bind();
+    program->enableAttributeArray(attrVertex[OCCLUSION_QUERY_SHADING]);
+    program->setAttributeBuffer(attrVertex[OCCLUSION_QUERY_SHADING], GL_FLOAT, 0, 3);
+    iboCube.bind();
+
+    // release vao before vbo and ibo
+    vaoBoundingBox.release();
+    vboCube.release();
+    iboCube.release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initPointLightVAO()
+{
+    if(vaoPointLight.isCreated())
+    {
+        vaoPointLight.destroy();
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[POINT_LIGHT_SHADING];
+    int stride = PointLight().getStructSize();
+
+    vaoPointLight.create();
+    vaoPointLight.bind();
+
+    vboPointLightVolume.bind();
+    program->enableAttributeArray(attrVertex[POINT_LIGHT_SHADING]);
+    program->setAttributeBuffer(attrVertex[POINT_LIGHT_SHADING], GL_FLOAT, 0, 3);
+
+    vboPointLights.bind();
+    program->enableAttributeArray(attrPointLightPosition);
+    program->setAttributeBuffer(attrPointLightPosition, GL_FLOAT, 0, 4, stride);
+    glVertexAttribDivisor(attrPointLightPosition, 1);
+
+    program->enableAttributeArray(attrPointLightColor);
+    program->setAttributeBuffer(attrPointLightColor, GL_FLOAT, SIZE_OF_VEC4, 4, stride);
+    glVertexAttribDivisor(attrPointLightColor, 1);
+
+    iboPointLightVolume.bind();
+
+    // release vao before vbo and ibo
+    vaoPointLight.release();
+    vboPointLights.release();
+    iboPointLightVolume.release();
+}
+
+//------------------------------------------------------------------------------------------
+// the fullscreen triangle is generated from the vertex id, the vao holds no attribute
+// but the core profile cannot draw without one
+//------------------------------------------------------------------------------------------
+void Renderer::initScreenQuadVAO()
+{
+    if(vaoScreenQuad.isCreated())
+    {
+        vaoScreenQuad.destroy();
+    }
+
+    vaoScreenQuad.create();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::initSceneGeometryVAO(ShadingProgram _shadingMode)
+{
+    if(vaoScene[_shadingMode].isCreated())
+    {
+        vaoScene[_shadingMode].destroy();
+    }
+
+    if(!vboSceneGeometry.isCreated())
+    {
+        return;
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[_shadingMode];
+
+    vaoScene[_shadingMode].create();
+    vaoScene[_shadingMode].bind();
+
+    vboSceneGeometry.bind();
+    program->enableAttributeArray(attrVertex[_shadingMode]);
+    program->setAttributeBuffer(attrVertex[_shadingMode], GL_FLOAT, 0, 3);
+
+    if(_shadingMode == GOURAUD_SHADING || _shadingMode == PHONG_SHADING ||
+       _shadingMode == GBUFFER_SHADING)
+    {
+        program->enableAttributeArray(attrNormal[_shadingMode]);
+        program->setAttributeBuffer(attrNormal[_shadingMode], GL_FLOAT,
+                                    3 * numSceneVertices * sizeof(GLfloat), 3);
+    }
+
+    if(_shadingMode != PROJECTED_OBJECT_SHADING)
+    {
+        program->enableAttributeArray(attrTexCoord[_shadingMode]);
+        program->setAttributeBuffer(attrTexCoord[_shadingMode], GL_FLOAT,
+                                    6 * numSceneVertices * sizeof(GLfloat), 2);
+    }
+
+    // every draw command picks its matrices by the base instance
+    initInstanceAttributes(_shadingMode, &vboSceneDrawData);
+    iboSceneGeometry.bind();
+
+    // release vao before vbo and ibo
+    vaoScene[_shadingMode].release();
+    vboSceneGeometry.release();
+    iboSceneGeometry.release();
+}
+
+//------------------------------------------------------------------------------------------
+// the per-instance model (and normal) matrices are fed as mat4 attributes, which occupy
+// 4 consecutive attribute locations each, and advance once per instance
+//------------------------------------------------------------------------------------------
+void Renderer::initInstanceAttributes(ShadingProgram _shadingMode,
+                                      QOpenGLBuffer* _vboInstance, int _offset)
+{
+    QOpenGLShaderProgram* program = glslPrograms[_shadingMode];
+    bool hasNormalMatrix = (_shadingMode == GOURAUD_SHADING ||
+                            _shadingMode == PHONG_SHADING ||
+                            _shadingMode == GBUFFER_SHADING);
+
+    _vboInstance->bind();
+
+    for(int i = 0; i < 4; ++i)
+    {
+        program->enableAttributeArray(attrInstanceModelMatrix[_shadingMode] + i);
+        program->setAttributeBuffer(attrInstanceModelMatrix[_shadingMode] + i, GL_FLOAT,
+                                    _offset + i * SIZE_OF_VEC4, 4, SIZE_OF_INSTANCE_DATA);
+        glVertexAttribDivisor(attrInstanceModelMatrix[_shadingMode] + i, 1);
+
+        if(hasNormalMatrix)
+        {
+            program->enableAttributeArray(attrInstanceNormalMatrix[_shadingMode] + i);
+            program->setAttributeBuffer(attrInstanceNormalMatrix[_shadingMode] + i, GL_FLOAT,
+                                        _offset + SIZE_OF_MAT4 + i * SIZE_OF_VEC4, 4,
+                                        SIZE_OF_INSTANCE_DATA);
+            glVertexAttribDivisor(attrInstanceNormalMatrix[_shadingMode] + i, 1);
+        }
+    }
+
+    _vboInstance->release();
+}
+
 //------------------------------------------------------------------------------------------
 void Renderer::initSceneMatrices()
 {
@@ -1035,13 +2333,13 @@ void Renderer::initSceneMatrices()
     meshObjectModelMatrix.setToIdentity();
     meshObjectModelMatrix.translate(DEFAULT_MESH_OBJECT_POSITION);
 
-    if(currentMeshObject != TEAPOT_OBJ)
+    if(currentMeshObject.loadAcquire() != TEAPOT_OBJ)
         meshObjectModelMatrix.translate(QVector3D(0, -2.0f * objLoader->getLowestYCoordinate(),
                                                   0));
 
     meshObjectModelMatrix.scale(2.0f / objLoader->getScalingFactor());
 
-    if(currentMeshObject == TEAPOT_OBJ)
+    if(currentMeshObject.loadAcquire() == TEAPOT_OBJ)
     {
         meshObjectModelMatrix.rotate(-90, 1, 0, 0);
     }
@@ -1075,7 +2373,7 @@ void Renderer::initDepthBufferObject()
 
     depthTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
     depthTexture->create();
-    depthTexture->setSize(DEPTH_TEXTURE_SIZE, DEPTH_TEXTURE_SIZE);
+    depthTexture->setSize(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
     depthTexture->setFormat(QOpenGLTexture::D32);
     depthTexture->allocateStorage();
     depthTexture->setMinificationFilter(QOpenGLTexture::Linear);
@@ -1090,7 +2388,7 @@ void Renderer::initDepthBufferObject()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
     // frame buffer
-    FBODepthMap = new QOpenGLFramebufferObject(DEPTH_TEXTURE_SIZE, DEPTH_TEXTURE_SIZE);
+    FBODepthMap = new QOpenGLFramebufferObject(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
     FBODepthMap->bind();
 //    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
 //                         dTex, 0);
@@ -1117,1301 +2415,3965 @@ void Renderer::initDepthBufferObject()
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setRoomSize(int _roomSize)
+// the G-buffer follows the widget size; its depth is a depth-stencil texture so that it
+// can be blitted to the widget frame buffer
+//------------------------------------------------------------------------------------------
+void Renderer::initGBufferObject()
 {
-    if(isValid())
+    gBufferSize = QSize(width() * retinaScale, height() * retinaScale);
+
+    if(FBOGBuffer)
     {
-        makeCurrent();
+        delete FBOGBuffer;
     }
 
-    roomSize = (float)_roomSize;
-    roomModelMatrix.setToIdentity();
-    roomModelMatrix.scale(roomSize);
-    roomModelMatrix.translate(0.0, 1.0, 0.0);
-    roomNormalMatrix = QMatrix4x4(roomModelMatrix.normalMatrix());
+    if(gBufferDepthTexture)
+    {
+        gBufferDepthTexture->destroy();
+        delete gBufferDepthTexture;
+    }
 
-    vboRoom.bind();
-    vboRoom.write(2 * cubeObject->getVertexOffset(),
-                  cubeObject->getTexureCoordinates(roomSize),
-                  cubeObject->getTexCoordOffset());
-    vboRoom.release();
-    update();
+    gBufferDepthTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+    gBufferDepthTexture->create();
+    gBufferDepthTexture->setSize(gBufferSize.width(), gBufferSize.height());
+    gBufferDepthTexture->setFormat(QOpenGLTexture::D24S8);
+    gBufferDepthTexture->allocateStorage();
+    gBufferDepthTexture->setMinificationFilter(QOpenGLTexture::Nearest);
+    gBufferDepthTexture->setMagnificationFilter(QOpenGLTexture::Nearest);
+
+    // frame buffer, the attachments are in the order of GBufferTarget
+    FBOGBuffer = new QOpenGLFramebufferObject(gBufferSize,
+                                              QOpenGLFramebufferObject::NoAttachment,
+                                              GL_TEXTURE_2D, GL_RGBA8);
+    FBOGBuffer->addColorAttachment(gBufferSize, GL_RGBA16F);
+    FBOGBuffer->addColorAttachment(gBufferSize, GL_RGBA8);
+    FBOGBuffer->bind();
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                         gBufferDepthTexture->textureId(), 0);
+    TRUE_OR_DIE(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE,
+                "Framebuffer is imcomplete!");
+    FBOGBuffer->release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setAmbientLight(int _ambientLight)
-{
-    ambientLight = (float) _ambientLight / 100.0f;
-}
-
+// the receiver ids follow the widget size, with their own depth so that the nearest
+// receiver of a pixel wins
 //------------------------------------------------------------------------------------------
-void Renderer::setLightIntensity(int _intensity)
+void Renderer::initReceiverIdObject()
 {
-    if(!isValid())
+    receiverIdSize = QSize(width() * retinaScale, height() * retinaScale);
+
+    if(FBOReceiverId)
     {
-        return;
+        delete FBOReceiverId;
     }
 
-    makeCurrent();
-    light.intensity = (GLfloat)_intensity / 100.0f;
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
-    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
-                 &light, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    doneCurrent();
-    update();
+    FBOReceiverId = new QOpenGLFramebufferObject(receiverIdSize,
+                                                 QOpenGLFramebufferObject::Depth,
+                                                 GL_TEXTURE_2D, GL_R8);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::resetObjectPositions()
+// the point lights, clusters and light indices are read by the phong shader through
+// buffer textures, as GL 4.0 has no shader storage buffer
+//------------------------------------------------------------------------------------------
+void Renderer::initClusteredLighting()
 {
-    makeCurrent();
-    initSceneMatrices();
-    doneCurrent();
+    ////////////////////////////////////////////////////////////////////////////////
+    // the buffers must have a data store before being attached to a texture
+    vboClusterGrid.create();
+    vboClusterGrid.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    vboClusterGrid.bind();
+    vboClusterGrid.allocate(2 * sizeof(GLuint));
+    vboClusterGrid.release();
+
+    vboClusterLightIndices.create();
+    vboClusterLightIndices.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    vboClusterLightIndices.bind();
+    vboClusterLightIndices.allocate(sizeof(GLuint));
+    vboClusterLightIndices.release();
+
+    glGenTextures(NUM_CLUSTER_TEXTURES, clusterTextures);
+    glBindTexture(GL_TEXTURE_BUFFER, clusterTextures[CLUSTER_POINT_LIGHTS]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, vboPointLights.bufferId());
+    glBindTexture(GL_TEXTURE_BUFFER, clusterTextures[CLUSTER_GRID]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, vboClusterGrid.bufferId());
+    glBindTexture(GL_TEXTURE_BUFFER, clusterTextures[CLUSTER_LIGHT_INDICES]);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, vboClusterLightIndices.bufferId());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::resetLightPosition()
+void Renderer::initClusteredLightingUniforms()
 {
-    makeCurrent();
-    light.position = DEFAULT_LIGHT_POSITION;
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
-    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
-                 &light, GL_STREAM_DRAW);
+    QOpenGLShaderProgram* program = glslPrograms[PHONG_SHADING];
+    GLint location;
 
-    lightViewMatrix.setToIdentity();
-    lightViewMatrix.lookAt(QVector3D(light.position), QVector3D(0, 0, 0), QVector3D(0, 0,
-                                                                                    -1));
-    shadowMatrix = lightProjectionMatrix * lightViewMatrix;
+    location = program->uniformLocation("clusteredLighting");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform clusteredLighting.");
+    uniClusteredLighting = location;
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    shadowMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    doneCurrent();
+    location = program->uniformLocation("clusterGrid");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform clusterGrid.");
+    uniClusterGrid = location;
+
+    location = program->uniformLocation("clusterParameters");
+    TRUE_OR_DIE(location >= 0, "Cannot bind uniform clusterParameters.");
+    uniClusterParameters = location;
+
+    program->bind();
+    program->setUniformValue("pointLightTex", CLUSTER_TEXTURE_UNIT + CLUSTER_POINT_LIGHTS);
+    program->setUniformValue("clusterTex", CLUSTER_TEXTURE_UNIT + CLUSTER_GRID);
+    program->setUniformValue("lightIndexTex", CLUSTER_TEXTURE_UNIT + CLUSTER_LIGHT_INDICES);
+    program->setUniformValue(uniClusteredLighting, GL_FALSE);
+    program->release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setMeshObject(int _objectIndex)
+// the main light is followed by dimmer colored lights above the other corners of the room,
+// all of them look at the room center; the programs reading them bind the block when they
+// are created
+//------------------------------------------------------------------------------------------
+void Renderer::initShadowLights()
 {
-    if(!isValid())
+    QVector4D positions[MAX_NUM_SHADOW_LIGHTS] =
     {
-        return;
-    }
+        DEFAULT_LIGHT_POSITION,
+        QVector4D(10.0f, 12.0f, -6.0f, 1.0f),
+        QVector4D(-10.0f, 8.0f, -8.0f, 1.0f),
+        QVector4D(8.0f, 8.0f, 10.0f, 1.0f)
+    };
+    QVector4D colors[MAX_NUM_SHADOW_LIGHTS] =
+    {
+        QVector4D(1.0f, 1.0f, 1.0f, 1.0f),
+        QVector4D(1.0f, 0.6f, 0.3f, 0.5f),
+        QVector4D(0.3f, 0.5f, 1.0f, 0.5f),
+        QVector4D(0.4f, 1.0f, 0.4f, 0.5f)
+    };
 
-    if(_objectIndex < 0 || _objectIndex >= NUM_MESH_OBJECT)
+    shadowLights.resize(MAX_NUM_SHADOW_LIGHTS);
+
+    for(int i = 0; i < MAX_NUM_SHADOW_LIGHTS; ++i)
     {
-        return;
+        shadowLights[i].position = positions[i];
+        shadowLights[i].colorIntensity = colors[i];
     }
 
-    currentMeshObject = static_cast<MeshObject>(_objectIndex);
-    makeCurrent();
-    initMeshObjectMemory();
-    initMeshObjectVAO(GOURAUD_SHADING);
-    initMeshObjectVAO(PHONG_SHADING);
-    initMeshObjectVAO(PROJECTED_OBJECT_SHADING);
-    initMeshObjectVAO(SHADOW_MAP_SHADING);
-
-    resetObjectPositions();
+    glGenBuffers(1, &UBOShadowLights);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOShadowLights);
+    glBufferData(GL_UNIFORM_BUFFER, SIZE_OF_SHADOW_LIGHTS_BLOCK, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    doneCurrent();
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_SHADOW_LIGHTS],
+                     UBOShadowLights);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setFloorTexture(FloorTexture _texture)
-{
-    currentFloorTexture = _texture;
-}
-
+// scatter the point lights over the lower half of the room, always with the same seed so
+// that a light count gives the same lights every time
 //------------------------------------------------------------------------------------------
-void Renderer::setFloorTextureFilteringMode(QOpenGLTexture::Filter
-                                            _textureFiltering)
+void Renderer::generatePointLights()
 {
-    for(int i = 0; i < NUM_FLOOR_TEXTURES; ++i)
+    if(!vboPointLights.isCreated())
     {
-        floorTextures[i]->setMinMagFilters(_textureFiltering, _textureFiltering);
+        return;
     }
-}
 
-//------------------------------------------------------------------------------------------
-void Renderer::setRoomColor(float _r, float _g, float _b)
-{
-    if(!isValid())
+    float radius = fmax(0.3f * roomSize, 2.0f);
+    pointLights.resize(numPointLights);
+
+    // a fixed seed keeps the lights in place, the generator is local so it leaves the
+    // global one alone
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+    for(int i = 0; i < numPointLights; ++i)
     {
-        return;
+        float x = distribution(generator);
+        float y = distribution(generator);
+        float z = distribution(generator);
+        float hue = distribution(generator);
+        QColor color = QColor::fromHsvF(hue, 0.7f, 1.0f);
+
+        pointLights[i].positionRadius = QVector4D((2.0f * x - 1.0f) * (roomSize - 1.0f),
+                                                  0.5f + y * (roomSize - 0.5f),
+                                                  (2.0f * z - 1.0f) * (roomSize - 1.0f),
+                                                  radius);
+        pointLights[i].colorIntensity = QVector4D(color.redF(), color.greenF(),
+                                                  color.blueF(), 1.0f);
     }
 
-    roomMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
-    makeCurrent();
-    glBindBuffer(GL_UNIFORM_BUFFER, UBORoomMaterial);
-    glBufferData(GL_UNIFORM_BUFFER, roomMaterial.getStructSize(),
-                 &roomMaterial, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    doneCurrent();
+    if(numPointLights > 0)
+    {
+        vboPointLights.bind();
+        vboPointLights.write(0, pointLights.constData(),
+                             numPointLights * PointLight().getStructSize());
+        vboPointLights.release();
+    }
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setCubeColor(float _r, float _g, float _b)
+void Renderer::setRoomSize(int _roomSize)
 {
-    if(!isValid())
+    POST_TO_RENDER_THREAD(setRoomSize(_roomSize));
+
+    if(hasGLContext())
     {
-        return;
+        makeCurrent();
     }
 
-    cubeMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
-    makeCurrent();
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOCubeMaterial);
-    glBufferData(GL_UNIFORM_BUFFER, cubeMaterial.getStructSize(),
-                 &cubeMaterial, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    doneCurrent();
+    roomSize = (float)_roomSize;
+    roomModelMatrix.setToIdentity();
+    roomModelMatrix.scale(roomSize);
+    roomModelMatrix.translate(0.0, 1.0, 0.0);
+    roomNormalMatrix = QMatrix4x4(roomModelMatrix.normalMatrix());
+
+    vboRoom.bind();
+    vboRoom.write(2 * cubeObject->getVertexOffset(),
+                  cubeObject->getTexureCoordinates(roomSize),
+                  cubeObject->getTexCoordOffset());
+    vboRoom.release();
+
+    if(vboSceneGeometry.isCreated())
+    {
+        vboSceneGeometry.bind();
+        vboSceneGeometry.write((6 * numSceneVertices +
+                                2 * sceneMeshRanges[SCENE_MESH_ROOM].baseVertex) * sizeof(GLfloat),
+                               cubeObject->getTexureCoordinates(roomSize),
+                               cubeObject->getTexCoordOffset());
+        vboSceneGeometry.release();
+    }
+
+    generateInstanceMatrices();
+    generatePointLights();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setMeshObjectColor(float _r, float _g, float _b)
+void Renderer::setNumInstances(int _numInstances)
 {
-    if(!isValid())
+    POST_TO_RENDER_THREAD(setNumInstances(_numInstances));
+
+    numInstances = qBound(0, _numInstances, MAX_NUM_INSTANCES);
+
+    if(!hasGLContext())
     {
         return;
     }
 
-    meshObjectMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
     makeCurrent();
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMeshObjectMaterial);
-    glBufferData(GL_UNIFORM_BUFFER, meshObjectMaterial.getStructSize(),
-                 &meshObjectMaterial, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    generateInstanceMatrices();
     doneCurrent();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setOccluderColor(float _r, float _g, float _b)
+void Renderer::setNumPointLights(int _numPointLights)
 {
-    if(!isValid())
+    POST_TO_RENDER_THREAD(setNumPointLights(_numPointLights));
+
+    numPointLights = qBound(0, _numPointLights, MAX_NUM_POINT_LIGHTS);
+
+    if(!hasGLContext())
     {
         return;
     }
 
-    occluderMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
     makeCurrent();
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOOccluderMaterial);
-    glBufferData(GL_UNIFORM_BUFFER, occluderMaterial.getStructSize(),
-                 &occluderMaterial, GL_STREAM_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    generatePointLights();
     doneCurrent();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::updateCamera()
+// the mesh object is normalized to [-1, 1] in its largest dimension, centered at the
+// origin and (for the teapot) rotated to stand up
+//------------------------------------------------------------------------------------------
+QMatrix4x4 Renderer::getMeshObjectLocalMatrix(float* _lowestY)
 {
-    zoomCamera();
-
-    /////////////////////////////////////////////////////////////////
-    // flush camera data to uniform buffer
-    viewMatrix.setToIdentity();
-    viewMatrix.lookAt(cameraPosition, cameraFocus, cameraUpDirection);
+    QVector3D boxMin = objLoader->getBoundMin();
+    QVector3D boxMax = objLoader->getBoundMax();
 
-    viewProjectionMatrix = projectionMatrix * viewMatrix;
-
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 2 * SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    viewProjectionMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-}
+    QMatrix4x4 localMatrix;
+    localMatrix.setToIdentity();
+    localMatrix.scale(1.0f / objLoader->getScalingFactor());
 
-//------------------------------------------------------------------------------------------
-QSize Renderer::sizeHint() const
-{
-    return QSize(1600, 1200);
-}
+    if(currentMeshObject.loadAcquire() == TEAPOT_OBJ)
+    {
+        localMatrix.rotate(-90, 1, 0, 0);
+    }
 
-//------------------------------------------------------------------------------------------
-QSize Renderer::minimumSizeHint() const
-{
-    return QSize(50, 50);
-}
+    localMatrix.translate(-0.5f * (boxMin + boxMax));
 
-//------------------------------------------------------------------------------------------
-void Renderer::initializeGL()
-{
-    initializeOpenGLFunctions();
-    checkOpenGLVersion();
+    *_lowestY = 1e10f;
 
-    if(!initializedScene)
+    for(int i = 0; i < 8; ++i)
     {
-        initScene();
-        initializedScene = true;
+        QVector3D corner((i & 1) ? boxMax.x() : boxMin.x(),
+                         (i & 2) ? boxMax.y() : boxMin.y(),
+                         (i & 4) ? boxMax.z() : boxMin.z());
+        *_lowestY = fmin(*_lowestY, (localMatrix * corner).y());
     }
-}
 
-//------------------------------------------------------------------------------------------
-void Renderer::resizeGL(int w, int h)
-{
-    projectionMatrix.setToIdentity();
-    projectionMatrix.perspective(45, (float)w / (float)h, 0.1f, 1000.0f);
+    return localMatrix;
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::paintGL()
+// distribute the instances of cube, mesh object and billboard on a regular grid covering
+// the room floor
+//------------------------------------------------------------------------------------------
+void Renderer::generateInstanceMatrices()
 {
-    if(!initializedScene)
+    if(!objLoader || !vboInstances[INSTANCED_CUBE].isCreated())
     {
         return;
     }
 
-    switch(currentMouseTransTarget)
-    {
-    case TRANSFORM_CAMERA:
+    int numCells = NUM_INSTANCED_OBJECTS * numInstances;
+    int gridSize = (int)ceil(sqrt((float)numCells));
+    float cellSize = (gridSize > 0) ? 2.0f * (roomSize - 1.0f) / (float)gridSize : 0.0f;
+    instanceScale = fmin(0.4f * cellSize, 1.0f);
+
+    float meshLowestY;
+    QMatrix4x4 meshLocalMatrix = getMeshObjectLocalMatrix(&meshLowestY);
+
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
     {
-        translateCamera();
-        rotateCamera();
+        instancePositions[i].clear();
+        instanceModelMatrices[i].clear();
+        instanceNormalMatrices[i].clear();
     }
-    break;
 
-    case TRANSFORM_LIGHT:
+    for(int cell = 0; cell < numCells; ++cell)
     {
-        translateLight();
+        InstancedObject object = static_cast<InstancedObject>(cell % NUM_INSTANCED_OBJECTS);
+        QVector3D position(-roomSize + 1.0f + ((cell % gridSize) + 0.5f) * cellSize,
+                           0.001f,
+                           -roomSize + 1.0f + ((cell / gridSize) + 0.5f) * cellSize);
+
+        QMatrix4x4 modelMatrix;
+        modelMatrix.setToIdentity();
+
+        switch(object)
+        {
+        case INSTANCED_CUBE:
+            modelMatrix.translate(position + QVector3D(0.0f, instanceScale, 0.0f));
+            modelMatrix.scale(instanceScale);
+            break;
+
+        case INSTANCED_MESH_OBJECT:
+            modelMatrix.translate(position - QVector3D(0.0f, meshLowestY * instanceScale, 0.0f));
+            modelMatrix.scale(instanceScale);
+            modelMatrix = modelMatrix * meshLocalMatrix;
+            break;
+
+        default:
+            break;
+        }
+
+        instancePositions[object].append(position);
+        instanceModelMatrices[object].append(modelMatrix);
+        instanceNormalMatrices[object].append(QMatrix4x4(modelMatrix.normalMatrix()));
     }
-    break;
 
-    case TRANSFORM_OBJECTS:
+    uploadInstanceMatrices(INSTANCED_CUBE);
+    uploadInstanceMatrices(INSTANCED_MESH_OBJECT);
+    updateBillboardInstanceMatrices();
+}
+
+//------------------------------------------------------------------------------------------
+// billboards always face the camera, thus their matrices are recomputed every frame
+//------------------------------------------------------------------------------------------
+void Renderer::updateBillboardInstanceMatrices()
+{
+    QVector<QVector3D>& positions = instancePositions[INSTANCED_BILLBOARD];
+
+    if(positions.size() == 0)
     {
-        translateObjects();
-        rotateObjects();
+        return;
     }
-    break;
 
-    case TRANSFORM_OCCLUDER:
+    float billboardScale = 2.0f * instanceScale;
+
+    for(int i = 0; i < positions.size(); ++i)
     {
-        translateOccluder();
-        rotateOccluder();
-        calculateOccluderFaceVertices();
-    }
-    break;
+        QVector3D cameraDir = cameraPosition - positions.at(i);
+        float angle = atan2(cameraDir.x(), cameraDir.z());
+
+        QMatrix4x4 modelMatrix;
+        modelMatrix.setToIdentity();
+        modelMatrix.translate(positions.at(i) + QVector3D(0.0f, billboardScale, 0.0f));
+        modelMatrix.rotate(angle * 180 / M_PI, QVector3D(0.0f, 1.0f, 0.0f));
+        modelMatrix.rotate(90, QVector3D(1.0f, 0.0f, 0.0f));
+        modelMatrix.scale(billboardScale);
+
+        instanceModelMatrices[INSTANCED_BILLBOARD][i] = modelMatrix;
+        instanceNormalMatrices[INSTANCED_BILLBOARD][i] = -QMatrix4x4(modelMatrix.normalMatrix());
     }
 
+    uploadInstanceMatrices(INSTANCED_BILLBOARD);
+}
 
-    updateCamera();
-
+//------------------------------------------------------------------------------------------
+QMatrix4x4 Renderer::getBillboardModelMatrix()
+{
+    QVector3D billboardPos = DEFAULT_BILLBOARD_OBJECT_POSITION;
+    QVector3D cameraDir = cameraPosition - cameraFocus;
+    float angle = atan2(billboardPos.x() - cameraDir.x(), billboardPos.z() - cameraDir.z()) ;
 
-    // render scene
-    renderScene();
+    QMatrix4x4 rotationMatrix = billboardObjectModelMatrix;
+    rotationMatrix.rotate(angle * 180 / M_PI, QVector3D(0.0f, 1.0f, 0.0f));
+    rotationMatrix.rotate(90, QVector3D(1.0f, 0.0f, 0.0f));
 
+    return rotationMatrix;
 }
 
-//-----------------------------------------------------------------------------------------
-void Renderer::mousePressEvent(QMouseEvent* _event)
+//------------------------------------------------------------------------------------------
+// refresh the per-draw matrices and rebuild the indirect commands of every draw group
+//------------------------------------------------------------------------------------------
+void Renderer::updateSceneDrawData()
 {
-    lastMousePos = QVector2D(_event->localPos());
-
-    if(_event->button() == Qt::RightButton)
+    if(!vboSceneDrawData.isCreated() || !vboSceneGeometry.isCreated())
     {
-        mouseButtonPressed = RIGHT_BUTTON;
+        return;
     }
-    else
+
+    /////////////////////////////////////////////////////////////////
+    // matrices of the single objects
+    QMatrix4x4 billboardModelMatrix = getBillboardModelMatrix();
+    QMatrix4x4 modelMatrices[NUM_SCENE_OBJECTS] =
     {
-        mouseButtonPressed = LEFT_BUTTON;
+        roomModelMatrix,
+        cubeModelMatrix,
+        meshObjectModelMatrix,
+        occluderModelMatrix,
+        billboardModelMatrix
+    };
+    QMatrix4x4 normalMatrices[NUM_SCENE_OBJECTS] =
+    {
+        roomNormalMatrix,
+        cubeNormalMatrix,
+        meshObjectNormalMatrix,
+        occluderNormalMatrix,
+        -QMatrix4x4(billboardModelMatrix.normalMatrix())
+    };
 
-        if(currentMouseTransTarget == TRANSFORM_LIGHT)
-        {
-            mouseButtonPressed = RIGHT_BUTTON;
-        }
+    GLfloat drawData[NUM_SCENE_OBJECTS * 2 * 16];
+
+    for(int i = 0; i < NUM_SCENE_OBJECTS; ++i)
+    {
+        memcpy(&drawData[i * 32], modelMatrices[i].constData(), SIZE_OF_MAT4);
+        memcpy(&drawData[i * 32 + 16], normalMatrices[i].constData(), SIZE_OF_MAT4);
     }
-}
 
-//-----------------------------------------------------------------------------------------
-void Renderer::mouseMoveEvent(QMouseEvent* _event)
-{
-    QVector2D mouseMoved = QVector2D(_event->localPos()) - lastMousePos;
+    vboSceneDrawData.bind();
+    vboSceneDrawData.write(0, drawData, NUM_SCENE_OBJECTS * SIZE_OF_INSTANCE_DATA);
+    vboSceneDrawData.release();
 
-    switch(specialKeyPressed)
-    {
-    case Renderer::NO_KEY:
+    /////////////////////////////////////////////////////////////////
+    // the instance matrices are already on the GPU, copy them into their regions
+    int instanceBase[NUM_INSTANCED_OBJECTS];
+    int instanceCount[NUM_INSTANCED_OBJECTS];
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vboSceneDrawData.bufferId());
+
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
     {
+        instanceBase[i] = NUM_SCENE_OBJECTS + i * MAX_NUM_INSTANCES;
+        instanceCount[i] = numUploadedInstances[i];
 
-        if(mouseButtonPressed == RIGHT_BUTTON)
-        {
-            translation.setX(translation.x() + mouseMoved.x() / 50.0f);
-            translation.setY(translation.y() - mouseMoved.y() / 50.0f);
-        }
-        else
+        if(instanceCount[i] == 0)
         {
-            rotation.setX(rotation.x() - mouseMoved.x() / 5.0f);
-            rotation.setY(rotation.y() - mouseMoved.y() / 5.0f);
+            continue;
         }
 
+        glBindBuffer(GL_COPY_READ_BUFFER, vboInstances[i].bufferId());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                            instanceBase[i] * SIZE_OF_INSTANCE_DATA,
+                            instanceCount[i] * SIZE_OF_INSTANCE_DATA);
     }
-    break;
 
-    case Renderer::SHIFT_KEY:
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // build the draw commands, grouped by render state
+    int numCubeIndices = sceneMeshRanges[SCENE_MESH_CUBE].numIndices;
+    int numMeshObjectIndices = sceneMeshRanges[SCENE_MESH_OBJECT].numIndices;
+    int numBillboardIndices = sceneMeshRanges[SCENE_MESH_BILLBOARD].numIndices;
+
+    // culled single objects are drawn with no instance
+    int numVisibleCubes = isSceneObjectVisible(SCENE_OBJECT_CUBE) ? 1 : 0;
+    int numVisibleMeshObjects = isSceneObjectVisible(SCENE_OBJECT_MESH) ? 1 : 0;
+    int numVisibleOccluders = isSceneObjectVisible(SCENE_OBJECT_OCCLUDER) ? 1 : 0;
+    int numVisibleBillboards = isSceneObjectVisible(SCENE_OBJECT_BILLBOARD) ? 1 : 0;
+
+    sceneDrawCommands.clear();
+
+    for(int i = 0; i < NUM_DRAW_GROUPS; ++i)
     {
-        if(mouseButtonPressed == RIGHT_BUTTON)
-        {
-            QVector2D dir = mouseMoved.normalized();
-            zooming += mouseMoved.length() * dir.x() / 500.0f;
-        }
-        else
+        drawGroupFirstCommand[i] = sceneDrawCommands.size();
+
+        switch(i)
         {
-            rotation.setX(rotation.x() + mouseMoved.x() / 5.0f);
-            rotation.setZ(rotation.z() + mouseMoved.y() / 5.0f);
+        case DRAW_GROUP_ROOM_WALLS:
+            appendDrawCommand(SCENE_MESH_ROOM, 0, 24, 1, SCENE_OBJECT_ROOM);
+            break;
+
+        case DRAW_GROUP_FLOOR:
+            appendDrawCommand(SCENE_MESH_ROOM, 24, 6, 1, SCENE_OBJECT_ROOM);
+            break;
+
+        case DRAW_GROUP_CEILING:
+            appendDrawCommand(SCENE_MESH_ROOM, 30, 6, 1, SCENE_OBJECT_ROOM);
+            break;
+
+        case DRAW_GROUP_CUBES:
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices, numVisibleCubes,
+                              SCENE_OBJECT_CUBE);
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices,
+                              instanceCount[INSTANCED_CUBE], instanceBase[INSTANCED_CUBE]);
+            break;
+
+        case DRAW_GROUP_MESH_OBJECTS:
+            appendDrawCommand(SCENE_MESH_OBJECT, 0, numMeshObjectIndices, numVisibleMeshObjects,
+                              SCENE_OBJECT_MESH);
+            appendDrawCommand(SCENE_MESH_OBJECT, 0, numMeshObjectIndices,
+                              instanceCount[INSTANCED_MESH_OBJECT],
+                              instanceBase[INSTANCED_MESH_OBJECT]);
+            break;
+
+        case DRAW_GROUP_OCCLUDER:
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices, numVisibleOccluders,
+                              SCENE_OBJECT_OCCLUDER);
+            break;
+
+        case DRAW_GROUP_BILLBOARDS:
+        case DRAW_GROUP_ALPHA_CASTERS:
+            appendDrawCommand(SCENE_MESH_BILLBOARD, 0, numBillboardIndices, numVisibleBillboards,
+                              SCENE_OBJECT_BILLBOARD);
+            appendDrawCommand(SCENE_MESH_BILLBOARD, 0, numBillboardIndices,
+                              instanceCount[INSTANCED_BILLBOARD],
+                              instanceBase[INSTANCED_BILLBOARD]);
+            break;
+
+        case DRAW_GROUP_OPAQUE_CASTERS:
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices, numVisibleCubes,
+                              SCENE_OBJECT_CUBE);
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices,
+                              instanceCount[INSTANCED_CUBE], instanceBase[INSTANCED_CUBE]);
+            appendDrawCommand(SCENE_MESH_OBJECT, 0, numMeshObjectIndices, numVisibleMeshObjects,
+                              SCENE_OBJECT_MESH);
+            appendDrawCommand(SCENE_MESH_OBJECT, 0, numMeshObjectIndices,
+                              instanceCount[INSTANCED_MESH_OBJECT],
+                              instanceBase[INSTANCED_MESH_OBJECT]);
+            appendDrawCommand(SCENE_MESH_CUBE, 0, numCubeIndices, numVisibleOccluders,
+                              SCENE_OBJECT_OCCLUDER);
+            break;
+
+        default:
+            break;
         }
-    }
-    break;
-
-    case Renderer::CTRL_KEY:
-        break;
 
+        drawGroupNumCommands[i] = sceneDrawCommands.size() - drawGroupFirstCommand[i];
     }
 
-    lastMousePos = QVector2D(_event->localPos());
-    update();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectDrawBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+                    sceneDrawCommands.size() * sizeof(DrawElementsIndirectCommand),
+                    sceneDrawCommands.constData());
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::mouseReleaseEvent(QMouseEvent* _event)
+void Renderer::appendDrawCommand(SceneMesh _mesh, int _firstIndex, int _numIndices,
+                                 int _numInstances, int _baseInstance)
 {
-    mouseButtonPressed = NO_BUTTON;
+    if(_numInstances == 0)
+    {
+        return;
+    }
+
+    TRUE_OR_DIE(sceneDrawCommands.size() < MAX_NUM_DRAW_COMMANDS,
+                "Too many indirect draw commands.");
+
+    DrawElementsIndirectCommand command;
+    command.count = _numIndices;
+    command.instanceCount = _numInstances;
+    command.firstIndex = sceneMeshRanges[_mesh].firstIndex + _firstIndex;
+    command.baseVertex = sceneMeshRanges[_mesh].baseVertex;
+    command.baseInstance = _baseInstance;
+
+    sceneDrawCommands.append(command);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::wheelEvent(QWheelEvent* _event)
+// with a culling pass given, only the instances visible in that pass are uploaded
+//------------------------------------------------------------------------------------------
+void Renderer::uploadInstanceMatrices(InstancedObject _object, CullingPass _pass)
 {
-    if(!_event->angleDelta().isNull())
+    const QVector<QMatrix4x4>& modelMatrices = instanceModelMatrices[_object];
+    const QVector<QMatrix4x4>& normalMatrices = instanceNormalMatrices[_object];
+    int numVisibleInstances = (_pass == UNCULLED_PASS) ? modelMatrices.size() :
+                              visibleInstances[_pass][_object].size();
+    int numObjectInstances = qMax(numVisibleInstances, 1);
+
+    // without culling the instances are in their own order, unless they were sorted
+    const QVector<int>& instanceOrder = (_pass == UNCULLED_PASS) ? unculledInstances[_object] :
+                                        visibleInstances[_pass][_object];
+    bool ordered = (_pass != UNCULLED_PASS) || (instanceOrder.size() == numVisibleInstances);
+
+    // QMatrix4x4 carries extra flags, so it cannot be copied to the buffer as an array
+    QVector<GLfloat> instanceData(numObjectInstances * 2 * 16, 0.0f);
+
+    for(int i = 0; i < numVisibleInstances; ++i)
     {
-        zooming +=  (_event->angleDelta().x() + _event->angleDelta().y()) / 500.0f;
+        int index = ordered ? instanceOrder.at(i) : i;
+        memcpy(&instanceData[i * 32], modelMatrices.at(index).constData(), SIZE_OF_MAT4);
+        memcpy(&instanceData[i * 32 + 16], normalMatrices.at(index).constData(), SIZE_OF_MAT4);
     }
 
-    update();
+    vboInstances[_object].bind();
+    vboInstances[_object].allocate(instanceData.constData(),
+                                   numObjectInstances * SIZE_OF_INSTANCE_DATA);
+    vboInstances[_object].release();
+
+    numUploadedInstances[_object] = numVisibleInstances;
+    instanceUploadPass[_object] = _pass;
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::setShadingMode(ShadingProgram _shadingMode)
+void Renderer::setAmbientLight(int _ambientLight)
 {
-    currentShadingMode = _shadingMode;
-    currentShadingProgram = glslPrograms[currentShadingMode];
+    POST_TO_RENDER_THREAD(setAmbientLight(_ambientLight));
 
-    update();
+    ambientLight = (float) _ambientLight / 100.0f;
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::resetCameraPosition()
+void Renderer::setLightIntensity(int _intensity)
 {
-    cameraPosition = DEFAULT_CAMERA_POSITION;
-    cameraFocus = DEFAULT_CAMERA_FOCUS;
-    cameraUpDirection = QVector3D(0.0f, 1.0f, 0.0f);
+    POST_TO_RENDER_THREAD(setLightIntensity(_intensity));
 
-    update();
-}
-
-//------------------------------------------------------------------------------------------
-void Renderer::enableDepthTest(bool _status)
-{
-    if(!isValid())
+    if(!hasGLContext())
     {
         return;
     }
 
     makeCurrent();
-
-    if(_status)
-    {
-        glEnable(GL_DEPTH_TEST);
-    }
-    else
-    {
-        glDisable(GL_DEPTH_TEST);
-    }
-
+    light.intensity = (GLfloat)_intensity / 100.0f;
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                 &light, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
     doneCurrent();
-    update();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::enableZAxisRotation(bool _status)
+void Renderer::resetObjectPositions()
 {
-    enabledZAxisRotation = _status;
+    POST_TO_RENDER_THREAD(resetObjectPositions());
 
-    if(!enabledZAxisRotation)
-    {
-        cameraUpDirection = QVector3D(0.0f, 1.0f, 0.0f);
-    }
+    makeCurrent();
+    initSceneMatrices();
+    doneCurrent();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::enableTextureAnisotropicFiltering(bool _state)
+void Renderer::resetLightPosition()
 {
-    enabledTextureAnisotropicFiltering = _state;
+    setLightPosition(QVector3D(DEFAULT_LIGHT_POSITION));
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::enableShowShadowVolume(bool _state)
+void Renderer::setLightPosition(const QVector3D& _position)
 {
-    enabledShowShadowVolume = _state;
-}
+    POST_TO_RENDER_THREAD(setLightPosition(_position));
 
-//------------------------------------------------------------------------------------------
-void Renderer::setMouseTransformationTarget(MouseTransformationTarget _mouseTarget)
-{
-    currentMouseTransTarget = _mouseTarget;
-}
+    makeCurrent();
+    light.position = QVector4D(_position, 1.0f);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                 &light, GL_STREAM_DRAW);
 
-//------------------------------------------------------------------------------------------
-void Renderer::setShadowMethod(ShadowModes _shadowMode)
-{
-    currentShadowMode = _shadowMode;
+    lightViewMatrix.setToIdentity();
+    lightViewMatrix.lookAt(QVector3D(light.position), QVector3D(0, 0, 0), QVector3D(0, 0,
+                                                                                    -1));
+    shadowMatrix = lightProjectionMatrix * lightViewMatrix;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    shadowMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    doneCurrent();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::keyPressEvent(QKeyEvent* _event)
+// The mesh is loaded by the mesh loader and uploaded when it is ready, headless frames
+// need it right away and load it here.
+//------------------------------------------------------------------------------------------
+void Renderer::setMeshObject(int _objectIndex)
 {
-    switch(_event->key())
+    if(!hasGLContext())
     {
-    case Qt::Key_Shift:
-        specialKeyPressed = Renderer::SHIFT_KEY;
-        break;
-
-    case Qt::Key_Plus:
-        zooming -= 0.1f;
-        break;
-
-    case Qt::Key_Minus:
-        zooming += 0.1f;
-        break;
+        return;
+    }
 
-    case Qt::Key_Up:
-        translation += QVector3D(0.0f, 0.3f, 0.0f);
-        break;
+    if(_objectIndex < 0 || _objectIndex >= NUM_MESH_OBJECT)
+    {
+        return;
+    }
 
-    case Qt::Key_Down:
-        translation -= QVector3D(0.0f, 0.3f, 0.0f);
-        break;
+    if(headlessContext)
+    {
+        qint64 loadBegin = getProfilerTime();
+        QSharedPointer<OBJLoader> loadedObject(MeshLoader::loadMeshObject(_objectIndex));
 
-    case Qt::Key_Left:
-        translation -= QVector3D(0.3f, 0.0f, 0.0f);
-        break;
+        if(!loadedObject)
+        {
+            PRINT_ERROR("Could not load OBJ file!");
+            return;
+        }
 
-    case Qt::Key_Right:
-        translation += QVector3D(0.3f, 0.0f, 0.0f);
-        break;
+        QVector<PlanarPatch> patches = loadedObject->getPlanarPatches(MIN_MESH_RECEIVER_AREA,
+                                                                      MAX_NUM_RECEIVER_PLANES);
+        uploadMeshObject(_objectIndex, loadedObject, patches, loadBegin, getProfilerTime());
+        return;
+    }
 
-    default:
-        QOpenGLWidget::keyPressEvent(_event);
+    if(!meshLoader)
+    {
+        meshLoader = new MeshLoader(this);
+        connect(meshLoader, &MeshLoader::progressChanged, this,
+                &Renderer::meshObjectLoadProgress);
     }
+
+    meshLoader->requestMeshObject(_objectIndex);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::keyReleaseEvent(QKeyEvent* _event)
+// the profiler clock, which the mesh loader reads from its own thread to time the loads
+//------------------------------------------------------------------------------------------
+qint64 Renderer::getProfilerTime()
 {
-    specialKeyPressed = Renderer::NO_KEY;
+    return profiler.getCPUTime();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::translateCamera()
+// takes over the loaded mesh, the old one is drawn up to here; the load, timed where it
+// ran, is traced here as the profiler belongs to the render thread
+//------------------------------------------------------------------------------------------
+void Renderer::uploadMeshObject(int _meshIndex, QSharedPointer<OBJLoader> _objLoader,
+                                const QVector<PlanarPatch>& _patches, qint64 _loadBegin,
+                                qint64 _loadEnd)
 {
-    translation *= MOVING_INERTIA;
+    POST_TO_RENDER_THREAD(uploadMeshObject(_meshIndex, _objLoader, _patches, _loadBegin,
+                                           _loadEnd));
 
-    if(translation.lengthSquared() < 1e-4)
+    profiler.traceLoaderEvent("loadMeshObject", _loadBegin, _loadEnd);
+    Profiler::Scope profilerScope(&profiler, "uploadMeshObject");
+
+    currentMeshObject.storeRelease(_meshIndex);
+    objLoader = _objLoader;
+    meshObjectPatches = _patches;
+
+    makeCurrent();
+    initMeshObjectBuffers();
+    initSceneGeometryMemory();
+
+    // the programs not created yet make their VAOs from the new buffers later
+    for(int i = 0; i < NUM_SHADING_MODE; ++i)
     {
-        return;
-    }
+        ShadingProgram shadingMode = static_cast<ShadingProgram>(i);
 
-    QVector3D eyeVector = cameraFocus - cameraPosition;
-    float scale = sqrt(eyeVector.length()) * 0.01f;
+        if(glslPrograms[shadingMode] &&
+           (shadingMode == GOURAUD_SHADING || shadingMode == PHONG_SHADING ||
+            shadingMode == PROJECTED_OBJECT_SHADING || shadingMode == SHADOW_MAP_SHADING ||
+            shadingMode == GBUFFER_SHADING))
+        {
+            initMeshObjectVAO(shadingMode);
+            initSceneGeometryVAO(shadingMode);
+        }
+    }
 
-    QVector3D u(0.0f, 1.0f, 0.0f);
-    QVector3D v = QVector3D::crossProduct(eyeVector, u);
-    u = QVector3D::crossProduct(v, eyeVector);
-    u.normalize();
-    v.normalize();
+    resetObjectPositions();
+    generateInstanceMatrices();
 
-    cameraPosition -= scale * (translation.x() * v + translation.y() * u);
-    cameraFocus -= scale * (translation.x() * v + translation.y() * u);
+    doneCurrent();
 
+    emit meshObjectLoadProgress(100);
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::rotateCamera()
+// All levels go through one pixel unpack buffer, so the driver copies them from there
+// instead of from the client memory. An uncompressed upload with a compressed internal
+// format is compressed by the driver, and read back once to fill the texture cache.
+//------------------------------------------------------------------------------------------
+void Renderer::uploadStreamedTexture(const StreamedTexture& _texture)
 {
-    rotation *= MOVING_INERTIA;
+    POST_TO_RENDER_THREAD(uploadStreamedTexture(_texture));
 
-    if(rotation.lengthSquared() < 1e-4)
-    {
-        return;
-    }
+    Profiler::Scope profilerScope(&profiler, "uploadStreamedTexture");
 
-    QVector3D nEyeVector = cameraPosition - cameraFocus ;
+    makeCurrent();
 
-    float scale = sqrt(nEyeVector.length()) * 0.02f;
-    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(1, 0, 0),
-                                                          rotation.y() * scale) *
-                            QQuaternion::fromAxisAndAngle(QVector3D(0, 1, 0), rotation.x() * scale) *
-                            QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z() * scale);
-    nEyeVector = qRotation.rotatedVector(nEyeVector);
+    ////////////////////////////////////////////////////////////////////////////////
+    // stage the levels
+    QVector<GLintptr> levelOffsets;
+    GLsizeiptr stagingSize = 0;
 
-    cameraPosition = cameraFocus + nEyeVector;
+    for(int i = 0; i < _texture.levels.size(); ++i)
+    {
+        levelOffsets.append(stagingSize);
+        stagingSize += _texture.levels[i].data.size();
+    }
 
-    if(enabledZAxisRotation)
+    if(pboTextureUpload == 0)
     {
-        cameraUpDirection = qRotation.rotatedVector(cameraUpDirection);
+        glGenBuffers(1, &pboTextureUpload);
     }
-}
 
-//------------------------------------------------------------------------------------------
-void Renderer::zoomCamera()
-{
-    zooming *= MOVING_INERTIA;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pboTextureUpload);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingSize, NULL, GL_STREAM_DRAW);
+    char* stagingData = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                                                            stagingSize,
+                                                            GL_MAP_WRITE_BIT |
+                                                            GL_MAP_INVALIDATE_BUFFER_BIT));
 
-    if(fabs(zooming) < 1e-4)
+    // the placeholder stays in use when the staging buffer cannot be mapped
+    if(!stagingData)
     {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        doneCurrent();
+        PRINT_ERROR("Could not map the texture staging buffer!");
         return;
     }
 
-    QVector3D nEyeVector = cameraPosition - cameraFocus ;
-    float len = nEyeVector.length();
-    nEyeVector.normalize();
+    for(int i = 0; i < _texture.levels.size(); ++i)
+    {
+        memcpy(stagingData + levelOffsets[i], _texture.levels[i].data.constData(),
+               _texture.levels[i].data.size());
+    }
 
-    len += sqrt(len) * zooming * 0.3f;
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 
-    if(len < 0.5f)
+    ////////////////////////////////////////////////////////////////////////////////
+    // upload
+    QOpenGLTexture* texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+    texture->create();
+    texture->bind();
+
+    for(int i = 0; i < _texture.levels.size(); ++i)
     {
-        len = 0.5f;
+        const StreamedTextureLevel& level = _texture.levels[i];
+
+        if(_texture.compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, _texture.internalFormat,
+                                   level.width, level.height, 0, level.data.size(),
+                                   reinterpret_cast<const GLvoid*>(levelOffsets[i]));
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, _texture.internalFormat,
+                         level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         reinterpret_cast<const GLvoid*>(levelOffsets[i]));
+        }
     }
 
-    cameraPosition = len * nEyeVector + cameraFocus;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _texture.levels.size() - 1);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-}
+    ////////////////////////////////////////////////////////////////////////////////
+    // first run, keep what the driver compressed
+    if(!_texture.compressed && _texture.internalFormat != GL_RGBA8)
+    {
+        GLint isCompressed = GL_FALSE;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &isCompressed);
 
-//------------------------------------------------------------------------------------------
-void Renderer::translateObjects()
-{
-    translation *= MOVING_INERTIA;
+        if(isCompressed == GL_TRUE)
+        {
+            StreamedTexture compressedTexture = _texture;
+            compressedTexture.compressed = true;
 
-    if(translation.lengthSquared() < 1e-4)
-    {
-        return;
+            for(int i = 0; i < compressedTexture.levels.size(); ++i)
+            {
+                GLint compressedSize = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE,
+                                         &compressedSize);
+                compressedTexture.levels[i].data.resize(compressedSize);
+                glGetCompressedTexImage(GL_TEXTURE_2D, i,
+                                        compressedTexture.levels[i].data.data());
+            }
+
+            textureStreamer->writeCache(compressedTexture);
+        }
     }
 
-    QVector3D eyeVector = cameraFocus - cameraPosition;
-    float scale = sqrt(eyeVector.length()) * 0.05f;
+    texture->release();
 
-    QVector3D u(0.0f, 1.0f, 0.0f);
-    QVector3D v = QVector3D::crossProduct(eyeVector, u);
-    u = QVector3D::crossProduct(v, eyeVector);
-    u.normalize();
-    v.normalize();
+    ////////////////////////////////////////////////////////////////////////////////
+    // swap in place of the placeholder
+    QOpenGLTexture* placeholder = *_texture.texture;
+    texture->setMinificationFilter(placeholder->minificationFilter());
+    texture->setMagnificationFilter(placeholder->magnificationFilter());
+    texture->setWrapMode(QOpenGLTexture::DirectionS,
+                         placeholder->wrapMode(QOpenGLTexture::DirectionS));
+    texture->setWrapMode(QOpenGLTexture::DirectionT,
+                         placeholder->wrapMode(QOpenGLTexture::DirectionT));
+    delete placeholder;
+    *_texture.texture = texture;
 
-    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
-    QMatrix4x4 translationMatrix;
-    translationMatrix.setToIdentity();
-    translationMatrix.translate(objectTrans);
+    doneCurrent();
 
-    cubeModelMatrix = translationMatrix * cubeModelMatrix;
-    meshObjectModelMatrix = translationMatrix * meshObjectModelMatrix;
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::rotateObjects()
+void Renderer::setFloorTexture(FloorTexture _texture)
 {
-    rotation *= MOVING_INERTIA;
-
-    if(rotation.lengthSquared() < 1e-4)
-    {
-        return;
-    }
+    POST_TO_RENDER_THREAD(setFloorTexture(_texture));
 
-    QVector3D currentPos(0.0f, 0.0f, 0.0f);
-    currentPos = cubeModelMatrix * currentPos;
+    currentFloorTexture = _texture;
+}
 
-    float scale = -0.2f;
-    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(0.0f, 1.0f, 0.0f),
-                                                          rotation.x() * scale) *
-                            QQuaternion::fromAxisAndAngle(QVector3D(1.0f, 0.0f, 0.0f), rotation.y() * scale);
-    //*
-    //                      QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z()*scale);
+//------------------------------------------------------------------------------------------
+void Renderer::setFloorTextureFilteringMode(QOpenGLTexture::Filter
+                                            _textureFiltering)
+{
+    POST_TO_RENDER_THREAD(setFloorTextureFilteringMode(_textureFiltering));
 
-    QMatrix4x4 rotationMatrix;
-    rotationMatrix.setToIdentity();
-    rotationMatrix.rotate(qRotation);
+    for(int i = 0; i < NUM_FLOOR_TEXTURES; ++i)
+    {
+        floorTextures[i]->setMinMagFilters(_textureFiltering, _textureFiltering);
+    }
+}
 
-    QMatrix4x4 invTranslationMatrix, translationMatrix;
-    invTranslationMatrix.setToIdentity();
-    invTranslationMatrix.translate(-1.0f * currentPos);
-    translationMatrix.setToIdentity();
-    translationMatrix.translate(currentPos);
+//------------------------------------------------------------------------------------------
+void Renderer::setRoomColor(float _r, float _g, float _b)
+{
+    POST_TO_RENDER_THREAD(setRoomColor(_r, _g, _b));
 
-    cubeModelMatrix = translationMatrix * rotationMatrix * invTranslationMatrix *
-                      cubeModelMatrix;
-    meshObjectModelMatrix = translationMatrix * rotationMatrix *
-                            invTranslationMatrix *
-                            meshObjectModelMatrix;
+    if(!hasGLContext())
+    {
+        return;
+    }
 
-    cubeNormalMatrix = QMatrix4x4(cubeModelMatrix.normalMatrix());
-    meshObjectNormalMatrix = QMatrix4x4(meshObjectModelMatrix.normalMatrix());
+    roomMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
+    makeCurrent();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBORoomMaterial);
+    glBufferData(GL_UNIFORM_BUFFER, roomMaterial.getStructSize(),
+                 &roomMaterial, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    doneCurrent();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::translateLight()
+void Renderer::setCubeColor(float _r, float _g, float _b)
 {
-    translation *= MOVING_INERTIA;
+    POST_TO_RENDER_THREAD(setCubeColor(_r, _g, _b));
 
-    if(translation.lengthSquared() < 1e-4)
+    if(!hasGLContext())
     {
         return;
     }
 
-    QVector3D eyeVector = cameraFocus - cameraPosition;
-    float scale = sqrt(eyeVector.length()) * 0.05f;
+    cubeMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
+    makeCurrent();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOCubeMaterial);
+    glBufferData(GL_UNIFORM_BUFFER, cubeMaterial.getStructSize(),
+                 &cubeMaterial, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    doneCurrent();
+}
 
-    QVector3D u(0.0f, 1.0f, 0.0f);
-    QVector3D v = QVector3D::crossProduct(eyeVector, u);
-    u = QVector3D::crossProduct(v, eyeVector);
-    u.normalize();
-    v.normalize();
+//------------------------------------------------------------------------------------------
+void Renderer::setMeshObjectColor(float _r, float _g, float _b)
+{
+    POST_TO_RENDER_THREAD(setMeshObjectColor(_r, _g, _b));
 
-    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
-    QMatrix4x4 translationMatrix;
-    translationMatrix.setToIdentity();
-    translationMatrix.translate(objectTrans);
+    if(!hasGLContext())
+    {
+        return;
+    }
 
-    light.position = translationMatrix * light.position;
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
-    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
-                 &light, GL_STREAM_DRAW);
+    meshObjectMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
+    makeCurrent();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMeshObjectMaterial);
+    glBufferData(GL_UNIFORM_BUFFER, meshObjectMaterial.getStructSize(),
+                 &meshObjectMaterial, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    doneCurrent();
+}
 
-    lightViewMatrix.setToIdentity();
-    lightViewMatrix.lookAt(QVector3D(light.position), QVector3D(0, 0, 0), QVector3D(0, 0,
-                                                                                    -1));
-    shadowMatrix = lightProjectionMatrix * lightViewMatrix;
+//------------------------------------------------------------------------------------------
+void Renderer::setOccluderColor(float _r, float _g, float _b)
+{
+    POST_TO_RENDER_THREAD(setOccluderColor(_r, _g, _b));
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    shadowMatrix.constData());
+    if(!hasGLContext())
+    {
+        return;
+    }
+
+    occluderMaterial.setDiffuse(QVector4D(_r, _g, _b, 1.0f));
+    makeCurrent();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOOccluderMaterial);
+    glBufferData(GL_UNIFORM_BUFFER, occluderMaterial.getStructSize(),
+                 &occluderMaterial, GL_STREAM_DRAW);
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    doneCurrent();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::calculateOccluderFaceVertices()
+// Runs the update steps of the time since the last frame, UPDATE_TIME_STEP each, so the
+// motion does not depend on the frame rate. The left-over time interpolates the rendered
+// camera between the last two steps. The clock restarts when the scene was idle, and a
+// headless frame always takes exactly one step, so offscreen runs are reproducible.
+//------------------------------------------------------------------------------------------
+void Renderer::updateSimulation()
 {
-    for(int i = 0; i < cubeObject->getNumFaceTriangles(); ++i)
+    Profiler::Scope profilerScope(&profiler, "updateSimulation");
+
+    int numSteps = 1;
+    float interpolation = 1.0f;
+
+    if(!headlessContext)
     {
-        UnitCube::CubeFaceTriangle* face = occluderFaces[i];
-        face->faceNormal = occluderNormalMatrix * cubeObject->getFace(i).faceNormal;
+        if(!updateTimer.isValid())
+        {
+            updateTimer.start();
+            updateTimeAccumulator = UPDATE_TIME_STEP;
+        }
+        else
+        {
+            updateTimeAccumulator += updateTimer.restart();
+        }
 
-        for(int j = 0; j < 3; ++j)
+        numSteps = static_cast<int>(updateTimeAccumulator / UPDATE_TIME_STEP);
+
+        // drop the time that cannot be caught up with
+        if(numSteps > MAX_NUM_UPDATE_STEPS)
         {
-            QVector4D transformedVertex = occluderModelMatrix *
-                                          QVector4D((cubeObject->getFace(i)).vertices[j], 1.0);
-            face->vertices[j] = QVector3D(transformedVertex);
-            face->indices[j] = cubeObject->getFace(i).indices[j];
+            numSteps = MAX_NUM_UPDATE_STEPS;
+            updateTimeAccumulator = numSteps * UPDATE_TIME_STEP;
         }
+
+        updateTimeAccumulator -= numSteps * UPDATE_TIME_STEP;
+        interpolation = static_cast<float>(updateTimeAccumulator) / UPDATE_TIME_STEP;
     }
-}
 
-//------------------------------------------------------------------------------------------
-void Renderer::translateOccluder()
-{
-    translation *= MOVING_INERTIA;
+    cameraPosition = steppedCameraPosition;
+    cameraFocus = steppedCameraFocus;
+    cameraUpDirection = steppedCameraUpDirection;
 
-    if(translation.lengthSquared() < 1e-4)
+    for(int i = 0; i < numSteps; ++i)
     {
-        return;
-    }
+        previousCameraPosition = cameraPosition;
+        previousCameraFocus = cameraFocus;
+        previousCameraUpDirection = cameraUpDirection;
 
-    QVector3D eyeVector = cameraFocus - cameraPosition;
-    float scale = sqrt(eyeVector.length()) * 0.05f;
+        stepSimulation();
+    }
 
-    QVector3D u(0.0f, 1.0f, 0.0f);
-    QVector3D v = QVector3D::crossProduct(eyeVector, u);
-    u = QVector3D::crossProduct(v, eyeVector);
-    u.normalize();
-    v.normalize();
+    steppedCameraPosition = cameraPosition;
+    steppedCameraFocus = cameraFocus;
+    steppedCameraUpDirection = cameraUpDirection;
 
-    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
-    QMatrix4x4 translationMatrix;
-    translationMatrix.setToIdentity();
-    translationMatrix.translate(objectTrans);
+    // the motion stopped, show where it stopped as no more frames may follow
+    if(!hasInertia())
+    {
+        interpolation = 1.0f;
+        updateTimer.invalidate();
+    }
 
-    occluderModelMatrix = translationMatrix * occluderModelMatrix;
+    cameraPosition = previousCameraPosition +
+                     (steppedCameraPosition - previousCameraPosition) * interpolation;
+    cameraFocus = previousCameraFocus +
+                  (steppedCameraFocus - previousCameraFocus) * interpolation;
+    cameraUpDirection = (previousCameraUpDirection +
+                         (steppedCameraUpDirection - previousCameraUpDirection) *
+                         interpolation).normalized();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::rotateOccluder()
+void Renderer::stepSimulation()
 {
-    rotation *= MOVING_INERTIA;
+    switch(currentMouseTransTarget)
+    {
+    case TRANSFORM_CAMERA:
+    {
+        translateCamera();
+        rotateCamera();
+    }
+    break;
 
-    if(rotation.lengthSquared() < 1e-4)
+    case TRANSFORM_LIGHT:
     {
-        return;
+        translateLight();
     }
+    break;
 
-    QVector3D currentPos(0.0f, 0.0f, 0.0f);
-    currentPos = occluderModelMatrix * currentPos;
+    case TRANSFORM_OBJECTS:
+    {
+        translateObjects();
+        rotateObjects();
+    }
+    break;
 
-    float scale = -0.2f;
-    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(0.0f, 1.0f, 0.0f),
-                                                          rotation.x() * scale) *
-                            QQuaternion::fromAxisAndAngle(QVector3D(1.0f, 0.0f, 0.0f), rotation.y() * scale);
-    //*
-    //                      QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z()*scale);
+    case TRANSFORM_OCCLUDER:
+    {
+        translateOccluder();
+        rotateOccluder();
+        calculateOccluderFaceVertices();
+    }
+    break;
+    }
 
-    QMatrix4x4 rotationMatrix;
-    rotationMatrix.setToIdentity();
-    rotationMatrix.rotate(qRotation);
+    zoomCamera();
+}
 
-    QMatrix4x4 invTranslationMatrix, translationMatrix;
-    invTranslationMatrix.setToIdentity();
-    invTranslationMatrix.translate(-1.0f * currentPos);
-    translationMatrix.setToIdentity();
-    translationMatrix.translate(currentPos);
+//------------------------------------------------------------------------------------------
+void Renderer::updateCamera()
+{
+    /////////////////////////////////////////////////////////////////
+    // flush camera data to uniform buffer
+    viewMatrix.setToIdentity();
+    viewMatrix.lookAt(cameraPosition, cameraFocus, cameraUpDirection);
 
-    occluderModelMatrix = translationMatrix * rotationMatrix * invTranslationMatrix *
-                          occluderModelMatrix;
-    occluderNormalMatrix = QMatrix4x4(occluderModelMatrix.normalMatrix());
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 2 * SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    viewProjectionMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderTestScene()
+QSize Renderer::sizeHint() const
 {
-    if(!initializedTestScene)
-    {
-        initTestScene();
-        return;
-    }
+    return QSize(1600, 1200);
+}
 
-    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(testProgram->programId());
-    glBindVertexArray (vao);
-    // draw points 0-3 from the currently bound VAO with current in-use shader
-    glDrawArrays (GL_TRIANGLES, 0, 3);
-    glUseProgram(0);
+//------------------------------------------------------------------------------------------
+QSize Renderer::minimumSizeHint() const
+{
+    return QSize(50, 50);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderScene()
+void Renderer::initializeGL()
 {
-    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
-    glClearColor(0.8f, 0.8f, 0.8f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    initializeOpenGLFunctions();
+    checkOpenGLVersion();
 
-    renderLight();
+    ////////////////////////////////////////////////////////////////////////////////
+    // glMultiDrawElementsIndirect is only available on GL 4.3 contexts,
+    // otherwise the indirect commands are issued one by one
+    multiDrawFunctions = getGLContext()->versionFunctions<QOpenGLFunctions_4_3_Core>();
 
-    switch(currentShadowMode)
+    if(multiDrawFunctions && !multiDrawFunctions->initializeOpenGLFunctions())
     {
-    case NO_SHADOW:
-        renderObjectWithoutShadow(ALL_LIGHT);
-        break;
-
-    case PROJECTIVE_SHADOW:
-        renderObjectWithProjectiveShadow();
-        break;
+        multiDrawFunctions = NULL;
+    }
 
-    case SHADOW_MAP:
-        renderObjectWithShadowMap();
-        break;
+    // the depth bounds test is an extension, without it the shadow volume lights rely on
+    // the scissor test alone
+    if(getGLContext()->hasExtension("GL_EXT_depth_bounds_test"))
+    {
+        depthBoundsFunction = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLdouble, GLdouble)>
+                              (getGLContext()->getProcAddress("glDepthBoundsEXT"));
+    }
 
-    case SHADOW_VOLUME:
-        renderObjectWithShadowVolume();
-        break;
+    profiler.initialize(this);
 
-    default:
-        break;
+    if(!initializedScene)
+    {
+        initScene();
+        initializedScene = true;
     }
 
+    if(enabledRenderThread)
+    {
+        startRenderThread();
+    }
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderObjectWithoutShadow(int _lightingMode)
+void Renderer::resizeGL(int w, int h)
 {
-    currentShadingProgram->bind();
-    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                           cameraPosition);
-    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-    currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_FALSE);
-    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-    currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode],
-                                           _lightingMode);
-
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
-
-    glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
-
-    renderRoom();
-    renderCube();
-    renderMeshObject();
-    renderOccluder();
-    renderBillboardObject();
+    projectionMatrix.setToIdentity();
+    projectionMatrix.perspective(45, (float)w / (float)h, CAMERA_NEAR_PLANE,
+                                 CAMERA_FAR_PLANE);
 
-    currentShadingProgram->release();
+    // the widget only repaints by itself without a render thread
+    if(renderThread)
+    {
+        emit redrawRequested();
+    }
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderObjectWithProjectiveShadow()
+void Renderer::paintGL()
 {
-    renderLight();
-
-    QVector4D planeNormals[6] =
+    if(!initializedScene)
     {
-        QVector4D(0, 0, -1, roomSize),
-        QVector4D(-1, 0, 0, roomSize),
-        QVector4D(0, 0, 1, roomSize),
-        QVector4D(1, 0, 0, roomSize),
-        QVector4D(0, 1, 0, 0),
-        QVector4D(0, -1, 0, 2 * roomSize)
-    };
+        return;
+    }
 
-    for(int i = 0; i < 4; ++i)
-    {
+    profiler.beginFrame();
 
-        ////////////////////////////////////////////////////////////////////////////////
-        // render the 4 faces of the room
-        currentShadingProgram->bind();
-        currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                               cameraPosition);
-        currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-        currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-        currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
-        currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_FALSE);
-        currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-        currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode], 0);
-
-        glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                              UBOBindingIndex[BINDING_MATRICES]);
-        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                         UBOMatrices);
+    updateSimulation();
 
-        glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                              UBOBindingIndex[BINDING_LIGHT]);
-        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                         UBOLight);
+    updateCamera();
 
-        glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                              UBOBindingIndex[BINDING_ROOM_MATERIAL]);
-        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_ROOM_MATERIAL],
-                         UBORoomMaterial);
+    // the program of the shading mode is created on its first frame
+    currentShadingProgram = requireShadingProgram(currentShadingMode);
 
-        /////////////////////////////////////////////////////////////////
-        // flush the model and normal matrices
-        glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                        roomModelMatrix.constData());
-        glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                        roomNormalMatrix.constData());
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-        vaoRoom[currentShadingMode].bind();
+    // render scene
+    renderScene();
 
-        glEnable(GL_STENCIL_TEST);
-        glStencilMask(0xFF);
-        glClear(GL_STENCIL_BUFFER_BIT);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+    profiler.endFrame();
 
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_FRONT);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(6 * i * sizeof(GLushort) ));
-        glDisable(GL_CULL_FACE);
+    if(enabledProfilerOverlay && !headlessContext)
+    {
+        renderProfilerOverlay();
+    }
 
+    animating.storeRelease((hasInertia() || enabledProfilerOverlay) ? 1 : 0);
+}
 
-        vaoRoom[currentShadingMode].release();
-        currentShadingProgram->release();
+//------------------------------------------------------------------------------------------
+// With a render thread the GUI thread only composes the framebuffer the thread has drawn.
+//------------------------------------------------------------------------------------------
+void Renderer::paintEvent(QPaintEvent* _event)
+{
+    if(!renderThread)
+    {
+        QOpenGLWidget::paintEvent(_event);
+    }
+}
 
+//------------------------------------------------------------------------------------------
+// The context is created on the GUI thread, so the thread is started once the widget is
+// initialized.
+//------------------------------------------------------------------------------------------
+void Renderer::enableRenderThread()
+{
+    enabledRenderThread = true;
 
-        ////////////////////////////////////////////////////////////////////////////////
-        // render projected shadow
-        glDisable(GL_DEPTH_TEST);
-        glStencilFunc(GL_EQUAL, 1, 0xFF);
+    if(isValid())
+    {
+        startRenderThread();
+    }
+}
 
-        glEnable(GL_BLEND);
-        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        projectedShadowProgram->bind();
+//------------------------------------------------------------------------------------------
+// The GUI thread holds the renderer while it composes or resizes, as the framebuffer must
+// not be drawn into then.
+//------------------------------------------------------------------------------------------
+void Renderer::startRenderThread()
+{
+    if(renderThread || headlessContext)
+    {
+        return;
+    }
 
-        /////////////////////////////////////////////////////////////////
-        // set the uniform
-        glUniformBlockBinding(projectedShadowProgram->programId(),
-                              uniMatrices[PROJECTED_OBJECT_SHADING],
-                              UBOBindingIndex[BINDING_MATRICES]);
-        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                         UBOMatrices);
+    renderThread = new RenderThread(this);
+
+    connect(this, &QOpenGLWidget::aboutToCompose, renderThread,
+            &RenderThread::lockRenderer, Qt::DirectConnection);
+    connect(this, &QOpenGLWidget::frameSwapped, renderThread,
+            &RenderThread::unlockRenderer, Qt::DirectConnection);
+    connect(this, &QOpenGLWidget::aboutToResize, renderThread,
+            &RenderThread::lockRenderer, Qt::DirectConnection);
+    connect(this, &QOpenGLWidget::resized, renderThread,
+            &RenderThread::unlockRenderer, Qt::DirectConnection);
+    connect(renderThread, &RenderThread::contextWanted, this, &Renderer::grabContext);
+    connect(renderThread, SIGNAL(frameReady()), this, SLOT(update()));
+
+    renderThread->start(context());
+    renderThread->requestFrame();
+}
 
-        glUniformBlockBinding(projectedShadowProgram->programId(),
-                              uniLight[PROJECTED_OBJECT_SHADING],
-                              UBOBindingIndex[BINDING_LIGHT]);
-        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                         UBOLight);
+//------------------------------------------------------------------------------------------
+void Renderer::requestFrame()
+{
+    if(renderThread)
+    {
+        renderThread->requestFrame();
+    }
+    else
+    {
+        update();
+    }
+}
 
-        projectedShadowProgram->setUniformValue(uniShadowIntensity,
-                                                (GLfloat)(1.0 - ambientLight));
-        projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[i]);
+//------------------------------------------------------------------------------------------
+// the scene changed, the frame scheduler decides when the next frame is drawn
+//------------------------------------------------------------------------------------------
+void Renderer::requestRedraw()
+{
+    if(renderThread)
+    {
+        emit redrawRequested();
+    }
+    else
+    {
+        update();
+    }
+}
 
-        renderProjectedCube();
-        renderProjectedMeshObject();
-        renderProjectedOccluder();
+//------------------------------------------------------------------------------------------
+// The posted slots run with the context current, some of them release it, so it is made
+// current again for the frame. The frame is flushed before the GUI thread composes it in
+// its own context.
+//------------------------------------------------------------------------------------------
+void Renderer::renderThreadFrame()
+{
+    makeCurrent();
+    commandQueue.execute();
 
-        projectedShadowProgram->release();
-        glDisable(GL_BLEND);
+    makeCurrent();
+    paintGL();
+    glFlush();
+    doneCurrent();
+}
 
+//------------------------------------------------------------------------------------------
+void Renderer::grabContext()
+{
+    if(renderThread)
+    {
+        renderThread->handOverContext();
     }
+}
 
+//------------------------------------------------------------------------------------------
+// Without a window the widget is never shown, so the GL setup of the widget is done
+// here on the context of the caller, which must be current.
+//------------------------------------------------------------------------------------------
+void Renderer::initializeHeadless(QOpenGLContext* _context, const QSize& _frameSize)
+{
+    headlessContext = _context;
+    retinaScale = 1;
+    resize(_frameSize);
 
-    /////////////////////////////////////////////////////////////////
-    // render the floor
-    currentShadingProgram->bind();
-    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                           cameraPosition);
-    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-    currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_FALSE);
-    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-    currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode], 0);
+    initializeGL();
+    resizeGL(_frameSize.width(), _frameSize.height());
+}
 
+//------------------------------------------------------------------------------------------
+void Renderer::renderHeadlessFrame(QOpenGLFramebufferObject* _framebuffer)
+{
+    headlessFramebuffer = _framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+    paintGL();
+    glFinish();
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+//------------------------------------------------------------------------------------------
+bool Renderer::hasGLContext()
+{
+    return (headlessContext != NULL) || isValid();
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_ROOM_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_ROOM_MATERIAL],
-                     UBORoomMaterial);
+//------------------------------------------------------------------------------------------
+QOpenGLContext* Renderer::getGLContext()
+{
+    return headlessContext ? headlessContext : context();
+}
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    roomModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    roomNormalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+//------------------------------------------------------------------------------------------
+// the frames are drawn into the widget framebuffer, or the one of the headless renderer
+//------------------------------------------------------------------------------------------
+GLuint Renderer::getTargetFramebuffer()
+{
+    return headlessFramebuffer ? headlessFramebuffer->handle() : defaultFramebufferObject();
+}
 
-    vaoRoom[currentShadingMode].bind();
+//------------------------------------------------------------------------------------------
+// The scopes of the last collected frame, indented by their depth, over the top left
+// corner of the widget. QPainter changes the GL state, the state the passes rely on is
+// restored afterwards.
+//------------------------------------------------------------------------------------------
+void Renderer::renderProfilerOverlay()
+{
+    const QVector<Profiler::ScopeTiming>& timings = profiler.getScopeTimings();
+    QStringList lines;
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilMask(0xFF);
-    glClear(GL_STENCIL_BUFFER_BIT);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+    lines << QString("Draw calls: %1   Triangles: %2   State changes: %3")
+          .arg(profiler.getNumDrawCalls())
+          .arg(profiler.getNumTriangles())
+          .arg(profiler.getNumStateChanges());
+    lines << QString("%1 %2 %3").arg("Scope", -48).arg("CPU ms", 9).arg("GPU ms", 9);
 
-    glEnable(GL_DEPTH_TEST);
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_TRUE);
-    floorTextures[currentFloorTexture]->bind(0);
+    for(int i = 0; i < timings.size(); ++i)
+    {
+        const Profiler::ScopeTiming& timing = timings.at(i);
+        QString name = QString(2 * timing.depth, ' ') + timing.name;
 
-    if(enabledTextureAnisotropicFiltering)
+        lines << QString("%1 %2 %3").arg(name, -48)
+              .arg(timing.cpuTime, 9, 'f', 3)
+              .arg(timing.gpuTime, 9, 'f', 3);
+    }
+
+    QFont font("Monospace", 9);
+    font.setStyleHint(QFont::TypeWriter);
+    QFontMetrics fontMetrics(font);
+
+    int lineWidth = 0;
+
+    for(int i = 0; i < lines.size(); ++i)
     {
-        GLfloat fLargest;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+        lineWidth = qMax(lineWidth, fontMetrics.horizontalAdvance(lines.at(i)));
     }
-    else
+
+    // the widget itself can only be painted on from the GUI thread
+    QOpenGLPaintDevice paintDevice(size() * retinaScale);
+    paintDevice.setDevicePixelRatio(retinaScale);
+    QPainter painter(&paintDevice);
+    painter.setFont(font);
+    painter.fillRect(QRect(5, 5, lineWidth + 10, lines.size() * fontMetrics.height() + 10),
+                     QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+
+    for(int i = 0; i < lines.size(); ++i)
     {
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+        painter.drawText(10, 10 + fontMetrics.ascent() + i * fontMetrics.height(),
+                         lines.at(i));
     }
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 24));
-    floorTextures[currentFloorTexture]->release();
+    painter.end();
 
-    vaoRoom[currentShadingMode].release();
-    currentShadingProgram->release();
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_CULL_FACE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glActiveTexture(GL_TEXTURE0);
+}
 
+//------------------------------------------------------------------------------------------
+void Renderer::enableGPUTimers(bool _state)
+{
+    enabledGPUTimers = _state;
+    numIssuedTimerQueries = 0;
+}
 
-    ////////////////////////////////////////////////////////////////////////////////
-    // render projected shadow
-    glDisable(GL_DEPTH_TEST);
-    glStencilFunc(GL_EQUAL, 1, 0xFF);
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    projectedShadowProgram->bind();
+//------------------------------------------------------------------------------------------
+// Only one GL_TIME_ELAPSED query can be active, so the running one is ended and a new one
+// begun whenever the frame moves on to another pass. The queries are kept for the frame.
+//------------------------------------------------------------------------------------------
+void Renderer::switchTimedPass(TimedPass _pass)
+{
+    if(!enabledGPUTimers || currentTimedPass == _pass)
+    {
+        return;
+    }
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    glUniformBlockBinding(projectedShadowProgram->programId(),
-                          uniMatrices[PROJECTED_OBJECT_SHADING],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+    if(currentTimedPass != NO_TIMED_PASS)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
 
-    glUniformBlockBinding(projectedShadowProgram->programId(),
-                          uniLight[PROJECTED_OBJECT_SHADING],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+    currentTimedPass = _pass;
 
-    projectedShadowProgram->setUniformValue(uniShadowIntensity,
-                                            (GLfloat)(1.0 - ambientLight));
-    projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[4]);
+    if(_pass == NO_TIMED_PASS)
+    {
+        return;
+    }
 
-    renderProjectedCube();
-    renderProjectedMeshObject();
-    renderProjectedOccluder();
+    if(numIssuedTimerQueries == timerQueries.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        timerQueries.append(query);
+        timerQueryPasses.append(NO_TIMED_PASS);
+    }
 
-    projectedShadowProgram->release();
+    timerQueryPasses[numIssuedTimerQueries] = _pass;
+    glBeginQuery(GL_TIME_ELAPSED, timerQueries.at(numIssuedTimerQueries));
+    ++numIssuedTimerQueries;
+}
 
-    glDisable(GL_BLEND);
-    glDisable(GL_STENCIL_TEST);
-    glEnable(GL_DEPTH_TEST);
+//------------------------------------------------------------------------------------------
+// waits for the queries of the last frame, the times are in milliseconds
+//------------------------------------------------------------------------------------------
+void Renderer::getGPUPassTimes(double* _passTimes)
+{
+    for(int i = 0; i < NUM_TIMED_PASSES; ++i)
+    {
+        _passTimes[i] = 0.0;
+    }
 
+    for(int i = 0; i < numIssuedTimerQueries; ++i)
+    {
+        GLuint64 elapsedTime = 0;
+        glGetQueryObjectui64v(timerQueries.at(i), GL_QUERY_RESULT, &elapsedTime);
+        _passTimes[timerQueryPasses.at(i)] += elapsedTime * 1e-6;
+    }
+}
 
-    /////////////////////////////////////////////////////////////////
-    // render the ceiling
-    currentShadingProgram->bind();
-    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                           cameraPosition);
-    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-    currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_FALSE);
-    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-    currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode], 0);
+//-----------------------------------------------------------------------------------------
+void Renderer::mousePressEvent(QMouseEvent* _event)
+{
+    lastMousePos = QVector2D(_event->localPos());
 
+    mouseButtonPressed = (_event->button() == Qt::RightButton) ? RIGHT_BUTTON : LEFT_BUTTON;
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+//-----------------------------------------------------------------------------------------
+void Renderer::mouseMoveEvent(QMouseEvent* _event)
+{
+    QVector2D mouseMoved = QVector2D(_event->localPos()) - lastMousePos;
+    dragMouse(mouseMoved, mouseButtonPressed, specialKeyPressed);
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+    lastMousePos = QVector2D(_event->localPos());
+    requestRedraw();
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_ROOM_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_ROOM_MATERIAL],
-                     UBORoomMaterial);
+//------------------------------------------------------------------------------------------
+// the mouse state stays with the GUI thread, the inertia it adds to belongs to the frames
+//------------------------------------------------------------------------------------------
+void Renderer::dragMouse(const QVector2D& _mouseMoved, MouseButton _button,
+                         SpecialKey _key)
+{
+    POST_TO_RENDER_THREAD(dragMouse(_mouseMoved, _button, _key));
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    roomModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    roomNormalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-    vaoRoom[currentShadingMode].bind();
+    // the light can only be translated
+    if(currentMouseTransTarget == TRANSFORM_LIGHT)
+    {
+        _button = RIGHT_BUTTON;
+    }
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilMask(0xFF);
-    glClear(GL_STENCIL_BUFFER_BIT);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+    switch(_key)
+    {
+    case Renderer::NO_KEY:
+    {
 
-    glEnable(GL_DEPTH_TEST);
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_TRUE);
-    ceilingTexture->bind(0);
+        if(_button == RIGHT_BUTTON)
+        {
+            translation.setX(translation.x() + _mouseMoved.x() / 50.0f);
+            translation.setY(translation.y() - _mouseMoved.y() / 50.0f);
+        }
+        else
+        {
+            rotation.setX(rotation.x() - _mouseMoved.x() / 5.0f);
+            rotation.setY(rotation.y() - _mouseMoved.y() / 5.0f);
+        }
 
-    if(enabledTextureAnisotropicFiltering)
-    {
-        GLfloat fLargest;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
     }
-    else
+    break;
+
+    case Renderer::SHIFT_KEY:
     {
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+        if(_button == RIGHT_BUTTON)
+        {
+            QVector2D dir = _mouseMoved.normalized();
+            zooming += _mouseMoved.length() * dir.x() / 500.0f;
+        }
+        else
+        {
+            rotation.setX(rotation.x() + _mouseMoved.x() / 5.0f);
+            rotation.setZ(rotation.z() + _mouseMoved.y() / 5.0f);
+        }
     }
+    break;
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 30));
-    glDisable(GL_CULL_FACE);
-    ceilingTexture->release();
-
+    case Renderer::CTRL_KEY:
+        break;
 
+    }
+}
 
-    vaoRoom[currentShadingMode].release();
-    currentShadingProgram->release();
+//------------------------------------------------------------------------------------------
+void Renderer::addInertia(const QVector3D& _translation, float _zooming)
+{
+    POST_TO_RENDER_THREAD(addInertia(_translation, _zooming));
 
+    translation += _translation;
+    zooming += _zooming;
+}
 
-    ////////////////////////////////////////////////////////////////////////////////
-    // render projected shadow
-    glDisable(GL_DEPTH_TEST);
-    glStencilFunc(GL_EQUAL, 1, 0xFF);
+//------------------------------------------------------------------------------------------
+void Renderer::mouseReleaseEvent(QMouseEvent* _event)
+{
+    mouseButtonPressed = NO_BUTTON;
+}
 
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    projectedShadowProgram->bind();
+//------------------------------------------------------------------------------------------
+void Renderer::wheelEvent(QWheelEvent* _event)
+{
+    if(!_event->angleDelta().isNull())
+    {
+        addInertia(QVector3D(0.0f, 0.0f, 0.0f),
+                   (_event->angleDelta().x() + _event->angleDelta().y()) / 500.0f);
+    }
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    glUniformBlockBinding(projectedShadowProgram->programId(),
-                          uniMatrices[PROJECTED_OBJECT_SHADING],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+    requestRedraw();
+}
 
-    glUniformBlockBinding(projectedShadowProgram->programId(),
-                          uniLight[PROJECTED_OBJECT_SHADING],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+//------------------------------------------------------------------------------------------
+void Renderer::setShadingMode(ShadingProgram _shadingMode)
+{
+    POST_TO_RENDER_THREAD(setShadingMode(_shadingMode));
 
-    projectedShadowProgram->setUniformValue(uniShadowIntensity,
-                                            (GLfloat)(1.0 - ambientLight));
-    projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[5]);
-    projectedShadowProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
+    currentShadingMode = _shadingMode;
+    currentShadingProgram = glslPrograms[currentShadingMode];
 
-    renderProjectedCube();
-    renderProjectedMeshObject();
-    renderProjectedOccluder();
+    // the program is created with the next frame, when there is none yet
 
-    glDisable(GL_BLEND);
-    glDisable(GL_STENCIL_TEST);
-    glEnable(GL_DEPTH_TEST);
+    requestRedraw();
+}
 
-    ////////////////////////////////////////////////////////////////////////////////
-    // render the shadow casting
-    currentShadingProgram->bind();
-    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                           cameraPosition);
-    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-    currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_FALSE);
-    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-    currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode], 0);
+//------------------------------------------------------------------------------------------
+void Renderer::resetCameraPosition()
+{
+    setCamera(DEFAULT_CAMERA_POSITION, DEFAULT_CAMERA_FOCUS);
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+//------------------------------------------------------------------------------------------
+void Renderer::setOccluderPosition(const QVector3D& _position)
+{
+    POST_TO_RENDER_THREAD(setOccluderPosition(_position));
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+    occluderModelMatrix.setToIdentity();
+    occluderModelMatrix.translate(_position);
+    occluderModelMatrix.scale(0.5f);
+    occluderNormalMatrix = QMatrix4x4(occluderModelMatrix.normalMatrix());
 
-    renderCube();
-    renderMeshObject();
-    renderOccluder();
-    renderBillboardObject();
-    currentShadingProgram->release();
+    calculateOccluderFaceVertices();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::generateShadowMap()
+void Renderer::setCamera(const QVector3D& _position, const QVector3D& _focus)
 {
-    /////////////////////////////////////////////////////////////////
-    // render scene to shadow map
-    FBODepthMap->bind();
-    glViewport(0, 0, DEPTH_TEXTURE_SIZE, DEPTH_TEXTURE_SIZE);
-    glDrawBuffer(GL_NONE);
+    POST_TO_RENDER_THREAD(setCamera(_position, _focus));
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    cameraPosition = _position;
+    cameraFocus = _focus;
+    cameraUpDirection = QVector3D(0.0f, 1.0f, 0.0f);
 
-    glClearDepth(1.0);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glEnable(GL_POLYGON_OFFSET_FILL);
-    glPolygonOffset(4.0f, 4.0f);
+    previousCameraPosition = steppedCameraPosition = cameraPosition;
+    previousCameraFocus = steppedCameraFocus = cameraFocus;
+    previousCameraUpDirection = steppedCameraUpDirection = cameraUpDirection;
 
-    shadowMapProgram->bind();
-    glUniformBlockBinding(shadowMapProgram->programId(), uniMatrices[SHADOW_MAP_SHADING],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+    requestRedraw();
+}
 
-    renderCube2DepthMap();
-    renderMeshObject2DepthMap();
-    renderOccluder2DepthMap();
-    renderBillboardObject2DepthMap();
+//------------------------------------------------------------------------------------------
+void Renderer::enableDepthTest(bool _status)
+{
+    POST_TO_RENDER_THREAD(enableDepthTest(_status));
 
-    glDisable(GL_POLYGON_OFFSET_FILL);
-    shadowMapProgram->release();
+    if(!hasGLContext())
+    {
+        return;
+    }
 
-    FBODepthMap->release();
+    makeCurrent();
+
+    if(_status)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    else
+    {
+        glDisable(GL_DEPTH_TEST);
+    }
+
+    doneCurrent();
+    requestRedraw();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderObjectWithShadowMap()
+void Renderer::enableZAxisRotation(bool _status)
 {
-    if(!initializedDepthBuffer)
+    POST_TO_RENDER_THREAD(enableZAxisRotation(_status));
+
+    enabledZAxisRotation = _status;
+
+    if(!enabledZAxisRotation)
     {
-        initDepthBufferObject();
+        cameraUpDirection = QVector3D(0.0f, 1.0f, 0.0f);
+        steppedCameraUpDirection = cameraUpDirection;
     }
+}
 
-    generateShadowMap();
+//------------------------------------------------------------------------------------------
+void Renderer::enableTextureAnisotropicFiltering(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableTextureAnisotropicFiltering(_state));
 
-    /////////////////////////////////////////////////////////////////
-    // render scene with shadow map
-    makeCurrent();
-    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+    enabledTextureAnisotropicFiltering = _state;
+}
 
-    renderLight();
+//------------------------------------------------------------------------------------------
+void Renderer::enableShowShadowVolume(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableShowShadowVolume(_state));
 
-    currentShadingProgram->bind();
-    currentShadingProgram->setUniformValue(uniCameraPosition[currentShadingMode],
-                                           cameraPosition);
-    currentShadingProgram->setUniformValue(uniObjTexture[currentShadingMode], 0);
-    currentShadingProgram->setUniformValue(uniDepthTexture[currentShadingMode], 1);
-    currentShadingProgram->setUniformValue(uniHasDepthTexture[currentShadingMode], GL_TRUE);
-    currentShadingProgram->setUniformValue(uniAmbientLight[currentShadingMode], ambientLight);
-    currentShadingProgram->setUniformValue(uniLightingMode[currentShadingMode],
-                                           (int) ALL_LIGHT);
+    enabledShowShadowVolume = _state;
+}
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMatrices[currentShadingMode],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+//------------------------------------------------------------------------------------------
+void Renderer::enablePointLightShadowVolumes(bool _state)
+{
+    POST_TO_RENDER_THREAD(enablePointLightShadowVolumes(_state));
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniLight[currentShadingMode],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
+    enabledPointLightShadowVolumes = _state;
+}
 
-    depthTexture->bind(1);
+//------------------------------------------------------------------------------------------
+void Renderer::enableBatchedProjectiveShadow(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableBatchedProjectiveShadow(_state));
 
-    renderRoom();
-    renderCube();
-    renderMeshObject();
-    renderOccluder();
-    renderBillboardObject();
+    enabledBatchedProjectiveShadow = _state;
+}
 
-    depthTexture->release();
-    currentShadingProgram->release();
+//------------------------------------------------------------------------------------------
+void Renderer::enableMultiDrawIndirect(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableMultiDrawIndirect(_state));
+
+    enabledMultiDrawIndirect = _state;
 }
 
+//------------------------------------------------------------------------------------------
+void Renderer::enableFrustumCulling(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableFrustumCulling(_state));
+
+    enabledFrustumCulling = _state;
+}
 
 //------------------------------------------------------------------------------------------
-void Renderer::generateShadowVolume()
+void Renderer::enableOcclusionCulling(bool _state)
 {
-    UnitCube::CubeFaceTriangle* face1;
-    UnitCube::CubeFaceTriangle* face2;
-    QVector3D lightDir1, lightDir2;
-    QVector3D sharedVertices[2];
-    float dot1, dot2;
-    shadowVolume.clear();
+    POST_TO_RENDER_THREAD(enableOcclusionCulling(_state));
 
-    for(int i = 0; i < cubeObject->getNumFaceTriangles(); ++i)
-    {
-        face1 = occluderFaces[i];
-        lightDir1 = QVector3D(light.position) - face1->vertices[0];
-        dot1 = QVector3D::dotProduct(face1->faceNormal, lightDir1);
+    enabledOcclusionCulling = _state;
+}
 
-        for(int j = 0; j < cubeObject->getNumFaceTriangles(); ++j)
-        {
-            if(i == j)
-            {
-                continue;
-            }
+//------------------------------------------------------------------------------------------
+void Renderer::enableDepthPrePass(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableDepthPrePass(_state));
 
-            face2 = occluderFaces[j];
-            lightDir2 = QVector3D(light.position) - face2->vertices[0];
-            dot2 = QVector3D::dotProduct(face2->faceNormal, lightDir2);
+    enabledDepthPrePass = _state;
+}
 
-            if(dot1 * dot2 < 0) // silhouette
-            {
+//------------------------------------------------------------------------------------------
+void Renderer::enableShadingVariants(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableShadingVariants(_state));
+
+    enabledShadingVariants = _state;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::enableRenderQueue(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableRenderQueue(_state));
+
+    enabledRenderQueue = _state;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::startTrace()
+{
+    POST_TO_RENDER_THREAD(startTrace());
+
+    profiler.startTrace();
+}
+
+//------------------------------------------------------------------------------------------
+// the profiler reads back the frames in flight, which needs the context
+//------------------------------------------------------------------------------------------
+bool Renderer::writeTrace(const QString& _fileName)
+{
+    if(!hasGLContext())
+    {
+        return profiler.writeTrace(_fileName);
+    }
+
+    makeCurrent();
+    bool written = profiler.writeTrace(_fileName);
+    doneCurrent();
+
+    return written;
+}
+
+//------------------------------------------------------------------------------------------
+// the inertia was still decaying after the last frame, see hasInertia(), or the profiler
+// overlay needs fresh timings every frame
+//------------------------------------------------------------------------------------------
+bool Renderer::isAnimating()
+{
+    return animating.loadAcquire() != 0;
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::hasInertia()
+{
+    return (translation.lengthSquared() >= 1e-4) ||
+           (rotation.lengthSquared() >= 1e-4) ||
+           (fabs(zooming) >= 1e-4);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::enableProfilerOverlay(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableProfilerOverlay(_state));
+
+    enabledProfilerOverlay = _state;
+    profiler.setEnabled(_state);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::enableDeferredShading(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableDeferredShading(_state));
+
+    enabledDeferredShading = _state;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::enableClusteredShading(bool _state)
+{
+    POST_TO_RENDER_THREAD(enableClusteredShading(_state));
+
+    enabledClusteredShading = _state;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::setNumShadowLights(int _numShadowLights)
+{
+    POST_TO_RENDER_THREAD(setNumShadowLights(_numShadowLights));
+
+    numShadowLights = qBound(1, _numShadowLights, MAX_NUM_SHADOW_LIGHTS);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::setMouseTransformationTarget(MouseTransformationTarget _mouseTarget)
+{
+    POST_TO_RENDER_THREAD(setMouseTransformationTarget(_mouseTarget));
+
+    currentMouseTransTarget = _mouseTarget;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::setShadowMethod(ShadowModes _shadowMode)
+{
+    POST_TO_RENDER_THREAD(setShadowMethod(_shadowMode));
+
+    currentShadowMode = _shadowMode;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::keyPressEvent(QKeyEvent* _event)
+{
+    switch(_event->key())
+    {
+    case Qt::Key_Shift:
+        specialKeyPressed = Renderer::SHIFT_KEY;
+        break;
+
+    case Qt::Key_Plus:
+        addInertia(QVector3D(0.0f, 0.0f, 0.0f), -0.1f);
+        break;
+
+    case Qt::Key_Minus:
+        addInertia(QVector3D(0.0f, 0.0f, 0.0f), 0.1f);
+        break;
+
+    case Qt::Key_Up:
+        addInertia(QVector3D(0.0f, 0.3f, 0.0f), 0.0f);
+        break;
+
+    case Qt::Key_Down:
+        addInertia(QVector3D(0.0f, -0.3f, 0.0f), 0.0f);
+        break;
+
+    case Qt::Key_Left:
+        addInertia(QVector3D(-0.3f, 0.0f, 0.0f), 0.0f);
+        break;
+
+    case Qt::Key_Right:
+        addInertia(QVector3D(0.3f, 0.0f, 0.0f), 0.0f);
+        break;
+
+    // start a trace, or write the running one
+    case Qt::Key_T:
+        toggleTrace();
+        break;
+
+    default:
+        QOpenGLWidget::keyPressEvent(_event);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::toggleTrace()
+{
+    POST_TO_RENDER_THREAD(toggleTrace());
+
+    if(profiler.isTracing())
+    {
+        QString fileName = QString("trace-%1.json")
+                           .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+        qDebug() << (writeTrace(fileName) ? "Trace written to" : "Cannot write trace")
+                 << fileName;
+    }
+    else
+    {
+        startTrace();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::keyReleaseEvent(QKeyEvent* _event)
+{
+    specialKeyPressed = Renderer::NO_KEY;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::translateCamera()
+{
+    translation *= MOVING_INERTIA;
+
+    if(translation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D eyeVector = cameraFocus - cameraPosition;
+    float scale = sqrt(eyeVector.length()) * 0.01f;
+
+    QVector3D u(0.0f, 1.0f, 0.0f);
+    QVector3D v = QVector3D::crossProduct(eyeVector, u);
+    u = QVector3D::crossProduct(v, eyeVector);
+    u.normalize();
+    v.normalize();
+
+    cameraPosition -= scale * (translation.x() * v + translation.y() * u);
+    cameraFocus -= scale * (translation.x() * v + translation.y() * u);
+
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::rotateCamera()
+{
+    rotation *= MOVING_INERTIA;
+
+    if(rotation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D nEyeVector = cameraPosition - cameraFocus ;
+
+    float scale = sqrt(nEyeVector.length()) * 0.02f;
+    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(1, 0, 0),
+                                                          rotation.y() * scale) *
+                            QQuaternion::fromAxisAndAngle(QVector3D(0, 1, 0), rotation.x() * scale) *
+                            QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z() * scale);
+    nEyeVector = qRotation.rotatedVector(nEyeVector);
+
+    cameraPosition = cameraFocus + nEyeVector;
+
+    if(enabledZAxisRotation)
+    {
+        cameraUpDirection = qRotation.rotatedVector(cameraUpDirection);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::zoomCamera()
+{
+    zooming *= MOVING_INERTIA;
+
+    if(fabs(zooming) < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D nEyeVector = cameraPosition - cameraFocus ;
+    float len = nEyeVector.length();
+    nEyeVector.normalize();
+
+    len += sqrt(len) * zooming * 0.3f;
+
+    if(len < 0.5f)
+    {
+        len = 0.5f;
+    }
+
+    cameraPosition = len * nEyeVector + cameraFocus;
+
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::translateObjects()
+{
+    translation *= MOVING_INERTIA;
+
+    if(translation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D eyeVector = cameraFocus - cameraPosition;
+    float scale = sqrt(eyeVector.length()) * 0.05f;
+
+    QVector3D u(0.0f, 1.0f, 0.0f);
+    QVector3D v = QVector3D::crossProduct(eyeVector, u);
+    u = QVector3D::crossProduct(v, eyeVector);
+    u.normalize();
+    v.normalize();
+
+    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
+    QMatrix4x4 translationMatrix;
+    translationMatrix.setToIdentity();
+    translationMatrix.translate(objectTrans);
+
+    cubeModelMatrix = translationMatrix * cubeModelMatrix;
+    meshObjectModelMatrix = translationMatrix * meshObjectModelMatrix;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::rotateObjects()
+{
+    rotation *= MOVING_INERTIA;
+
+    if(rotation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D currentPos(0.0f, 0.0f, 0.0f);
+    currentPos = cubeModelMatrix * currentPos;
+
+    float scale = -0.2f;
+    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(0.0f, 1.0f, 0.0f),
+                                                          rotation.x() * scale) *
+                            QQuaternion::fromAxisAndAngle(QVector3D(1.0f, 0.0f, 0.0f), rotation.y() * scale);
+    //*
+    //                      QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z()*scale);
+
+    QMatrix4x4 rotationMatrix;
+    rotationMatrix.setToIdentity();
+    rotationMatrix.rotate(qRotation);
+
+    QMatrix4x4 invTranslationMatrix, translationMatrix;
+    invTranslationMatrix.setToIdentity();
+    invTranslationMatrix.translate(-1.0f * currentPos);
+    translationMatrix.setToIdentity();
+    translationMatrix.translate(currentPos);
+
+    cubeModelMatrix = translationMatrix * rotationMatrix * invTranslationMatrix *
+                      cubeModelMatrix;
+    meshObjectModelMatrix = translationMatrix * rotationMatrix *
+                            invTranslationMatrix *
+                            meshObjectModelMatrix;
+
+    cubeNormalMatrix = QMatrix4x4(cubeModelMatrix.normalMatrix());
+    meshObjectNormalMatrix = QMatrix4x4(meshObjectModelMatrix.normalMatrix());
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::translateLight()
+{
+    translation *= MOVING_INERTIA;
+
+    if(translation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D eyeVector = cameraFocus - cameraPosition;
+    float scale = sqrt(eyeVector.length()) * 0.05f;
+
+    QVector3D u(0.0f, 1.0f, 0.0f);
+    QVector3D v = QVector3D::crossProduct(eyeVector, u);
+    u = QVector3D::crossProduct(v, eyeVector);
+    u.normalize();
+    v.normalize();
+
+    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
+    QMatrix4x4 translationMatrix;
+    translationMatrix.setToIdentity();
+    translationMatrix.translate(objectTrans);
+
+    light.position = translationMatrix * light.position;
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                 &light, GL_STREAM_DRAW);
+
+    lightViewMatrix.setToIdentity();
+    lightViewMatrix.lookAt(QVector3D(light.position), QVector3D(0, 0, 0), QVector3D(0, 0,
+                                                                                    -1));
+    shadowMatrix = lightProjectionMatrix * lightViewMatrix;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    shadowMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::calculateOccluderFaceVertices()
+{
+    for(int i = 0; i < cubeObject->getNumFaceTriangles(); ++i)
+    {
+        UnitCube::CubeFaceTriangle* face = occluderFaces[i];
+        face->faceNormal = occluderNormalMatrix * cubeObject->getFace(i).faceNormal;
+
+        for(int j = 0; j < 3; ++j)
+        {
+            QVector4D transformedVertex = occluderModelMatrix *
+                                          QVector4D((cubeObject->getFace(i)).vertices[j], 1.0);
+            face->vertices[j] = QVector3D(transformedVertex);
+            face->indices[j] = cubeObject->getFace(i).indices[j];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::translateOccluder()
+{
+    translation *= MOVING_INERTIA;
+
+    if(translation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D eyeVector = cameraFocus - cameraPosition;
+    float scale = sqrt(eyeVector.length()) * 0.05f;
+
+    QVector3D u(0.0f, 1.0f, 0.0f);
+    QVector3D v = QVector3D::crossProduct(eyeVector, u);
+    u = QVector3D::crossProduct(v, eyeVector);
+    u.normalize();
+    v.normalize();
+
+    QVector3D objectTrans = scale * (translation.x() * v + translation.y() * u);
+    QMatrix4x4 translationMatrix;
+    translationMatrix.setToIdentity();
+    translationMatrix.translate(objectTrans);
+
+    occluderModelMatrix = translationMatrix * occluderModelMatrix;
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::rotateOccluder()
+{
+    rotation *= MOVING_INERTIA;
+
+    if(rotation.lengthSquared() < 1e-4)
+    {
+        return;
+    }
+
+    QVector3D currentPos(0.0f, 0.0f, 0.0f);
+    currentPos = occluderModelMatrix * currentPos;
+
+    float scale = -0.2f;
+    QQuaternion qRotation = QQuaternion::fromAxisAndAngle(QVector3D(0.0f, 1.0f, 0.0f),
+                                                          rotation.x() * scale) *
+                            QQuaternion::fromAxisAndAngle(QVector3D(1.0f, 0.0f, 0.0f), rotation.y() * scale);
+    //*
+    //                      QQuaternion::fromAxisAndAngle(QVector3D(0, 0, 1), rotation.z()*scale);
+
+    QMatrix4x4 rotationMatrix;
+    rotationMatrix.setToIdentity();
+    rotationMatrix.rotate(qRotation);
+
+    QMatrix4x4 invTranslationMatrix, translationMatrix;
+    invTranslationMatrix.setToIdentity();
+    invTranslationMatrix.translate(-1.0f * currentPos);
+    translationMatrix.setToIdentity();
+    translationMatrix.translate(currentPos);
+
+    occluderModelMatrix = translationMatrix * rotationMatrix * invTranslationMatrix *
+                          occluderModelMatrix;
+    occluderNormalMatrix = QMatrix4x4(occluderModelMatrix.normalMatrix());
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderTestScene()
+{
+    if(!initializedTestScene)
+    {
+        initTestScene();
+        return;
+    }
+
+    glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glUseProgram(testProgram->programId());
+    glBindVertexArray (vao);
+    // draw points 0-3 from the currently bound VAO with current in-use shader
+    glDrawArrays (GL_TRIANGLES, 0, 3);
+    glUseProgram(0);
+}
+
+//------------------------------------------------------------------------------------------
+// test the objects and their instances against the camera and the light frustum, the
+// room is never culled since the camera is always inside
+//------------------------------------------------------------------------------------------
+void Renderer::cullScene()
+{
+    Profiler::Scope profilerScope(&profiler, "cullScene");
+
+    currentCullingPass = -1;
+
+    int numObjects = NUM_SCENE_OBJECTS - 1;
+
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        numObjects += instanceModelMatrices[i].size();
+    }
+
+    if(!enabledFrustumCulling)
+    {
+        for(int i = 0; i < NUM_CULLING_PASSES; ++i)
+        {
+            numDrawnObjects[i] = numObjects;
+            numCulledObjects[i] = 0;
+        }
+
+        for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+        {
+            unculledInstances[i].clear();
+        }
+
+        // the instance buffers are refilled in the new order
+        if(enabledRenderQueue)
+        {
+            sortVisibleInstances(UNCULLED_PASS);
+
+            for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+            {
+                instanceUploadPass[i] = -1;
+            }
+        }
+
+        emit cullingStatisticsChanged(numDrawnObjects[CAMERA_PASS], 0,
+                                      numDrawnObjects[LIGHT_PASS], 0);
+        return;
+    }
+
+    QVector3D cubeMin = cubeObject->getBoundMin();
+    QVector3D cubeMax = cubeObject->getBoundMax();
+    QVector3D planeMin = planeObject->getBoundMin();
+    QVector3D planeMax = planeObject->getBoundMax();
+    QVector3D instanceMin[NUM_INSTANCED_OBJECTS] =
+    {
+        cubeMin,
+        objLoader->getBoundMin(),
+        planeMin
+    };
+    QVector3D instanceMax[NUM_INSTANCED_OBJECTS] =
+    {
+        cubeMax,
+        objLoader->getBoundMax(),
+        planeMax
+    };
+    QMatrix4x4 passMatrices[NUM_CULLING_PASSES] =
+    {
+        viewProjectionMatrix,
+        shadowMatrix
+    };
+
+    for(int pass = 0; pass < NUM_CULLING_PASSES; ++pass)
+    {
+        frustumCuller.setFrustum(passMatrices[pass]);
+        frustumCuller.clearBoxes();
+
+        int cubeBox = frustumCuller.addBox(cubeMin, cubeMax, cubeModelMatrix);
+        int meshObjectBox = frustumCuller.addBox(instanceMin[INSTANCED_MESH_OBJECT],
+                                                 instanceMax[INSTANCED_MESH_OBJECT],
+                                                 meshObjectModelMatrix);
+        int occluderBox = frustumCuller.addBox(cubeMin, cubeMax, occluderModelMatrix);
+        int billboardBox = frustumCuller.addBox(planeMin, planeMax, getBillboardModelMatrix());
+        int firstInstanceBox[NUM_INSTANCED_OBJECTS];
+
+        for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+        {
+            firstInstanceBox[i] = frustumCuller.getNumBoxes();
+
+            for(int j = 0; j < instanceModelMatrices[i].size(); ++j)
+            {
+                frustumCuller.addBox(instanceMin[i], instanceMax[i],
+                                     instanceModelMatrices[i].at(j));
+            }
+        }
+
+        frustumCuller.cullBoxes();
+
+        /////////////////////////////////////////////////////////////////
+        // a caster inside the light frustum only matters if its shadow, which
+        // reaches at most the far end of the room, falls into the camera frustum
+        if(pass == LIGHT_PASS)
+        {
+            frustumCuller.setFrustum(viewProjectionMatrix);
+            frustumCuller.cullSweptBoxes(QVector3D(light.position), getShadowSweepLength());
+        }
+
+        sceneObjectVisible[pass][SCENE_OBJECT_ROOM] = true;
+        sceneObjectVisible[pass][SCENE_OBJECT_CUBE] = frustumCuller.isVisible(cubeBox);
+        sceneObjectVisible[pass][SCENE_OBJECT_MESH] = frustumCuller.isVisible(meshObjectBox);
+        sceneObjectVisible[pass][SCENE_OBJECT_OCCLUDER] = frustumCuller.isVisible(occluderBox);
+        sceneObjectVisible[pass][SCENE_OBJECT_BILLBOARD] = frustumCuller.isVisible(billboardBox);
+
+        for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+        {
+            visibleInstances[pass][i].clear();
+
+            for(int j = 0; j < instanceModelMatrices[i].size(); ++j)
+            {
+                if(frustumCuller.isVisible(firstInstanceBox[i] + j))
+                {
+                    visibleInstances[pass][i].append(j);
+                }
+            }
+        }
+
+        numDrawnObjects[pass] = frustumCuller.getNumVisibleBoxes();
+        numCulledObjects[pass] = frustumCuller.getNumBoxes() - numDrawnObjects[pass];
+    }
+
+    cullOccludedObjects();
+    numDrawnObjects[CAMERA_PASS] -= numOccludedObjects;
+    numCulledObjects[CAMERA_PASS] += numOccludedObjects;
+
+    if(enabledRenderQueue)
+    {
+        sortVisibleInstances(CAMERA_PASS);
+    }
+
+    // the instance buffers have to be refilled with the new visible sets
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        instanceUploadPass[i] = -1;
+    }
+
+    emit cullingStatisticsChanged(numDrawnObjects[CAMERA_PASS], numCulledObjects[CAMERA_PASS],
+                                  numDrawnObjects[LIGHT_PASS], numCulledObjects[LIGHT_PASS]);
+}
+
+//------------------------------------------------------------------------------------------
+// the distance from the light to the farthest corner of the room, no shadow goes further
+//------------------------------------------------------------------------------------------
+float Renderer::getShadowSweepLength()
+{
+    QVector3D lightPosition = QVector3D(light.position);
+    float sweepLength = 0.0f;
+
+    for(int i = 0; i < 8; ++i)
+    {
+        QVector3D corner((i & 1) ? roomSize : -roomSize,
+                         (i & 2) ? 2.0f * roomSize : 0.0f,
+                         (i & 4) ? roomSize : -roomSize);
+        sweepLength = fmax(sweepLength, (corner - lightPosition).length());
+    }
+
+    return sweepLength;
+}
+
+//------------------------------------------------------------------------------------------
+// remove the objects whose bounding box was hidden in the previous frame from the camera
+// pass; all objects in the camera frustum are queried again at the end of this frame, so
+// that they reappear as soon as they become visible
+//------------------------------------------------------------------------------------------
+void Renderer::cullOccludedObjects()
+{
+    occlusionQueryCandidates.clear();
+    numOccludedObjects = 0;
+
+    if(enabledOcclusionCulling)
+    {
+        for(int i = SCENE_OBJECT_CUBE; i < NUM_SCENE_OBJECTS; ++i)
+        {
+            if(!sceneObjectVisible[CAMERA_PASS][i])
+            {
+                continue;
+            }
+
+            occlusionQueryCandidates.append(i);
+
+            if(isOccluded(i))
+            {
+                sceneObjectVisible[CAMERA_PASS][i] = false;
+                ++numOccludedObjects;
+            }
+        }
+
+        for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+        {
+            QVector<int>& instances = visibleInstances[CAMERA_PASS][i];
+            int numVisible = 0;
+
+            for(int j = 0; j < instances.size(); ++j)
+            {
+                int queryIndex = NUM_SCENE_OBJECTS + i * MAX_NUM_INSTANCES + instances.at(j);
+                occlusionQueryCandidates.append(queryIndex);
+
+                if(isOccluded(queryIndex))
+                {
+                    ++numOccludedObjects;
+                }
+                else
+                {
+                    instances[numVisible++] = instances.at(j);
+                }
+            }
+
+            instances.resize(numVisible);
+        }
+    }
+
+    // the results of the previous frame have been consumed
+    for(int i = 0; i < issuedOcclusionQueries.size(); ++i)
+    {
+        occlusionQueryIssued[issuedOcclusionQueries.at(i)] = 0;
+    }
+
+    issuedOcclusionQueries.clear();
+}
+
+//------------------------------------------------------------------------------------------
+// distance from the camera plane to the origin of an object
+//------------------------------------------------------------------------------------------
+float Renderer::getViewDepth(const QMatrix4x4& _modelMatrix)
+{
+    QVector3D position = viewMatrix * _modelMatrix.column(3).toVector3D();
+
+    return fmax(-position.z(), 0.0f);
+}
+
+//------------------------------------------------------------------------------------------
+// instances of the camera pass, or all of them without culling, are ordered front to back
+// inside their instance buffer, the nearest one also gives the depth of the whole group in
+// the render queue
+//------------------------------------------------------------------------------------------
+void Renderer::sortVisibleInstances(CullingPass _pass)
+{
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        QVector<int>& instances = (_pass == UNCULLED_PASS) ? unculledInstances[i] :
+                                  visibleInstances[_pass][i];
+
+        if(_pass == UNCULLED_PASS)
+        {
+            instances.resize(instanceModelMatrices[i].size());
+
+            for(int j = 0; j < instances.size(); ++j)
+            {
+                instances[j] = j;
+            }
+        }
+
+        if(instances.isEmpty())
+        {
+            continue;
+        }
+
+        renderQueue.clear();
+
+        for(int j = 0; j < instances.size(); ++j)
+        {
+            float depth = getViewDepth(instanceModelMatrices[i].at(instances.at(j)));
+            renderQueue.push(RenderQueue::makeDepthKey(depth), instances.at(j));
+        }
+
+        renderQueue.sort();
+
+        for(int j = 0; j < renderQueue.size(); ++j)
+        {
+            instances[j] = renderQueue.itemAt(j);
+        }
+
+        instanceGroupDepth[i] = getViewDepth(instanceModelMatrices[i].at(instances.at(0)));
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// fraction of the screen covered by the bounding box of a sphere, a sphere reaching the
+// camera covers all of it
+//------------------------------------------------------------------------------------------
+float Renderer::getScreenCoverage(const QVector3D& _center, float _radius)
+{
+    QVector2D ndcMin, ndcMax;
+
+    if(!getScreenBounds(_center, _radius, ndcMin, ndcMax))
+    {
+        return 0.0f;
+    }
+
+    return (ndcMax.x() - ndcMin.x()) * (ndcMax.y() - ndcMin.y()) / 4.0f;
+}
+
+//------------------------------------------------------------------------------------------
+// screen coverage of the receivers a shadow light can reach: the bounding box of its frustum
+// clipped to the room, as the room and the objects in it are the only receivers
+//------------------------------------------------------------------------------------------
+float Renderer::getShadowReceiverCoverage(const QMatrix4x4& _shadowMatrix)
+{
+    QMatrix4x4 inverseShadowMatrix = _shadowMatrix.inverted();
+    QVector3D frustumMin(1e10f, 1e10f, 1e10f);
+    QVector3D frustumMax(-1e10f, -1e10f, -1e10f);
+
+    for(int i = 0; i < 8; ++i)
+    {
+        QVector3D corner = inverseShadowMatrix * QVector3D((i & 1) ? 1.0f : -1.0f,
+                                                           (i & 2) ? 1.0f : -1.0f,
+                                                           (i & 4) ? 1.0f : -1.0f);
+        frustumMin = QVector3D(fmin(frustumMin.x(), corner.x()),
+                               fmin(frustumMin.y(), corner.y()),
+                               fmin(frustumMin.z(), corner.z()));
+        frustumMax = QVector3D(fmax(frustumMax.x(), corner.x()),
+                               fmax(frustumMax.y(), corner.y()),
+                               fmax(frustumMax.z(), corner.z()));
+    }
+
+    QVector3D receiverMin(fmax(frustumMin.x(), -roomSize),
+                          fmax(frustumMin.y(), 0.0f),
+                          fmax(frustumMin.z(), -roomSize));
+    QVector3D receiverMax(fmin(frustumMax.x(), roomSize),
+                          fmin(frustumMax.y(), 2.0f * roomSize),
+                          fmin(frustumMax.z(), roomSize));
+
+    if(receiverMin.x() > receiverMax.x() || receiverMin.y() > receiverMax.y() ||
+       receiverMin.z() > receiverMax.z())
+    {
+        return 0.0f;
+    }
+
+    return getScreenCoverage(0.5f * (receiverMin + receiverMax),
+                             0.5f * (receiverMax - receiverMin).length());
+}
+
+//------------------------------------------------------------------------------------------
+// normalized device bounds of a sphere, clamped to the screen; a sphere crossing the near
+// plane may cover any part of it
+//------------------------------------------------------------------------------------------
+bool Renderer::getScreenBounds(const QVector3D& _center, float _radius, QVector2D& _ndcMin,
+                               QVector2D& _ndcMax)
+{
+    QVector3D center = viewMatrix * _center;
+
+    if(-center.z() + _radius < CAMERA_NEAR_PLANE)
+    {
+        return false;
+    }
+
+    _ndcMin = QVector2D(-1.0f, -1.0f);
+    _ndcMax = QVector2D(1.0f, 1.0f);
+
+    if(-center.z() - _radius < CAMERA_NEAR_PLANE)
+    {
+        return true;
+    }
+
+    QVector2D ndcMin(1.0f, 1.0f);
+    QVector2D ndcMax(-1.0f, -1.0f);
+
+    for(int i = 0; i < 8; ++i)
+    {
+        QVector3D corner = center + QVector3D((i & 1) ? _radius : -_radius,
+                                              (i & 2) ? _radius : -_radius,
+                                              (i & 4) ? _radius : -_radius);
+        QVector3D ndc = projectionMatrix * corner;
+
+        ndcMin.setX(fmin(ndcMin.x(), ndc.x()));
+        ndcMin.setY(fmin(ndcMin.y(), ndc.y()));
+        ndcMax.setX(fmax(ndcMax.x(), ndc.x()));
+        ndcMax.setY(fmax(ndcMax.y(), ndc.y()));
+    }
+
+    if(ndcMax.x() < -1.0f || ndcMin.x() > 1.0f || ndcMax.y() < -1.0f || ndcMin.y() > 1.0f)
+    {
+        return false;
+    }
+
+    _ndcMin = QVector2D(fmax(ndcMin.x(), -1.0f), fmax(ndcMin.y(), -1.0f));
+    _ndcMax = QVector2D(fmin(ndcMax.x(), 1.0f), fmin(ndcMax.y(), 1.0f));
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+// window rectangle and window depth range touched by the attenuation sphere of a light
+//------------------------------------------------------------------------------------------
+bool Renderer::getLightScissor(const QVector4D& _positionRadius, QRect& _scissor,
+                               float& _depthMin, float& _depthMax)
+{
+    QVector3D position = _positionRadius.toVector3D();
+    float radius = _positionRadius.w();
+    QVector2D ndcMin, ndcMax;
+
+    if(!getScreenBounds(position, radius, ndcMin, ndcMax))
+    {
+        return false;
+    }
+
+    int viewportWidth = width() * retinaScale;
+    int viewportHeight = height() * retinaScale;
+    int xMin = (int)floor((0.5f * ndcMin.x() + 0.5f) * viewportWidth);
+    int yMin = (int)floor((0.5f * ndcMin.y() + 0.5f) * viewportHeight);
+    int xMax = (int)ceil((0.5f * ndcMax.x() + 0.5f) * viewportWidth);
+    int yMax = (int)ceil((0.5f * ndcMax.y() + 0.5f) * viewportHeight);
+
+    _scissor = QRect(xMin, yMin, xMax - xMin, yMax - yMin);
+
+    if(_scissor.isEmpty())
+    {
+        return false;
+    }
+
+    float depth = -(viewMatrix * position).z();
+    float depthNear = fmax(depth - radius, CAMERA_NEAR_PLANE);
+    float depthFar = fmin(depth + radius, CAMERA_FAR_PLANE);
+
+    _depthMin = 0.5f * (projectionMatrix * QVector3D(0.0f, 0.0f, -depthNear)).z() + 0.5f;
+    _depthMax = 0.5f * (projectionMatrix * QVector3D(0.0f, 0.0f, -depthFar)).z() + 0.5f;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+// each shadow light gets a tile sized by the screen coverage of the receivers it lights, the
+// atlas is repacked and the shadow lights block rewritten every frame
+//------------------------------------------------------------------------------------------
+void Renderer::updateShadowLights()
+{
+    QMatrix4x4 textureMatrix(0.5f, 0.0f, 0.0f, 0.5f,
+                             0.0f, 0.5f, 0.0f, 0.5f,
+                             0.0f, 0.0f, 0.5f, 0.5f,
+                             0.0f, 0.0f, 0.0f, 1.0f);
+    QVector<int> tileSizes(numShadowLights);
+
+    shadowLights[0].position = light.position;
+    shadowLights[0].colorIntensity = QVector4D(light.color.toVector3D(), light.intensity);
+
+    for(int i = 0; i < numShadowLights; ++i)
+    {
+        ShadowLight& shadowLight = shadowLights[i];
+        QMatrix4x4 shadowLightViewMatrix;
+        shadowLightViewMatrix.lookAt(shadowLight.position.toVector3D(), QVector3D(0, 0, 0),
+                                     (i == 0) ? QVector3D(0, 0, -1) : QVector3D(0, 1, 0));
+        shadowLight.shadowMatrix = lightProjectionMatrix * shadowLightViewMatrix;
+
+        tileSizes[i] = shadowAtlas.getTileSize(getShadowReceiverCoverage(
+                                                   shadowLight.shadowMatrix));
+    }
+
+    shadowAtlas.packTiles(tileSizes);
+
+    /////////////////////////////////////////////////////////////////
+    // std140: texture matrices, positions, colors, atlas tiles, number of lights
+    QVector<GLfloat> blockData(SIZE_OF_SHADOW_LIGHTS_BLOCK / sizeof(GLfloat), 0.0f);
+    GLfloat* matrixData = &blockData[0];
+    GLfloat* positionData = matrixData + 16 * MAX_NUM_SHADOW_LIGHTS;
+    GLfloat* colorData = positionData + 4 * MAX_NUM_SHADOW_LIGHTS;
+    GLfloat* tileData = colorData + 4 * MAX_NUM_SHADOW_LIGHTS;
+    GLint numLights = numShadowLights;
+
+    for(int i = 0; i < numShadowLights; ++i)
+    {
+        QMatrix4x4 lightTextureMatrix = textureMatrix * shadowLights.at(i).shadowMatrix;
+        QVector4D tile = shadowAtlas.getTileTransform(i);
+
+        memcpy(&matrixData[16 * i], lightTextureMatrix.constData(), SIZE_OF_MAT4);
+        memcpy(&positionData[4 * i], &shadowLights.at(i).position, SIZE_OF_VEC4);
+        memcpy(&colorData[4 * i], &shadowLights.at(i).colorIntensity, SIZE_OF_VEC4);
+        memcpy(&tileData[4 * i], &tile, SIZE_OF_VEC4);
+    }
+
+    memcpy(tileData + 4 * MAX_NUM_SHADOW_LIGHTS, &numLights, sizeof(GLint));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOShadowLights);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_SHADOW_LIGHTS_BLOCK, blockData.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//------------------------------------------------------------------------------------------
+// the slices are spaced exponentially from the near plane to the farthest light
+//------------------------------------------------------------------------------------------
+int Renderer::getClusterSlice(float _viewDepth)
+{
+    int slice = (int)(log(_viewDepth / CAMERA_NEAR_PLANE) * clusterSliceScale);
+
+    return qBound(0, slice, NUM_CLUSTER_SLICES - 1);
+}
+
+//------------------------------------------------------------------------------------------
+// every light is binned into the clusters overlapped by its view space bounding box,
+// first counting the lights per cluster, then filling the index list at the prefix sums
+//------------------------------------------------------------------------------------------
+void Renderer::buildLightClusters()
+{
+    int viewportWidth = width() * retinaScale;
+    int viewportHeight = height() * retinaScale;
+    int numLights = pointLights.size();
+
+    numClusterTilesX = (viewportWidth + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+    numClusterTilesY = (viewportHeight + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+    int numClusters = numClusterTilesX * numClusterTilesY * NUM_CLUSTER_SLICES;
+
+    /////////////////////////////////////////////////////////////////
+    // the slices end at the back of the farthest light
+    float clusterFar = 2.0f * CAMERA_NEAR_PLANE;
+
+    for(int i = 0; i < numLights; ++i)
+    {
+        const QVector4D& positionRadius = pointLights.at(i).positionRadius;
+        float depth = -(viewMatrix * positionRadius.toVector3D()).z();
+        clusterFar = fmax(clusterFar, depth + positionRadius.w());
+    }
+
+    clusterSliceScale = (float)NUM_CLUSTER_SLICES / log(clusterFar / CAMERA_NEAR_PLANE);
+
+    /////////////////////////////////////////////////////////////////
+    // cluster range of each light, as tile x, tile y and slice bounds
+    clusterLightBounds.resize(6 * numLights);
+    clusterGrid.fill(0, 2 * numClusters);
+
+    for(int i = 0; i < numLights; ++i)
+    {
+        const QVector4D& positionRadius = pointLights.at(i).positionRadius;
+        QVector3D center = viewMatrix * positionRadius.toVector3D();
+        float radius = positionRadius.w();
+        float depth = -center.z();
+        int* bounds = &clusterLightBounds[6 * i];
+
+        bounds[0] = -1;
+
+        if(depth + radius < CAMERA_NEAR_PLANE)
+        {
+            continue;
+        }
+
+        QVector2D ndcMin(-1.0f, -1.0f);
+        QVector2D ndcMax(1.0f, 1.0f);
+
+        // a light crossing the near plane may cover any part of the screen
+        if(depth - radius > CAMERA_NEAR_PLANE)
+        {
+            ndcMin = QVector2D(1e10f, 1e10f);
+            ndcMax = QVector2D(-1e10f, -1e10f);
+
+            for(int j = 0; j < 8; ++j)
+            {
+                QVector3D corner = center + QVector3D((j & 1) ? radius : -radius,
+                                                      (j & 2) ? radius : -radius,
+                                                      (j & 4) ? radius : -radius);
+                QVector3D ndc = projectionMatrix * corner;
+
+                ndcMin.setX(fmin(ndcMin.x(), ndc.x()));
+                ndcMin.setY(fmin(ndcMin.y(), ndc.y()));
+                ndcMax.setX(fmax(ndcMax.x(), ndc.x()));
+                ndcMax.setY(fmax(ndcMax.y(), ndc.y()));
+            }
+        }
+
+        if(ndcMax.x() < -1.0f || ndcMin.x() > 1.0f || ndcMax.y() < -1.0f || ndcMin.y() > 1.0f)
+        {
+            continue;
+        }
+
+        bounds[0] = qBound(0, (int)((0.5f * ndcMin.x() + 0.5f) * viewportWidth) /
+                           CLUSTER_TILE_SIZE, numClusterTilesX - 1);
+        bounds[1] = qBound(0, (int)((0.5f * ndcMax.x() + 0.5f) * viewportWidth) /
+                           CLUSTER_TILE_SIZE, numClusterTilesX - 1);
+        bounds[2] = qBound(0, (int)((0.5f * ndcMin.y() + 0.5f) * viewportHeight) /
+                           CLUSTER_TILE_SIZE, numClusterTilesY - 1);
+        bounds[3] = qBound(0, (int)((0.5f * ndcMax.y() + 0.5f) * viewportHeight) /
+                           CLUSTER_TILE_SIZE, numClusterTilesY - 1);
+        bounds[4] = getClusterSlice(fmax(depth - radius, CAMERA_NEAR_PLANE));
+        bounds[5] = getClusterSlice(depth + radius);
+
+        for(int z = bounds[4]; z <= bounds[5]; ++z)
+        {
+            for(int y = bounds[2]; y <= bounds[3]; ++y)
+            {
+                for(int x = bounds[0]; x <= bounds[1]; ++x)
+                {
+                    int cluster = (z * numClusterTilesY + y) * numClusterTilesX + x;
+                    ++clusterGrid[2 * cluster + 1];
+                }
+            }
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // offsets of the clusters in the index list, the counts are rebuilt while filling
+    GLuint numIndices = 0;
+
+    for(int i = 0; i < numClusters; ++i)
+    {
+        clusterGrid[2 * i] = numIndices;
+        numIndices += clusterGrid[2 * i + 1];
+        clusterGrid[2 * i + 1] = 0;
+    }
+
+    // the buffer texture must not be empty
+    clusterLightIndices.resize(qMax(numIndices, 1u));
+
+    for(int i = 0; i < numLights; ++i)
+    {
+        const int* bounds = &clusterLightBounds[6 * i];
+
+        if(bounds[0] < 0)
+        {
+            continue;
+        }
+
+        for(int z = bounds[4]; z <= bounds[5]; ++z)
+        {
+            for(int y = bounds[2]; y <= bounds[3]; ++y)
+            {
+                for(int x = bounds[0]; x <= bounds[1]; ++x)
+                {
+                    int cluster = (z * numClusterTilesY + y) * numClusterTilesX + x;
+                    clusterLightIndices[clusterGrid[2 * cluster] + clusterGrid[2 * cluster + 1]] = i;
+                    ++clusterGrid[2 * cluster + 1];
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::updateLightClusters()
+{
+    Profiler::Scope profilerScope(&profiler, "updateLightClusters");
+
+    bool clusteredLighting = enabledClusteredShading && !pointLights.isEmpty();
+
+    if(clusteredLighting)
+    {
+        buildLightClusters();
+
+        vboClusterGrid.bind();
+        vboClusterGrid.allocate(clusterGrid.constData(), clusterGrid.size() * sizeof(GLuint));
+        vboClusterGrid.release();
+
+        vboClusterLightIndices.bind();
+        vboClusterLightIndices.allocate(clusterLightIndices.constData(),
+                                        clusterLightIndices.size() * sizeof(GLuint));
+        vboClusterLightIndices.release();
+
+        for(int i = 0; i < NUM_CLUSTER_TEXTURES; ++i)
+        {
+            glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + i);
+            glBindTexture(GL_TEXTURE_BUFFER, clusterTextures[i]);
+        }
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// set on the bound phong program, as every variant has its own uniforms
+//------------------------------------------------------------------------------------------
+void Renderer::applyClusteredLightingUniforms()
+{
+    bool clusteredLighting = enabledClusteredShading && !pointLights.isEmpty();
+
+    currentShadingProgram->setUniformValue(uniClusteredLighting, clusteredLighting);
+
+    if(clusteredLighting)
+    {
+        glUniform3i(uniClusterGrid, numClusterTilesX, numClusterTilesY, NUM_CLUSTER_SLICES);
+        currentShadingProgram->setUniformValue(uniClusterParameters,
+                                               QVector4D(CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE,
+                                                         clusterSliceScale, CLUSTER_TILE_SIZE));
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// objects without a query result yet are considered visible
+//------------------------------------------------------------------------------------------
+bool Renderer::isOccluded(int _queryIndex)
+{
+    if(occlusionQueries.isEmpty() || !occlusionQueryIssued[_queryIndex])
+    {
+        return false;
+    }
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(occlusionQueries[_queryIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if(available == GL_FALSE)
+    {
+        return false;
+    }
+
+    GLuint anySamplesPassed = GL_TRUE;
+    glGetQueryObjectuiv(occlusionQueries[_queryIndex], GL_QUERY_RESULT, &anySamplesPassed);
+
+    return (anySamplesPassed == GL_FALSE);
+}
+
+//------------------------------------------------------------------------------------------
+QMatrix4x4 Renderer::getOcclusionQueryBox(int _queryIndex, QVector3D* _boxMin,
+                                          QVector3D* _boxMax)
+{
+    if(_queryIndex >= NUM_SCENE_OBJECTS)
+    {
+        int object = (_queryIndex - NUM_SCENE_OBJECTS) / MAX_NUM_INSTANCES;
+        int instance = (_queryIndex - NUM_SCENE_OBJECTS) % MAX_NUM_INSTANCES;
+
+        switch(object)
+        {
+        case INSTANCED_MESH_OBJECT:
+            *_boxMin = objLoader->getBoundMin();
+            *_boxMax = objLoader->getBoundMax();
+            break;
+
+        case INSTANCED_BILLBOARD:
+            *_boxMin = planeObject->getBoundMin();
+            *_boxMax = planeObject->getBoundMax();
+            break;
+
+        default:
+            *_boxMin = cubeObject->getBoundMin();
+            *_boxMax = cubeObject->getBoundMax();
+            break;
+        }
+
+        return instanceModelMatrices[object].at(instance);
+    }
+
+    switch(_queryIndex)
+    {
+    case SCENE_OBJECT_MESH:
+        *_boxMin = objLoader->getBoundMin();
+        *_boxMax = objLoader->getBoundMax();
+        return meshObjectModelMatrix;
+
+    case SCENE_OBJECT_OCCLUDER:
+        *_boxMin = cubeObject->getBoundMin();
+        *_boxMax = cubeObject->getBoundMax();
+        return occluderModelMatrix;
+
+    case SCENE_OBJECT_BILLBOARD:
+        *_boxMin = planeObject->getBoundMin();
+        *_boxMax = planeObject->getBoundMax();
+        return getBillboardModelMatrix();
+
+    default:
+        *_boxMin = cubeObject->getBoundMin();
+        *_boxMax = cubeObject->getBoundMax();
+        return cubeModelMatrix;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// draw the bounding boxes of the objects in the camera frustum against the final depth
+// buffer, with color and depth writes disabled
+//------------------------------------------------------------------------------------------
+void Renderer::issueOcclusionQueries()
+{
+    Profiler::Scope profilerScope(&profiler, "issueOcclusionQueries");
+
+    if(!enabledFrustumCulling || !enabledOcclusionCulling ||
+       occlusionQueryCandidates.isEmpty())
+    {
+        return;
+    }
+
+    if(occlusionQueries.isEmpty())
+    {
+        int numQueries = NUM_SCENE_OBJECTS + NUM_INSTANCED_OBJECTS * MAX_NUM_INSTANCES;
+        occlusionQueries.resize(numQueries);
+        occlusionQueryIssued.fill(0, numQueries);
+        glGenQueries(numQueries, occlusionQueries.data());
+    }
+
+    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glDisable(GL_CULL_FACE);
+
+    requireShadingProgram(OCCLUSION_QUERY_SHADING);
+    occlusionQueryProgram->bind();
+    profiler.countStateChange();
+    vaoBoundingBox.bind();
+    profiler.countStateChange();
+
+    for(int i = 0; i < occlusionQueryCandidates.size(); ++i)
+    {
+        int queryIndex = occlusionQueryCandidates.at(i);
+        QVector3D boxMin, boxMax;
+        QMatrix4x4 modelMatrix = getOcclusionQueryBox(queryIndex, &boxMin, &boxMax);
+
+        // enlarge the box a bit, so that flat objects still cover some pixels
+        QVector3D boxCenter = 0.5f * (boxMin + boxMax);
+        QVector3D boxExtent = 0.5f * (boxMax - boxMin) * 1.01f + QVector3D(0.01f, 0.01f, 0.01f);
+
+        /////////////////////////////////////////////////////////////////
+        // a box containing the camera is clipped by the near plane, the object
+        // is then simply assumed to be visible
+        QVector3D center = modelMatrix * boxCenter;
+        QVector3D distance = cameraPosition - center;
+        bool containsCamera = true;
+
+        for(int j = 0; j < 3; ++j)
+        {
+            float extent = fabs(modelMatrix(j, 0)) * boxExtent.x() +
+                           fabs(modelMatrix(j, 1)) * boxExtent.y() +
+                           fabs(modelMatrix(j, 2)) * boxExtent.z();
+            containsCamera = containsCamera && (fabs(distance[j]) <= extent + 0.2f);
+        }
+
+        if(containsCamera)
+        {
+            continue;
+        }
+
+        QMatrix4x4 boxMatrix = modelMatrix;
+        boxMatrix.translate(boxCenter);
+        boxMatrix.scale(boxExtent);
+        occlusionQueryProgram->setUniformValue(uniBoxMatrix, viewProjectionMatrix * boxMatrix);
+
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, occlusionQueries[queryIndex]);
+        glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+        profiler.countDrawCall();
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        occlusionQueryIssued[queryIndex] = 1;
+        issuedOcclusionQueries.append(queryIndex);
+    }
+
+    vaoBoundingBox.release();
+    occlusionQueryProgram->release();
+
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+//------------------------------------------------------------------------------------------
+// refill the instance buffers and the indirect commands with the objects visible in a pass
+//------------------------------------------------------------------------------------------
+void Renderer::selectCullingPass(CullingPass _pass)
+{
+    if(!enabledFrustumCulling)
+    {
+        _pass = UNCULLED_PASS;
+    }
+
+    if(currentCullingPass == _pass)
+    {
+        return;
+    }
+
+    currentCullingPass = _pass;
+
+    for(int i = 0; i < NUM_INSTANCED_OBJECTS; ++i)
+    {
+        if(instanceUploadPass[i] != _pass)
+        {
+            uploadInstanceMatrices(static_cast<InstancedObject>(i), _pass);
+        }
+    }
+
+    if(enabledMultiDrawIndirect)
+    {
+        updateSceneDrawData();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+bool Renderer::isSceneObjectVisible(SceneObject _object)
+{
+    if(!enabledFrustumCulling || currentCullingPass < 0 ||
+       currentCullingPass >= NUM_CULLING_PASSES)
+    {
+        return true;
+    }
+
+    return sceneObjectVisible[currentCullingPass][_object];
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderScene()
+{
+    Profiler::Scope profilerScope(&profiler, "renderScene");
+
+    numIssuedTimerQueries = 0;
+    switchTimedPass(TIMED_MAIN_PASS);
+
+    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+    glClearColor(0.8f, 0.8f, 0.8f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    updateBillboardInstanceMatrices();
+    cullScene();
+    updateLightClusters();
+
+    renderLight();
+
+    switch(currentShadowMode)
+    {
+    case NO_SHADOW:
+        if(enabledDeferredShading)
+        {
+            renderObjectWithDeferredShading();
+        }
+        else
+        {
+            renderObjectWithoutShadow(ALL_LIGHT);
+        }
+
+        break;
+
+    case PROJECTIVE_SHADOW:
+        if(enabledBatchedProjectiveShadow)
+        {
+            renderObjectWithBatchedProjectiveShadow();
+        }
+        else
+        {
+            renderObjectWithProjectiveShadow();
+        }
+
+        break;
+
+    case SHADOW_MAP:
+        if(enabledDeferredShading)
+        {
+            renderObjectWithDeferredShading();
+        }
+        else
+        {
+            renderObjectWithShadowMap();
+        }
+
+        break;
+
+    case SHADOW_VOLUME:
+        renderObjectWithShadowVolume();
+        break;
+
+    default:
+        break;
+    }
+
+    issueOcclusionQueries();
+
+    switchTimedPass(NO_TIMED_PASS);
+}
+
+//------------------------------------------------------------------------------------------
+// The scene is drawn first, then the ids of the receivers. Every caster is drawn once, the
+// geometry shader projecting it onto each planar receiver facing the light, each invocation
+// clipped to the rectangle of its own receiver; the fragments outside the triangles of
+// that receiver are discarded by their id. The shadows are depth tested against the scene,
+// and the stencil is incremented by the first shadow fragment of a pixel, so overlapping
+// shadows are not blended twice.
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithBatchedProjectiveShadow()
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithBatchedProjectiveShadow");
+
+    requireShadingProgram(PROJECTED_OBJECT_SHADING);
+
+    renderObjectWithoutShadow(ALL_LIGHT);
+
+    PlanarPatch receivers[MAX_NUM_RECEIVER_PLANES];
+    int numReceivers = getReceiverPatches(receivers);
+
+    if(numReceivers == 0)
+    {
+        return;
+    }
+
+    QVector4D planeVectors[MAX_NUM_RECEIVER_PLANES];
+    QVector3D receiverOrigins[MAX_NUM_RECEIVER_PLANES];
+    QVector3D receiverAxesU[MAX_NUM_RECEIVER_PLANES];
+    QVector3D receiverAxesV[MAX_NUM_RECEIVER_PLANES];
+
+    for(int i = 0; i < numReceivers; ++i)
+    {
+        planeVectors[i] = receivers[i].plane;
+        receiverOrigins[i] = receivers[i].origin;
+        receiverAxesU[i] = receivers[i].edgeU / receivers[i].edgeU.lengthSquared();
+        receiverAxesV[i] = receivers[i].edgeV / receivers[i].edgeV.lengthSquared();
+    }
+
+    renderReceiverIds(receivers, numReceivers);
+
+    // the shadows fall onto the visible receivers, whether their casters are visible or not
+    selectCullingPass(UNCULLED_PASS);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // render projected shadow onto all receivers
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glStencilFunc(GL_EQUAL, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(-1.0f, -1.0f);
+
+    glEnable(GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        glEnable(GL_CLIP_DISTANCE0 + i);
+    }
+
+    projectedShadowProgram->bind();
+    profiler.countStateChange();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, FBOReceiverId->texture());
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniMatrices[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniLight[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_LIGHT]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                     UBOLight);
+
+    projectedShadowProgram->setUniformValue(uniShadowIntensity,
+                                            (GLfloat)(1.0 - ambientLight));
+    projectedShadowProgram->setUniformValue(uniBatchedPlanes, GL_TRUE);
+    projectedShadowProgram->setUniformValue(uniNumReceivers, numReceivers);
+    projectedShadowProgram->setUniformValueArray(uniPlaneVectors, planeVectors, numReceivers);
+    projectedShadowProgram->setUniformValueArray(uniReceiverOrigins, receiverOrigins,
+                                                 numReceivers);
+    projectedShadowProgram->setUniformValueArray(uniReceiverAxesU, receiverAxesU,
+                                                 numReceivers);
+    projectedShadowProgram->setUniformValueArray(uniReceiverAxesV, receiverAxesV,
+                                                 numReceivers);
+
+    switchTimedPass(TIMED_SHADOW_PASS);
+    renderProjectedObjects();
+    switchTimedPass(TIMED_MAIN_PASS);
+
+    projectedShadowProgram->setUniformValue(uniBatchedPlanes, GL_FALSE);
+    projectedShadowProgram->release();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for(int i = 0; i < 4; ++i)
+    {
+        glDisable(GL_CLIP_DISTANCE0 + i);
+    }
+
+    glDisable(GL_BLEND);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthFunc);
+    glDisable(GL_STENCIL_TEST);
+}
+
+//------------------------------------------------------------------------------------------
+// The flat parts of the room, the cube, the occluder and the mesh object in world space.
+// A receiver is kept if it faces the light and the camera sees it, the largest ones first.
+//------------------------------------------------------------------------------------------
+int Renderer::getReceiverPatches(PlanarPatch* _receivers)
+{
+    QVector<PlanarPatch> receivers;
+
+    addReceiverPatches(cubePatches, roomModelMatrix, true, &receivers);
+    addReceiverPatches(cubePatches, cubeModelMatrix, false, &receivers);
+    addReceiverPatches(cubePatches, occluderModelMatrix, false, &receivers);
+    addReceiverPatches(meshObjectPatches, meshObjectModelMatrix, false, &receivers);
+
+    /////////////////////////////////////////////////////////////////
+    // frustum culling of the receivers
+    receiverCuller.setFrustum(viewProjectionMatrix);
+    receiverCuller.clearBoxes();
+
+    for(int i = 0; i < receivers.size(); ++i)
+    {
+        const PlanarPatch& patch = receivers.at(i);
+        QVector3D corners[3] =
+        {
+            patch.origin + patch.edgeU,
+            patch.origin + patch.edgeV,
+            patch.origin + patch.edgeU + patch.edgeV
+        };
+        QVector3D boxMin = patch.origin;
+        QVector3D boxMax = patch.origin;
+
+        for(int j = 0; j < 3; ++j)
+        {
+            boxMin = QVector3D(fmin(boxMin.x(), corners[j].x()), fmin(boxMin.y(), corners[j].y()),
+                               fmin(boxMin.z(), corners[j].z()));
+            boxMax = QVector3D(fmax(boxMax.x(), corners[j].x()), fmax(boxMax.y(), corners[j].y()),
+                               fmax(boxMax.z(), corners[j].z()));
+        }
+
+        receiverCuller.addBox(boxMin, boxMax, QMatrix4x4());
+    }
+
+    receiverCuller.cullBoxes();
+
+    /////////////////////////////////////////////////////////////////
+    // keep the largest visible receivers
+    int numReceivers = 0;
+
+    for(int i = 0; i < receivers.size(); ++i)
+    {
+        if(!receiverCuller.isVisible(i))
+        {
+            continue;
+        }
+
+        int j = qMin(numReceivers, MAX_NUM_RECEIVER_PLANES - 1);
+
+        if(numReceivers == MAX_NUM_RECEIVER_PLANES &&
+           _receivers[j].area >= receivers.at(i).area)
+        {
+            continue;
+        }
+
+        while(j > 0 && _receivers[j - 1].area < receivers.at(i).area)
+        {
+            _receivers[j] = _receivers[j - 1];
+            --j;
+        }
+
+        _receivers[j] = receivers.at(i);
+        numReceivers = qMin(numReceivers + 1, MAX_NUM_RECEIVER_PLANES);
+    }
+
+    return numReceivers;
+}
+
+//------------------------------------------------------------------------------------------
+// Writes the id of the receivers, from 1, to the pixels covered by their triangles. A
+// receiver hidden by another object still writes its id, the shadow fragments there fail
+// the depth test against the scene anyway.
+//------------------------------------------------------------------------------------------
+void Renderer::renderReceiverIds(const PlanarPatch* _receivers, int _numReceivers)
+{
+    Profiler::Scope profilerScope(&profiler, "renderReceiverIds");
+
+    requireShadingProgram(RECEIVER_ID_SHADING);
+
+    if(!FBOReceiverId || receiverIdSize != QSize(width() * retinaScale, height() * retinaScale))
+    {
+        initReceiverIdObject();
+    }
+
+    QVector<GLfloat> vertices;
+
+    for(int i = 0; i < _numReceivers; ++i)
+    {
+        const QVector<QVector3D>& triangles = _receivers[i].triangles;
+
+        for(int j = 0; j < triangles.size(); ++j)
+        {
+            vertices << triangles.at(j).x() << triangles.at(j).y() << triangles.at(j).z()
+                     << (GLfloat)(i + 1);
+        }
+    }
+
+    vboReceiverTriangles.bind();
+    vboReceiverTriangles.allocate(vertices.constData(), vertices.size() * sizeof(GLfloat));
+    vboReceiverTriangles.release();
+
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+
+    const GLfloat noReceiver[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    FBOReceiverId->bind();
+    glViewport(0, 0, receiverIdSize.width(), receiverIdSize.height());
+    glClearBufferfv(GL_COLOR, 0, noReceiver);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    receiverIdProgram->bind();
+    profiler.countStateChange();
+    glUniformBlockBinding(receiverIdProgram->programId(), uniMatrices[RECEIVER_ID_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+
+    vaoReceiverTriangles.bind();
+    profiler.countStateChange();
+    glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 4);
+    profiler.countDrawCall();
+    vaoReceiverTriangles.release();
+    receiverIdProgram->release();
+
+    glDepthFunc(depthFunc);
+    glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
+    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+}
+
+//------------------------------------------------------------------------------------------
+// the room is seen from inside, its patches are flipped to face inward
+//------------------------------------------------------------------------------------------
+void Renderer::addReceiverPatches(const QVector<PlanarPatch>& _patches,
+                                  const QMatrix4x4& _modelMatrix, bool _flipped,
+                                  QVector<PlanarPatch>* _receivers)
+{
+    QVector3D lightPos = QVector3D(light.position);
+
+    for(int i = 0; i < _patches.size(); ++i)
+    {
+        PlanarPatch patch = _patches.at(i).transformed(_modelMatrix);
+
+        if(_flipped)
+        {
+            patch.plane = -patch.plane;
+        }
+
+        // the light and the camera must be on the front side of the receiver
+        QVector3D normal = patch.plane.toVector3D();
+
+        if(QVector3D::dotProduct(normal, lightPos) + patch.plane.w() <= 0.0f ||
+           QVector3D::dotProduct(normal, cameraPosition) + patch.plane.w() <= 0.0f)
+        {
+            continue;
+        }
+
+        _receivers->append(patch);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithoutShadow(int _lightingMode)
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithoutShadow");
+
+    selectCullingPass(CAMERA_PASS);
+
+    // the shadow volume passes do their own depth handling
+    bool depthPrePass = enabledDepthPrePass && (_lightingMode == ALL_LIGHT);
+
+    if(depthPrePass)
+    {
+        renderDepthPrePass();
+    }
+
+    bindShadingProgram(_lightingMode, false);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+
+    renderSceneObjects(true);
+
+    currentShadingProgram->release();
+
+    if(depthPrePass)
+    {
+        endDepthPrePass();
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// the 4 walls, the floor and the ceiling of the room, with their normals pointing inside
+//------------------------------------------------------------------------------------------
+void Renderer::getReceiverPlanes(QVector4D* _planes)
+{
+    _planes[0] = QVector4D(0, 0, -1, roomSize);
+    _planes[1] = QVector4D(-1, 0, 0, roomSize);
+    _planes[2] = QVector4D(0, 0, 1, roomSize);
+    _planes[3] = QVector4D(1, 0, 0, roomSize);
+    _planes[4] = QVector4D(0, 1, 0, 0);
+    _planes[5] = QVector4D(0, -1, 0, 2 * roomSize);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithProjectiveShadow()
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithProjectiveShadow");
+
+    requireShadingProgram(PROJECTED_OBJECT_SHADING);
+
+    // the shadows are projected onto the room, whether their casters are visible or not
+    selectCullingPass(UNCULLED_PASS);
+    renderLight();
+
+    QVector4D planeNormals[6];
+    getReceiverPlanes(planeNormals);
+
+    for(int i = 0; i < 4; ++i)
+    {
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // render the 4 faces of the room
+        bindShadingProgram(ALL_LIGHT, false);
+        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+        bindShadingMaterial(BINDING_ROOM_MATERIAL, UBORoomMaterial);
+
+        /////////////////////////////////////////////////////////////////
+        // flush the model and normal matrices
+        glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                        roomModelMatrix.constData());
+        glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                        roomNormalMatrix.constData());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        vaoRoom[currentShadingMode].bind();
+        profiler.countStateChange();
+
+        glEnable(GL_STENCIL_TEST);
+        glStencilMask(0xFF);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(6 * i * sizeof(GLushort) ));
+        profiler.countDrawCall();
+        glDisable(GL_CULL_FACE);
+
+
+        vaoRoom[currentShadingMode].release();
+        currentShadingProgram->release();
+
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // render projected shadow
+        glDisable(GL_DEPTH_TEST);
+        glStencilFunc(GL_EQUAL, 1, 0xFF);
+
+        glEnable(GL_BLEND);
+        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        projectedShadowProgram->bind();
+        profiler.countStateChange();
+
+        /////////////////////////////////////////////////////////////////
+        // set the uniform
+        glUniformBlockBinding(projectedShadowProgram->programId(),
+                              uniMatrices[PROJECTED_OBJECT_SHADING],
+                              UBOBindingIndex[BINDING_MATRICES]);
+        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                         UBOMatrices);
+
+        glUniformBlockBinding(projectedShadowProgram->programId(),
+                              uniLight[PROJECTED_OBJECT_SHADING],
+                              UBOBindingIndex[BINDING_LIGHT]);
+        glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                         UBOLight);
+
+        projectedShadowProgram->setUniformValue(uniShadowIntensity,
+                                                (GLfloat)(1.0 - ambientLight));
+        projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[i]);
+
+        switchTimedPass(TIMED_SHADOW_PASS);
+        renderProjectedObjects();
+        switchTimedPass(TIMED_MAIN_PASS);
+
+        projectedShadowProgram->release();
+        glDisable(GL_BLEND);
+
+    }
+
+
+    /////////////////////////////////////////////////////////////////
+    // render the floor
+    bindShadingProgram(ALL_LIGHT, false);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+    bindShadingMaterial(BINDING_ROOM_MATERIAL, UBORoomMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    roomModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    roomNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    vaoRoom[currentShadingMode].bind();
+    profiler.countStateChange();
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+
+    glEnable(GL_DEPTH_TEST);
+    setSurfaceFeatures(true);
+    floorTextures[currentFloorTexture]->bind(0);
+
+    if(enabledTextureAnisotropicFiltering)
+    {
+        GLfloat fLargest;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+    }
+    else
+    {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+    }
+
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 24));
+    profiler.countDrawCall();
+    floorTextures[currentFloorTexture]->release();
+
+    vaoRoom[currentShadingMode].release();
+    currentShadingProgram->release();
+
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // render projected shadow
+    glDisable(GL_DEPTH_TEST);
+    glStencilFunc(GL_EQUAL, 1, 0xFF);
+    glEnable(GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    projectedShadowProgram->bind();
+    profiler.countStateChange();
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniMatrices[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniLight[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_LIGHT]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                     UBOLight);
+
+    projectedShadowProgram->setUniformValue(uniShadowIntensity,
+                                            (GLfloat)(1.0 - ambientLight));
+    projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[4]);
+
+    switchTimedPass(TIMED_SHADOW_PASS);
+    renderProjectedObjects();
+    switchTimedPass(TIMED_MAIN_PASS);
+
+    projectedShadowProgram->release();
+
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_DEPTH_TEST);
+
+
+    /////////////////////////////////////////////////////////////////
+    // render the ceiling
+    bindShadingProgram(ALL_LIGHT, false);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+    bindShadingMaterial(BINDING_ROOM_MATERIAL, UBORoomMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    roomModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    roomNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    vaoRoom[currentShadingMode].bind();
+    profiler.countStateChange();
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    glStencilOp(GL_ZERO, GL_ZERO, GL_INCR);
+
+    glEnable(GL_DEPTH_TEST);
+    setSurfaceFeatures(true);
+    ceilingTexture->bind(0);
+
+    if(enabledTextureAnisotropicFiltering)
+    {
+        GLfloat fLargest;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+    }
+    else
+    {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+    }
+
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 30));
+    profiler.countDrawCall();
+    glDisable(GL_CULL_FACE);
+    ceilingTexture->release();
+
+
+
+    vaoRoom[currentShadingMode].release();
+    currentShadingProgram->release();
+
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // render projected shadow
+    glDisable(GL_DEPTH_TEST);
+    glStencilFunc(GL_EQUAL, 1, 0xFF);
+
+    glEnable(GL_BLEND);
+    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    projectedShadowProgram->bind();
+    profiler.countStateChange();
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniMatrices[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    glUniformBlockBinding(projectedShadowProgram->programId(),
+                          uniLight[PROJECTED_OBJECT_SHADING],
+                          UBOBindingIndex[BINDING_LIGHT]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                     UBOLight);
+
+    projectedShadowProgram->setUniformValue(uniShadowIntensity,
+                                            (GLfloat)(1.0 - ambientLight));
+    projectedShadowProgram->setUniformValue(uniPlaneVector, planeNormals[5]);
+    projectedShadowProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
+
+    switchTimedPass(TIMED_SHADOW_PASS);
+    renderProjectedObjects();
+    switchTimedPass(TIMED_MAIN_PASS);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+    glEnable(GL_DEPTH_TEST);
+
+    ////////////////////////////////////////////////////////////////////////////////
+    // render the shadow casting
+    bindShadingProgram(ALL_LIGHT, false);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+
+    selectCullingPass(CAMERA_PASS);
+    renderSceneObjects(false);
+    currentShadingProgram->release();
+}
+
+//------------------------------------------------------------------------------------------
+// lay down the depth of the scene from the camera with the cheap shadow map program, the
+// following shading pass then only shades the visible surface of each pixel
+//------------------------------------------------------------------------------------------
+void Renderer::renderDepthPrePass()
+{
+    Profiler::Scope profilerScope(&profiler, "renderDepthPrePass");
+
+    requireShadingProgram(SHADOW_MAP_SHADING);
+
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFuncBeforePrePass);
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    shadowMapProgram->bind();
+    profiler.countStateChange();
+    glUniformBlockBinding(shadowMapProgram->programId(), uniMatrices[SHADOW_MAP_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+    shadowMapProgram->setUniformValue(uniCameraView, GL_TRUE);
+    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], GL_FALSE);
+
+    renderRoom2DepthMap();
+    renderObjects2DepthMap();
+
+    shadowMapProgram->setUniformValue(uniCameraView, GL_FALSE);
+    shadowMapProgram->release();
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::endDepthPrePass()
+{
+    glDepthFunc(depthFuncBeforePrePass);
+    glDepthMask(GL_TRUE);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::generateShadowMap()
+{
+    Profiler::Scope profilerScope(&profiler, "generateShadowMap");
+
+    requireShadingProgram(SHADOW_MAP_SHADING);
+
+    switchTimedPass(TIMED_SHADOW_PASS);
+    updateShadowLights();
+
+    /////////////////////////////////////////////////////////////////
+    // render scene to the tiles of the shadow atlas
+    FBODepthMap->bind();
+    glViewport(0, 0, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE);
+    glDrawBuffer(GL_NONE);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(4.0f, 4.0f);
+
+    shadowMapProgram->bind();
+    profiler.countStateChange();
+    glUniformBlockBinding(shadowMapProgram->programId(), uniMatrices[SHADOW_MAP_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    for(int i = 0; i < numShadowLights; ++i)
+    {
+        QRect tile = shadowAtlas.getTile(i);
+
+        if(tile.isEmpty())
+        {
+            continue;
+        }
+
+        // the casters are culled against the frustum of the main light only
+        selectCullingPass((i == 0) ? LIGHT_PASS : UNCULLED_PASS);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+        glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
+                        shadowLights.at(i).shadowMatrix.constData());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glViewport(tile.x(), tile.y(), tile.width(), tile.height());
+        renderObjects2DepthMap();
+    }
+
+    // the shading programs project the main light with the shadow matrix
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 3 * SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    shadowMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    shadowMapProgram->release();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
+    switchTimedPass(TIMED_MAIN_PASS);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithShadowMap()
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithShadowMap");
+
+    if(!initializedDepthBuffer)
+    {
+        initDepthBufferObject();
+    }
+
+    generateShadowMap();
+    selectCullingPass(CAMERA_PASS);
+
+    /////////////////////////////////////////////////////////////////
+    // render scene with shadow map
+    makeCurrent();
+    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+
+    renderLight();
+
+    if(enabledDepthPrePass)
+    {
+        renderDepthPrePass();
+    }
+
+    bindShadingProgram(ALL_LIGHT, true);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES], UBOMatrices);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT], UBOLight);
+
+    depthTexture->bind(1);
+
+    renderSceneObjects(true);
+
+    depthTexture->release();
+    currentShadingProgram->release();
+
+    if(enabledDepthPrePass)
+    {
+        endDepthPrePass();
+    }
+}
+
+
+//------------------------------------------------------------------------------------------
+void Renderer::generateShadowVolume(const QVector3D& _lightPosition)
+{
+    Profiler::Scope profilerScope(&profiler, "generateShadowVolume");
+
+    UnitCube::CubeFaceTriangle* face1;
+    UnitCube::CubeFaceTriangle* face2;
+    QVector3D lightDir1, lightDir2;
+    QVector3D sharedVertices[2];
+    float dot1, dot2;
+    shadowVolume.clear();
+
+    for(int i = 0; i < cubeObject->getNumFaceTriangles(); ++i)
+    {
+        face1 = occluderFaces[i];
+        lightDir1 = _lightPosition - face1->vertices[0];
+        dot1 = QVector3D::dotProduct(face1->faceNormal, lightDir1);
+
+        for(int j = 0; j < cubeObject->getNumFaceTriangles(); ++j)
+        {
+            if(i == j)
+            {
+                continue;
+            }
+
+            face2 = occluderFaces[j];
+            lightDir2 = _lightPosition - face2->vertices[0];
+            dot2 = QVector3D::dotProduct(face2->faceNormal, lightDir2);
+
+            if(dot1 * dot2 < 0) // silhouette
+            {
                 if(dot1 < 0)
                 {
                     if(face1->findSharedVertices(face2->vertices, sharedVertices))
@@ -2419,165 +6381,900 @@ void Renderer::generateShadowVolume()
                         // first triangle
                         shadowVolume.append(sharedVertices[0]);
                         shadowVolume.append(sharedVertices[1]);
-                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - QVector3D(
-                                                                           light.position)));
+                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - _lightPosition));
+
+                        // second triangle
+                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - _lightPosition));
+                        shadowVolume.append(sharedVertices[1]);
+                        shadowVolume.append(sharedVertices[1] + 100 * (sharedVertices[1] - _lightPosition));
+
+                    }
+                }
+                else
+                {
+                    if(face2->findSharedVertices(face1->vertices, sharedVertices))
+                    {
+                        // first triangle
+                        shadowVolume.append(sharedVertices[0]);
+                        shadowVolume.append(sharedVertices[1]);
+                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - _lightPosition));
+
+                        // second triangle
+                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - _lightPosition));
+                        shadowVolume.append(sharedVertices[1]);
+                        shadowVolume.append(sharedVertices[1] + 100 * (sharedVertices[1] - _lightPosition));
+                    }
+
+                }
+
+            }
+        }
+    }
+
+    Profiler::Scope uploadScope(&profiler, "uploadShadowVolume");
+    vboShadowVolume.bind();
+    vboShadowVolume.write(0, shadowVolume.constData(),
+                          sizeof(GLfloat) * 3 * shadowVolume.size());
+    vboShadowVolume.release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderShadowVolume()
+{
+    Profiler::Scope profilerScope(&profiler, "renderShadowVolume");
+
+    requireShadingProgram(SHADOW_VOLUME_SHADING);
+
+    shadowVolumeProgram->bind();
+    profiler.countStateChange();
+    glUniformBlockBinding(shadowVolumeProgram->programId(),
+                          uniMatrices[SHADOW_VOLUME_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    vaoShadowVolume.bind();
+    profiler.countStateChange();
+    glDrawArrays(GL_TRIANGLES, 0, shadowVolume.size());
+    profiler.countDrawCall();
+    vaoShadowVolume.release();
+    shadowVolumeProgram->release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithShadowVolume()
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithShadowVolume");
+
+    renderObjectWithoutShadow(AMBIENT_LIGHT);
+
+    glEnable(GL_STENCIL_TEST);
+    renderShadowVolumeLight(light);
+
+    /////////////////////////////////////////////////////////////////
+    // the point lights only clear, mark and light the pixels of their
+    // attenuation sphere
+    if(enabledPointLightShadowVolumes)
+    {
+        int numLights = qMin(pointLights.size(), MAX_NUM_SHADOW_VOLUME_LIGHTS);
+
+        glEnable(GL_SCISSOR_TEST);
+
+        if(depthBoundsFunction)
+        {
+            glEnable(GL_DEPTH_BOUNDS_TEST_EXT);
+        }
+
+        for(int i = 0; i < numLights; ++i)
+        {
+            const PointLight& pointLight = pointLights.at(i);
+            QRect scissor;
+            float depthMin, depthMax;
+
+            if(!getLightScissor(pointLight.positionRadius, scissor, depthMin, depthMax))
+            {
+                continue;
+            }
+
+            glScissor(scissor.x(), scissor.y(), scissor.width(), scissor.height());
+
+            if(depthBoundsFunction)
+            {
+                depthBoundsFunction(depthMin, depthMax);
+            }
+
+            Light volumeLight;
+            volumeLight.position = QVector4D(pointLight.positionRadius.toVector3D(), 1.0f);
+            volumeLight.color = QVector4D(pointLight.colorIntensity.toVector3D(), 1.0f);
+            volumeLight.intensity = pointLight.colorIntensity.w();
+            volumeLight.radius = pointLight.positionRadius.w();
+            renderShadowVolumeLight(volumeLight);
+        }
+
+        if(depthBoundsFunction)
+        {
+            glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
+        }
+
+        glDisable(GL_SCISSOR_TEST);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+        glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                     &light, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+}
+
+//------------------------------------------------------------------------------------------
+// the stencil marks the pixels inside the shadow volumes of the light, the others are
+// lit additively; the stencil clear and both passes respect the scissor of the light
+//------------------------------------------------------------------------------------------
+void Renderer::renderShadowVolumeLight(const Light& _light)
+{
+    Profiler::Scope profilerScope(&profiler, "renderShadowVolumeLight");
+
+    switchTimedPass(TIMED_STENCIL_PASS);
+    generateShadowVolume(QVector3D(_light.position));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOLight);
+    glBufferData(GL_UNIFORM_BUFFER, light.getStructSize(),
+                 &_light, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glDisable(GL_BLEND);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glStencilMask(0xFF);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    renderShadowVolume();
+    glCullFace(GL_FRONT);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
+    renderShadowVolume();
+    glDisable(GL_CULL_FACE);
+    switchTimedPass(TIMED_MAIN_PASS);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glStencilMask(0xFF);
+    glStencilFunc(GL_EQUAL, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    if(enabledShowShadowVolume)
+    {
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_STENCIL_TEST);
+        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        renderShadowVolume();
+        glEnable(GL_STENCIL_TEST);
+    }
+
+    glEnable(GL_STENCIL_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glBlendFunc(GL_ONE, GL_ONE);
+    renderObjectWithoutShadow(DIFFUSE_SPECULAR);
+}
+
+//------------------------------------------------------------------------------------------
+// the scene is written once to the G-buffer, then lit by a fullscreen pass for the main
+// light and by one light volume per point light
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjectWithDeferredShading()
+{
+    Profiler::Scope profilerScope(&profiler, "renderObjectWithDeferredShading");
+
+    if(!FBOGBuffer || gBufferSize != QSize(width() * retinaScale, height() * retinaScale))
+    {
+        initGBufferObject();
+    }
+
+    bool hasShadowMap = (currentShadowMode == SHADOW_MAP);
+
+    if(hasShadowMap)
+    {
+        if(!initializedDepthBuffer)
+        {
+            initDepthBufferObject();
+        }
+
+        generateShadowMap();
+    }
+
+    selectCullingPass(CAMERA_PASS);
+
+    renderGBuffer();
+    renderDeferredLighting(hasShadowMap);
+    renderPointLights();
+
+    // the fullscreen pass has covered the light drawn before
+    renderLight();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderGBuffer()
+{
+    Profiler::Scope profilerScope(&profiler, "renderGBuffer");
+
+    requireShadingProgram(GBUFFER_SHADING);
+
+    GLenum drawBuffers[NUM_GBUFFER_TARGETS] =
+    {
+        GL_COLOR_ATTACHMENT0,
+        GL_COLOR_ATTACHMENT1,
+        GL_COLOR_ATTACHMENT2
+    };
+
+    FBOGBuffer->bind();
+    glViewport(0, 0, gBufferSize.width(), gBufferSize.height());
+    glDrawBuffers(NUM_GBUFFER_TARGETS, drawBuffers);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    /////////////////////////////////////////////////////////////////
+    // the objects are drawn by the forward functions, with the G-buffer program
+    // standing in for the current shading program
+    ShadingProgram shadingMode = currentShadingMode;
+    QOpenGLShaderProgram* shadingProgram = currentShadingProgram;
+    currentShadingMode = GBUFFER_SHADING;
+    currentShadingProgram = gBufferProgram;
+
+    gBufferProgram->bind();
+    profiler.countStateChange();
+    gBufferProgram->setUniformValue(uniObjTexture[GBUFFER_SHADING], 0);
+    glUniformBlockBinding(gBufferProgram->programId(), uniMatrices[GBUFFER_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    renderSceneObjects(true);
+
+    gBufferProgram->release();
+    currentShadingMode = shadingMode;
+    currentShadingProgram = shadingProgram;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, getTargetFramebuffer());
+
+    /////////////////////////////////////////////////////////////////
+    // the light volumes and the forward drawn light test against the scene depth
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBOGBuffer->handle());
+    glBlitFramebuffer(0, 0, gBufferSize.width(), gBufferSize.height(),
+                      0, 0, gBufferSize.width(), gBufferSize.height(),
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, getTargetFramebuffer());
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::bindGBufferTextures()
+{
+    QVector<GLuint> textures = FBOGBuffer->textures();
+
+    for(int i = 0; i < NUM_GBUFFER_TARGETS; ++i)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures.at(i));
+    }
+
+    gBufferDepthTexture->bind(NUM_GBUFFER_TARGETS);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderDeferredLighting(bool _hasShadowMap)
+{
+    Profiler::Scope profilerScope(&profiler, "renderDeferredLighting");
+
+    requireShadingProgram(DEFERRED_LIGHTING_SHADING);
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    glViewport(0, 0, width() * retinaScale, height() * retinaScale);
+    glDisable(GL_DEPTH_TEST);
+
+    deferredLightingProgram->bind();
+    profiler.countStateChange();
+    deferredLightingProgram->setUniformValue(uniCameraPosition[DEFERRED_LIGHTING_SHADING],
+                                             cameraPosition);
+    deferredLightingProgram->setUniformValue(uniAmbientLight[DEFERRED_LIGHTING_SHADING],
+                                             ambientLight);
+    deferredLightingProgram->setUniformValue(uniHasDepthTexture[DEFERRED_LIGHTING_SHADING],
+                                             _hasShadowMap);
+    deferredLightingProgram->setUniformValue(uniInverseViewProjection[DEFERRED_LIGHTING_SHADING],
+                                             viewProjectionMatrix.inverted());
+
+    glUniformBlockBinding(deferredLightingProgram->programId(),
+                          uniMatrices[DEFERRED_LIGHTING_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    glUniformBlockBinding(deferredLightingProgram->programId(),
+                          uniLight[DEFERRED_LIGHTING_SHADING],
+                          UBOBindingIndex[BINDING_LIGHT]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                     UBOLight);
+
+    bindGBufferTextures();
+
+    if(_hasShadowMap)
+    {
+        depthTexture->bind(NUM_GBUFFER_TARGETS + 1);
+    }
+
+    vaoScreenQuad.bind();
+    profiler.countStateChange();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    profiler.countDrawCall();
+    vaoScreenQuad.release();
+
+    if(_hasShadowMap)
+    {
+        depthTexture->release(NUM_GBUFFER_TARGETS + 1);
+    }
+
+    deferredLightingProgram->release();
+
+    if(depthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// only the back faces of the light volumes are drawn, they pass the depth test where the
+// scene lies inside or in front of the volume, also with the camera inside of it
+//------------------------------------------------------------------------------------------
+void Renderer::renderPointLights()
+{
+    Profiler::Scope profilerScope(&profiler, "renderPointLights");
+
+    if(pointLights.isEmpty())
+    {
+        return;
+    }
+
+    requireShadingProgram(POINT_LIGHT_SHADING);
+
+    if(!vaoPointLight.isCreated())
+    {
+        return;
+    }
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    pointLightProgram->bind();
+    profiler.countStateChange();
+    pointLightProgram->setUniformValue(uniCameraPosition[POINT_LIGHT_SHADING],
+                                       cameraPosition);
+    pointLightProgram->setUniformValue(uniInverseViewProjection[POINT_LIGHT_SHADING],
+                                       viewProjectionMatrix.inverted());
+
+    glUniformBlockBinding(pointLightProgram->programId(), uniMatrices[POINT_LIGHT_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    bindGBufferTextures();
+
+    vaoPointLight.bind();
+    profiler.countStateChange();
+    glDrawElementsInstanced(GL_TRIANGLES, sphereObject->getNumIndices(), GL_UNSIGNED_SHORT,
+                            0, pointLights.size());
+    profiler.countDrawCall();
+    vaoPointLight.release();
+
+    pointLightProgram->release();
+
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthFunc);
+
+    if(!depthTest)
+    {
+        glDisable(GL_DEPTH_TEST);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderLight()
+{
+    Profiler::Scope profilerScope(&profiler, "renderLight");
+
+    requireShadingProgram(LIGHT_SHADING);
+
+    if(!vaoLight.isCreated())
+    {
+        qDebug() << "vaoLight is not created!";
+        return;
+    }
+
+    QOpenGLShaderProgram* program = glslPrograms[LIGHT_SHADING];
+
+    program->bind();
+    profiler.countStateChange();
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    glUniformBlockBinding(program->programId(), uniMatrices[LIGHT_SHADING],
+                          UBOBindingIndex[BINDING_MATRICES]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
+                     UBOMatrices);
+
+    glUniformBlockBinding(program->programId(), uniLight[LIGHT_SHADING],
+                          UBOBindingIndex[BINDING_LIGHT]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
+                     UBOLight);
+    program->setUniformValue("pointDistance",
+                             (cameraPosition - cameraFocus).length());
+
+    vaoLight.bind();
+    profiler.countStateChange();
+    glEnable (GL_POINT_SPRITE);
+    glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
+    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+    glEnable (GL_DEPTH_TEST);
+    glDrawArrays(GL_POINTS, 0, 1);
+    profiler.countDrawCall();
+    glDisable(GL_POINT_SPRITE);
+
+    vaoLight.release();
+    program->release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderRoom()
+{
+    Profiler::Scope profilerScope(&profiler, "renderRoom");
+
+    if(!vaoRoom[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoRoom is not created!";
+        return;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    roomModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    roomNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    bindShadingMaterial(BINDING_ROOM_MATERIAL, UBORoomMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // render the floor
+    vaoRoom[currentShadingMode].bind();
+    profiler.countStateChange();
+
+    // 4 sides
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    setSurfaceFeatures(false);
+    glDrawElements(GL_TRIANGLES, 24, GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    glDisable(GL_CULL_FACE);
+
+
+    // floor
+    setSurfaceFeatures(true);
+    floorTextures[currentFloorTexture]->bind(0);
+
+    if(enabledTextureAnisotropicFiltering)
+    {
+        GLfloat fLargest;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+    }
+    else
+    {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+    }
+
+
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 24));
+    profiler.countDrawCall();
+    floorTextures[currentFloorTexture]->release();
+
+    // ceiling
+    ceilingTexture->bind(0);
+
+    if(enabledTextureAnisotropicFiltering)
+    {
+        GLfloat fLargest;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+    }
+    else
+    {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+    }
+
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 30));
+    profiler.countDrawCall();
+    glDisable(GL_CULL_FACE);
+    ceilingTexture->release();
+
+    vaoRoom[currentShadingMode].release();
+}
+
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderRoom2DepthMap()
+{
+    if(!vaoRoom[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoRoom is not created!";
+        return;
+    }
 
-                        // second triangle
-                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - QVector3D(
-                                                                           light.position)));
-                        shadowVolume.append(sharedVertices[1]);
-                        shadowVolume.append(sharedVertices[1] + 100 * (sharedVertices[1] - QVector3D(
-                                                                           light.position)));
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    roomModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-                    }
-                }
-                else
-                {
-                    if(face2->findSharedVertices(face1->vertices, sharedVertices))
-                    {
-                        // first triangle
-                        shadowVolume.append(sharedVertices[0]);
-                        shadowVolume.append(sharedVertices[1]);
-                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - QVector3D(
-                                                                           light.position)));
 
-                        // second triangle
-                        shadowVolume.append(sharedVertices[0] + 100 * (sharedVertices[0] - QVector3D(
-                                                                           light.position)));
-                        shadowVolume.append(sharedVertices[1]);
-                        shadowVolume.append(sharedVertices[1] + 100 * (sharedVertices[1] - QVector3D(
-                                                                           light.position)));
-                    }
+    vaoRoom[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    glDisable(GL_CULL_FACE);
+    vaoRoom[SHADOW_MAP_SHADING].release();
+}
 
-                }
 
-            }
-        }
+//------------------------------------------------------------------------------------------
+void Renderer::renderCube()
+{
+    Profiler::Scope profilerScope(&profiler, "renderCube");
 
+    if(!isSceneObjectVisible(SCENE_OBJECT_CUBE))
+    {
+        return;
+    }
 
-        vboShadowVolume.bind();
-        vboShadowVolume.write(0, shadowVolume.constData(),
-                              sizeof(GLfloat) * 3 * shadowVolume.size());
-        vboShadowVolume.release();
+    if(!vaoCube[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoCube is not created!";
+        return;
     }
 
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    cubeModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    cubeNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    setSurfaceFeatures(true, false);
+    bindShadingMaterial(BINDING_CUBE_MATERIAL, UBOCubeMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // render the cube
+    vaoCube[currentShadingMode].bind();
+    profiler.countStateChange();
+    decalTexture->bind(0);
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    decalTexture->release();
+    vaoCube[currentShadingMode].release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderShadowVolume()
+void Renderer::renderProjectedCube()
 {
-    shadowVolumeProgram->bind();
-    glUniformBlockBinding(shadowVolumeProgram->programId(),
-                          uniMatrices[SHADOW_VOLUME_SHADING],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
+    if(!vaoCube[PROJECTED_OBJECT_SHADING].isCreated())
+    {
+        qDebug() << "vaoCube is not created!";
+        return;
+    }
 
-    vaoShadowVolume.bind();
-    glDrawArrays(GL_TRIANGLES, 0, shadowVolume.size());
-    vaoShadowVolume.release();
-    shadowVolumeProgram->release();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    cubeModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    vaoCube[PROJECTED_OBJECT_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoCube[PROJECTED_OBJECT_SHADING].release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderObjectWithShadowVolume()
+void Renderer::renderCube2DepthMap()
 {
-    generateShadowVolume();
-    renderObjectWithoutShadow(AMBIENT_LIGHT);
+    if(!isSceneObjectVisible(SCENE_OBJECT_CUBE))
+    {
+        return;
+    }
 
-    glEnable(GL_STENCIL_TEST);
-    glClear(GL_STENCIL_BUFFER_BIT);
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
+    if(!vaoCube[SHADOW_MAP_SHADING].isCreated())
+    {
+        qDebug() << "vaoCube is not created!";
+        return;
+    }
 
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    glDepthMask(GL_FALSE);
-    glStencilMask(0xFF);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    cubeModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
-    renderShadowVolume();
-    glCullFace(GL_FRONT);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
-    renderShadowVolume();
-    glDisable(GL_CULL_FACE);
+    vaoCube[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoCube[SHADOW_MAP_SHADING].release();
+}
 
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glDepthMask(GL_TRUE);
+//------------------------------------------------------------------------------------------
+void Renderer::renderMeshObject()
+{
+    Profiler::Scope profilerScope(&profiler, "renderMeshObject");
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE);
-    glStencilMask(0xFF);
-    glStencilFunc(GL_EQUAL, 0, 0xFF);
-    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    if(!isSceneObjectVisible(SCENE_OBJECT_MESH))
+    {
+        return;
+    }
+
+    if(!vaoMeshObject[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoMeshObject is not created!";
+        return;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    meshObjectModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    meshObjectNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    setSurfaceFeatures(false);
+
+    bindShadingMaterial(BINDING_MESH_OBJECT_MATERIAL, UBOMeshObjectMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // render the mesh object
+    vaoMeshObject[currentShadingMode].bind();
+    profiler.countStateChange();
+//    meshObjectTexture->bind(0);
+    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+//    meshObjectTexture->release();
+    vaoMeshObject[currentShadingMode].release();
+
+
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderProjectedMeshObject()
+{
+    if(!vaoMeshObject[PROJECTED_OBJECT_SHADING].isCreated())
+    {
+        qDebug() << "vaoMeshObject is not created!";
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    meshObjectModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    vaoMeshObject[PROJECTED_OBJECT_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoMeshObject[PROJECTED_OBJECT_SHADING].release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderMeshObject2DepthMap()
+{
+    if(!isSceneObjectVisible(SCENE_OBJECT_MESH))
+    {
+        return;
+    }
+
+    if(!vaoMeshObject[SHADOW_MAP_SHADING].isCreated())
+    {
+        qDebug() << "vaoMeshObject is not created!";
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    meshObjectModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    vaoMeshObject[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoMeshObject[SHADOW_MAP_SHADING].release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderBillboardObject()
+{
+    Profiler::Scope profilerScope(&profiler, "renderBillboardObject");
+
+    if(!isSceneObjectVisible(SCENE_OBJECT_BILLBOARD))
+    {
+        return;
+    }
+
+    if(!vaoBillboard[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoBillboardObject is not created!";
+        return;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // rotate the billboard to face the camera
+    QMatrix4x4 rotationMatrix = getBillboardModelMatrix();
+    QMatrix4x4 normalMatrix = -QMatrix4x4(rotationMatrix.normalMatrix());
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    rotationMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    normalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    setSurfaceFeatures(true, true, true);
+
+    bindShadingMaterial(BINDING_BILLBOARD_OBJECT_MATERIAL, UBOBillboardObjectMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // render the billboard
+    vaoBillboard[currentShadingMode].bind();
+    profiler.countStateChange();
+    billboardTexture->bind(0);
+//    glEnable(GL_BLEND);
+//    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawElements(GL_TRIANGLES, planeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+//    glDisable(GL_BLEND);
+    billboardTexture->release();
+    vaoBillboard[currentShadingMode].release();
+
+
+}
 
-    if(enabledShowShadowVolume)
+//------------------------------------------------------------------------------------------
+void Renderer::renderBillboardObject2DepthMap()
+{
+    if(!isSceneObjectVisible(SCENE_OBJECT_BILLBOARD))
     {
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_STENCIL_TEST);
-        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        renderShadowVolume();
-        glEnable(GL_STENCIL_TEST);
+        return;
     }
 
-    glEnable(GL_STENCIL_TEST);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glBlendFunc(GL_ONE, GL_ONE);
-    renderObjectWithoutShadow(DIFFUSE_SPECULAR);
+    if(!vaoBillboard[SHADOW_MAP_SHADING].isCreated())
+    {
+        qDebug() << "vaoBillboardObject is not created!";
+        return;
+    }
 
+    /////////////////////////////////////////////////////////////////
+    // rotate the billboard to face the camera
+    QMatrix4x4 rotationMatrix = getBillboardModelMatrix();
 
-    glDisable(GL_BLEND);
-    glDisable(GL_STENCIL_TEST);
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    rotationMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], GL_TRUE);
+
+    /////////////////////////////////////////////////////////////////
+    // render the billboard
+    vaoBillboard[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    billboardTexture->bind(0);
+    glDrawElements(GL_TRIANGLES, planeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    billboardTexture->release();
+    vaoBillboard[SHADOW_MAP_SHADING].release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderLight()
+void Renderer::renderOccluder()
 {
-    if(!vaoLight.isCreated())
+    Profiler::Scope profilerScope(&profiler, "renderOccluder");
+
+    if(!isSceneObjectVisible(SCENE_OBJECT_OCCLUDER))
     {
-        qDebug() << "vaoLight is not created!";
         return;
     }
 
-    QOpenGLShaderProgram* program = glslPrograms[LIGHT_SHADING];
+    if(!vaoCube[currentShadingMode].isCreated())
+    {
+        qDebug() << "vaoOccluder is not created!";
+        return;
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    occluderModelMatrix.constData());
+    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
+                    occluderNormalMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    program->bind();
 
     /////////////////////////////////////////////////////////////////
     // set the uniform
-    glUniformBlockBinding(program->programId(), uniMatrices[LIGHT_SHADING],
-                          UBOBindingIndex[BINDING_MATRICES]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MATRICES],
-                     UBOMatrices);
-
-    glUniformBlockBinding(program->programId(), uniLight[LIGHT_SHADING],
-                          UBOBindingIndex[BINDING_LIGHT]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_LIGHT],
-                     UBOLight);
-    program->setUniformValue("pointDistance",
-                             (cameraPosition - cameraFocus).length());
+    setSurfaceFeatures(false);
 
-    vaoLight.bind();
-    glEnable (GL_POINT_SPRITE);
-    glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
-    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
-    glEnable (GL_DEPTH_TEST);
-    glDrawArrays(GL_POINTS, 0, 1);
-    glDisable(GL_POINT_SPRITE);
+    bindShadingMaterial(BINDING_OCCLUDER_MATERIAL, UBOOccluderMaterial);
 
-    vaoLight.release();
-    program->release();
+    /////////////////////////////////////////////////////////////////
+    // render the occluder
+    glDisable(GL_CULL_FACE);
+    vaoCube[currentShadingMode].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoCube[currentShadingMode].release();
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderRoom()
+void Renderer::renderProjectedOccluder()
 {
-    if(!vaoRoom[currentShadingMode].isCreated())
+    if(!vaoCube[PROJECTED_OBJECT_SHADING].isCreated())
     {
-        qDebug() << "vaoRoom is not created!";
+        qDebug() << "vaoOccluder is not created!";
         return;
     }
 
@@ -2585,424 +7282,605 @@ void Renderer::renderRoom()
     // flush the model and normal matrices
     glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
     glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    roomModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    roomNormalMatrix.constData());
+                    occluderModelMatrix.constData());
     glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
+
     /////////////////////////////////////////////////////////////////
-    // set the uniform
+    // render the cube
+    vaoCube[PROJECTED_OBJECT_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoCube[PROJECTED_OBJECT_SHADING].release();
+}
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderOccluder2DepthMap()
+{
+    if(!isSceneObjectVisible(SCENE_OBJECT_OCCLUDER))
+    {
+        return;
+    }
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_ROOM_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_ROOM_MATERIAL],
-                     UBORoomMaterial);
+    if(!vaoCube[SHADOW_MAP_SHADING].isCreated())
+    {
+        qDebug() << "vaoOccluder is not created!";
+        return;
+    }
 
     /////////////////////////////////////////////////////////////////
-    // render the floor
-    vaoRoom[currentShadingMode].bind();
+    // flush the model and normal matrices
+    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
+                    occluderModelMatrix.constData());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    // 4 sides
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
-    glDrawElements(GL_TRIANGLES, 24, GL_UNSIGNED_SHORT, 0);
-    glDisable(GL_CULL_FACE);
 
+    /////////////////////////////////////////////////////////////////
+    // render the cube
+    vaoCube[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
+    profiler.countDrawCall();
+    vaoCube[SHADOW_MAP_SHADING].release();
 
-    // floor
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_TRUE);
-    floorTextures[currentFloorTexture]->bind(0);
+}
 
-    if(enabledTextureAnisotropicFiltering)
+
+//------------------------------------------------------------------------------------------
+void Renderer::renderInstances(InstancedObject _object)
+{
+    Profiler::Scope profilerScope(&profiler, "renderInstances");
+
+    int numObjectInstances = numUploadedInstances[_object];
+
+    if(numObjectInstances == 0)
     {
-        GLfloat fLargest;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+        return;
     }
-    else
+
+    QOpenGLVertexArrayObject* vao;
+    QOpenGLTexture* texture;
+    UBOBinding materialBinding;
+    GLuint UBOMaterial;
+    int numIndices;
+    bool discardTransparentPixel = false;
+    bool vertexColor = false;
+
+    switch(_object)
     {
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
-    }
+    case INSTANCED_CUBE:
+        vao = &vaoCube[currentShadingMode];
+        texture = decalTexture;
+        materialBinding = BINDING_CUBE_MATERIAL;
+        UBOMaterial = UBOCubeMaterial;
+        numIndices = cubeObject->getNumIndices();
+        break;
 
+    case INSTANCED_MESH_OBJECT:
+        vao = &vaoMeshObject[currentShadingMode];
+        texture = NULL;
+        materialBinding = BINDING_MESH_OBJECT_MATERIAL;
+        UBOMaterial = UBOMeshObjectMaterial;
+        numIndices = objLoader->getNumIndices();
+        break;
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 24));
-    floorTextures[currentFloorTexture]->release();
+    case INSTANCED_BILLBOARD:
+        vao = &vaoBillboard[currentShadingMode];
+        texture = billboardTexture;
+        materialBinding = BINDING_BILLBOARD_OBJECT_MATERIAL;
+        UBOMaterial = UBOBillboardObjectMaterial;
+        numIndices = planeObject->getNumIndices();
+        discardTransparentPixel = true;
+        vertexColor = true;
+        break;
 
-    // ceiling
-    ceilingTexture->bind(0);
+    default:
+        return;
+    }
 
-    if(enabledTextureAnisotropicFiltering)
+    if(!vao->isCreated())
     {
-        GLfloat fLargest;
-        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+        qDebug() << "vao of instanced object is not created!";
+        return;
     }
-    else
+
+    /////////////////////////////////////////////////////////////////
+    // set the uniform
+    setInstancedDraw(true);
+    setSurfaceFeatures(texture != NULL, discardTransparentPixel, vertexColor);
+    bindShadingMaterial(materialBinding, UBOMaterial);
+
+    /////////////////////////////////////////////////////////////////
+    // render all instances at once
+    vao->bind();
+
+    if(texture)
     {
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
+        texture->bind(0);
     }
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort) * 30));
-    glDisable(GL_CULL_FACE);
-    ceilingTexture->release();
+    glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0,
+                            numObjectInstances);
+    profiler.countDrawCall();
 
-    vaoRoom[currentShadingMode].release();
-}
+    if(texture)
+    {
+        texture->release();
+    }
 
+    vao->release();
+    setInstancedDraw(false);
+}
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderRoom2DepthMap()
+void Renderer::renderProjectedInstances(InstancedObject _object)
 {
-    if(!vaoRoom[currentShadingMode].isCreated())
+    int numObjectInstances = numUploadedInstances[_object];
+
+    if(numObjectInstances == 0)
     {
-        qDebug() << "vaoRoom is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    roomModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    QOpenGLVertexArrayObject* vao;
+    int numIndices;
 
+    switch(_object)
+    {
+    case INSTANCED_CUBE:
+        vao = &vaoCube[PROJECTED_OBJECT_SHADING];
+        numIndices = cubeObject->getNumIndices();
+        break;
 
-    vaoRoom[SHADOW_MAP_SHADING].bind();
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    glDisable(GL_CULL_FACE);
-    vaoRoom[SHADOW_MAP_SHADING].release();
-}
+    case INSTANCED_MESH_OBJECT:
+        vao = &vaoMeshObject[PROJECTED_OBJECT_SHADING];
+        numIndices = objLoader->getNumIndices();
+        break;
+
+    default:
+        return;
+    }
+
+    if(!vao->isCreated())
+    {
+        qDebug() << "vao of instanced object is not created!";
+        return;
+    }
+
+    projectedShadowProgram->setUniformValue(uniInstancedDraw[PROJECTED_OBJECT_SHADING],
+                                            GL_TRUE);
+
+    vao->bind();
+    glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0,
+                            numObjectInstances);
+    profiler.countDrawCall();
+    vao->release();
 
+    projectedShadowProgram->setUniformValue(uniInstancedDraw[PROJECTED_OBJECT_SHADING],
+                                            GL_FALSE);
+}
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderCube()
+void Renderer::renderInstances2DepthMap(InstancedObject _object)
 {
-    if(!vaoCube[currentShadingMode].isCreated())
+    int numObjectInstances = numUploadedInstances[_object];
+
+    if(numObjectInstances == 0)
     {
-        qDebug() << "vaoCube is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    cubeModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    cubeNormalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    QOpenGLVertexArrayObject* vao;
+    QOpenGLTexture* texture = NULL;
+    int numIndices;
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_TRUE);
-    currentShadingProgram->setUniformValue("discardTransparentPixel", GL_FALSE);
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_CUBE_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_CUBE_MATERIAL],
-                     UBOCubeMaterial);
+    switch(_object)
+    {
+    case INSTANCED_CUBE:
+        vao = &vaoCube[SHADOW_MAP_SHADING];
+        numIndices = cubeObject->getNumIndices();
+        break;
 
-    /////////////////////////////////////////////////////////////////
-    // render the cube
-    vaoCube[currentShadingMode].bind();
-    decalTexture->bind(0);
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    decalTexture->release();
-    vaoCube[currentShadingMode].release();
-}
+    case INSTANCED_MESH_OBJECT:
+        vao = &vaoMeshObject[SHADOW_MAP_SHADING];
+        numIndices = objLoader->getNumIndices();
+        break;
+
+    case INSTANCED_BILLBOARD:
+        vao = &vaoBillboard[SHADOW_MAP_SHADING];
+        numIndices = planeObject->getNumIndices();
+        texture = billboardTexture;
+        break;
+
+    default:
+        return;
+    }
+
+    if(!vao->isCreated())
+    {
+        qDebug() << "vao of instanced object is not created!";
+        return;
+    }
+
+    shadowMapProgram->setUniformValue(uniInstancedDraw[SHADOW_MAP_SHADING], GL_TRUE);
+    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], texture != NULL);
+
+    vao->bind();
+
+    if(texture)
+    {
+        texture->bind(0);
+    }
 
-//------------------------------------------------------------------------------------------
-void Renderer::renderProjectedCube()
-{
-    if(!vaoCube[PROJECTED_OBJECT_SHADING].isCreated())
+    glDrawElementsInstanced(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0,
+                            numObjectInstances);
+    profiler.countDrawCall();
+
+    if(texture)
     {
-        qDebug() << "vaoCube is not created!";
-        return;
+        texture->release();
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    cubeModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    vao->release();
 
-    vaoCube[PROJECTED_OBJECT_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoCube[PROJECTED_OBJECT_SHADING].release();
+    shadowMapProgram->setUniformValue(uniInstancedDraw[SHADOW_MAP_SHADING], GL_FALSE);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderCube2DepthMap()
+// the objects of the main pass, either one by one or as indirect draw groups
+//------------------------------------------------------------------------------------------
+void Renderer::renderSceneObjects(bool _renderRoom)
 {
-    if(!vaoCube[SHADOW_MAP_SHADING].isCreated())
+    Profiler::Scope profilerScope(&profiler, "renderSceneObjects");
+
+    if(enabledMultiDrawIndirect)
     {
-        qDebug() << "vaoCube is not created!";
+        renderSceneObjectsIndirect(_renderRoom);
         return;
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    cubeModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if(enabledRenderQueue)
+    {
+        renderSceneObjectsSorted(_renderRoom);
+        return;
+    }
 
-    vaoCube[SHADOW_MAP_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoCube[SHADOW_MAP_SHADING].release();
+    if(_renderRoom)
+    {
+        renderRoom();
+    }
+
+    renderCube();
+    renderMeshObject();
+    renderOccluder();
+    renderBillboardObject();
+    renderInstances(INSTANCED_CUBE);
+    renderInstances(INSTANCED_MESH_OBJECT);
+    renderInstances(INSTANCED_BILLBOARD);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderMeshObject()
+// opaque objects go first, front to back within each material, then the enclosing room,
+// then the alpha tested billboards
+//------------------------------------------------------------------------------------------
+void Renderer::renderSceneObjectsSorted(bool _renderRoom)
 {
-    if(!vaoMeshObject[currentShadingMode].isCreated())
+    int program = currentShadingMode;
+
+    renderQueue.clear();
+
+    if(_renderRoom)
     {
-        qDebug() << "vaoMeshObject is not created!";
-        return;
+        renderQueue.push(RenderQueue::makeSortKey(LAYER_BACKGROUND, program,
+                                                  BINDING_ROOM_MATERIAL, 0.0f),
+                         DRAW_ITEM_ROOM);
     }
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    meshObjectModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    meshObjectNormalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    renderQueue.push(RenderQueue::makeSortKey(LAYER_OPAQUE, program, BINDING_CUBE_MATERIAL,
+                                              getViewDepth(cubeModelMatrix)),
+                     DRAW_ITEM_CUBE);
+    renderQueue.push(RenderQueue::makeSortKey(LAYER_OPAQUE, program,
+                                              BINDING_MESH_OBJECT_MATERIAL,
+                                              getViewDepth(meshObjectModelMatrix)),
+                     DRAW_ITEM_MESH_OBJECT);
+    renderQueue.push(RenderQueue::makeSortKey(LAYER_OPAQUE, program, BINDING_OCCLUDER_MATERIAL,
+                                              getViewDepth(occluderModelMatrix)),
+                     DRAW_ITEM_OCCLUDER);
+    renderQueue.push(RenderQueue::makeSortKey(LAYER_ALPHA_TESTED, program,
+                                              BINDING_BILLBOARD_OBJECT_MATERIAL,
+                                              getViewDepth(billboardObjectModelMatrix)),
+                     DRAW_ITEM_BILLBOARD);
+
+    if(numUploadedInstances[INSTANCED_CUBE] > 0)
+    {
+        renderQueue.push(RenderQueue::makeSortKey(LAYER_OPAQUE, program, BINDING_CUBE_MATERIAL,
+                                                  instanceGroupDepth[INSTANCED_CUBE]),
+                         DRAW_ITEM_CUBE_INSTANCES);
+    }
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
+    if(numUploadedInstances[INSTANCED_MESH_OBJECT] > 0)
+    {
+        renderQueue.push(RenderQueue::makeSortKey(LAYER_OPAQUE, program,
+                                                  BINDING_MESH_OBJECT_MATERIAL,
+                                                  instanceGroupDepth[INSTANCED_MESH_OBJECT]),
+                         DRAW_ITEM_MESH_OBJECT_INSTANCES);
+    }
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_MESH_OBJECT_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_MESH_OBJECT_MATERIAL],
-                     UBOMeshObjectMaterial);
+    if(numUploadedInstances[INSTANCED_BILLBOARD] > 0)
+    {
+        renderQueue.push(RenderQueue::makeSortKey(LAYER_ALPHA_TESTED, program,
+                                                  BINDING_BILLBOARD_OBJECT_MATERIAL,
+                                                  instanceGroupDepth[INSTANCED_BILLBOARD]),
+                         DRAW_ITEM_BILLBOARD_INSTANCES);
+    }
 
-    /////////////////////////////////////////////////////////////////
-    // render the mesh object
-    vaoMeshObject[currentShadingMode].bind();
-//    meshObjectTexture->bind(0);
-    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-//    meshObjectTexture->release();
-    vaoMeshObject[currentShadingMode].release();
+    renderQueue.sort();
+
+    for(int i = 0; i < renderQueue.size(); ++i)
+    {
+        switch(renderQueue.itemAt(i))
+        {
+        case DRAW_ITEM_ROOM:
+            renderRoom();
+            break;
+
+        case DRAW_ITEM_CUBE:
+            renderCube();
+            break;
+
+        case DRAW_ITEM_MESH_OBJECT:
+            renderMeshObject();
+            break;
 
+        case DRAW_ITEM_OCCLUDER:
+            renderOccluder();
+            break;
 
+        case DRAW_ITEM_BILLBOARD:
+            renderBillboardObject();
+            break;
+
+        case DRAW_ITEM_CUBE_INSTANCES:
+            renderInstances(INSTANCED_CUBE);
+            break;
+
+        case DRAW_ITEM_MESH_OBJECT_INSTANCES:
+            renderInstances(INSTANCED_MESH_OBJECT);
+            break;
+
+        case DRAW_ITEM_BILLBOARD_INSTANCES:
+            renderInstances(INSTANCED_BILLBOARD);
+            break;
+
+        default:
+            break;
+        }
+    }
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderProjectedMeshObject()
+void Renderer::renderProjectedObjects()
 {
-    if(!vaoMeshObject[PROJECTED_OBJECT_SHADING].isCreated())
+    Profiler::Scope profilerScope(&profiler, "renderProjectedObjects");
+
+    if(enabledMultiDrawIndirect)
     {
-        qDebug() << "vaoMeshObject is not created!";
+        renderProjectedObjectsIndirect();
         return;
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    meshObjectModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-    vaoMeshObject[PROJECTED_OBJECT_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoMeshObject[PROJECTED_OBJECT_SHADING].release();
+    renderProjectedCube();
+    renderProjectedMeshObject();
+    renderProjectedOccluder();
+    renderProjectedInstances(INSTANCED_CUBE);
+    renderProjectedInstances(INSTANCED_MESH_OBJECT);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderMeshObject2DepthMap()
+void Renderer::renderObjects2DepthMap()
 {
-    if(!vaoMeshObject[SHADOW_MAP_SHADING].isCreated())
+    Profiler::Scope profilerScope(&profiler, "renderObjects2DepthMap");
+
+    if(enabledMultiDrawIndirect)
     {
-        qDebug() << "vaoMeshObject is not created!";
+        renderObjects2DepthMapIndirect();
         return;
     }
 
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    meshObjectModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-    vaoMeshObject[SHADOW_MAP_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, objLoader->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoMeshObject[SHADOW_MAP_SHADING].release();
+    renderCube2DepthMap();
+    renderMeshObject2DepthMap();
+    renderOccluder2DepthMap();
+    renderBillboardObject2DepthMap();
+    renderInstances2DepthMap(INSTANCED_CUBE);
+    renderInstances2DepthMap(INSTANCED_MESH_OBJECT);
+    renderInstances2DepthMap(INSTANCED_BILLBOARD);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderBillboardObject()
+// one multi-draw per group of objects sharing material, texture and culling state
+//------------------------------------------------------------------------------------------
+void Renderer::renderSceneObjectsIndirect(bool _renderRoom)
 {
-    if(!vaoBillboard[currentShadingMode].isCreated())
+    if(!vaoScene[currentShadingMode].isCreated())
     {
-        qDebug() << "vaoBillboardObject is not created!";
+        qDebug() << "vaoScene is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // rotate the billboard to face the camera
-    QVector3D billboardPos = DEFAULT_BILLBOARD_OBJECT_POSITION;
-    QVector3D cameraDir = cameraPosition - cameraFocus;
-    float angle = atan2(billboardPos.x() - cameraDir.x(), billboardPos.z() - cameraDir.z()) ;
+    setInstancedDraw(true);
 
-    QMatrix4x4 rotationMatrix = billboardObjectModelMatrix;
-    rotationMatrix.rotate(angle * 180 / M_PI, QVector3D(0.0f, 1.0f, 0.0f));
-    rotationMatrix.rotate(90, QVector3D(1.0f, 0.0f, 0.0f));
-    QMatrix4x4 normalMatrix = -QMatrix4x4(rotationMatrix.normalMatrix());
+    vaoScene[currentShadingMode].bind();
+    profiler.countStateChange();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectDrawBuffer);
+
+    if(_renderRoom)
+    {
+        bindShadingMaterial(BINDING_ROOM_MATERIAL, UBORoomMaterial);
+
+        // 4 sides
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        setSurfaceFeatures(false);
+        multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_ROOM_WALLS);
+        glDisable(GL_CULL_FACE);
+
+        // floor
+        setSurfaceFeatures(true);
+        floorTextures[currentFloorTexture]->bind(0);
+        applyTextureAnisotropicFiltering();
+        multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_FLOOR);
+        floorTextures[currentFloorTexture]->release();
+
+        // ceiling
+        ceilingTexture->bind(0);
+        applyTextureAnisotropicFiltering();
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_CEILING);
+        glDisable(GL_CULL_FACE);
+        ceilingTexture->release();
+    }
 
     /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    rotationMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    normalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    // cubes
+    setSurfaceFeatures(true);
+    bindShadingMaterial(BINDING_CUBE_MATERIAL, UBOCubeMaterial);
+    decalTexture->bind(0);
+    multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_CUBES);
+    decalTexture->release();
 
     /////////////////////////////////////////////////////////////////
-    // set the uniform
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_TRUE);
-    currentShadingProgram->setUniformValue("discardTransparentPixel", GL_TRUE);
+    // mesh objects
+    setSurfaceFeatures(false);
+    bindShadingMaterial(BINDING_MESH_OBJECT_MATERIAL, UBOMeshObjectMaterial);
+    multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_MESH_OBJECTS);
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_BILLBOARD_OBJECT_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_BILLBOARD_OBJECT_MATERIAL],
-                     UBOBillboardObjectMaterial);
+    /////////////////////////////////////////////////////////////////
+    // occluder
+    bindShadingMaterial(BINDING_OCCLUDER_MATERIAL, UBOOccluderMaterial);
+    multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_OCCLUDER);
 
     /////////////////////////////////////////////////////////////////
-    // render the billboard
-    vaoBillboard[currentShadingMode].bind();
+    // billboards
+    setSurfaceFeatures(true, true, true);
+    bindShadingMaterial(BINDING_BILLBOARD_OBJECT_MATERIAL, UBOBillboardObjectMaterial);
     billboardTexture->bind(0);
-//    glEnable(GL_BLEND);
-//    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDrawElements(GL_TRIANGLES, planeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-//    glDisable(GL_BLEND);
+    multiDrawSceneGroup(currentShadingMode, DRAW_GROUP_BILLBOARDS);
     billboardTexture->release();
-    vaoBillboard[currentShadingMode].release();
-
 
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    vaoScene[currentShadingMode].release();
+    setInstancedDraw(false);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderBillboardObject2DepthMap()
+void Renderer::renderProjectedObjectsIndirect()
 {
-    if(!vaoBillboard[SHADOW_MAP_SHADING].isCreated())
+    if(!vaoScene[PROJECTED_OBJECT_SHADING].isCreated())
     {
-        qDebug() << "vaoBillboardObject is not created!";
+        qDebug() << "vaoScene is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // rotate the billboard to face the camera
-    QVector3D billboardPos = DEFAULT_BILLBOARD_OBJECT_POSITION;
-    QVector3D cameraDir = cameraPosition - cameraFocus;
-    float angle = atan2(billboardPos.x() - cameraDir.x(), billboardPos.z() - cameraDir.z()) ;
-
-    QMatrix4x4 rotationMatrix = billboardObjectModelMatrix;
-    rotationMatrix.rotate(angle * 180 / M_PI, QVector3D(0.0f, 1.0f, 0.0f));
-    rotationMatrix.rotate(90, QVector3D(1.0f, 0.0f, 0.0f));
-
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    rotationMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    projectedShadowProgram->setUniformValue(uniInstancedDraw[PROJECTED_OBJECT_SHADING],
+                                            GL_TRUE);
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], GL_TRUE);
+    vaoScene[PROJECTED_OBJECT_SHADING].bind();
+    profiler.countStateChange();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectDrawBuffer);
+    multiDrawSceneGroup(PROJECTED_OBJECT_SHADING, DRAW_GROUP_OPAQUE_CASTERS);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    vaoScene[PROJECTED_OBJECT_SHADING].release();
 
-    /////////////////////////////////////////////////////////////////
-    // render the billboard
-    vaoBillboard[SHADOW_MAP_SHADING].bind();
-    billboardTexture->bind(0);
-    glDrawElements(GL_TRIANGLES, planeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    billboardTexture->release();
-    vaoBillboard[SHADOW_MAP_SHADING].release();
+    projectedShadowProgram->setUniformValue(uniInstancedDraw[PROJECTED_OBJECT_SHADING],
+                                            GL_FALSE);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderOccluder()
+// all opaque casters go in one call, the alpha tested billboards in another
+//------------------------------------------------------------------------------------------
+void Renderer::renderObjects2DepthMapIndirect()
 {
-    if(!vaoCube[currentShadingMode].isCreated())
+    if(!vaoScene[SHADOW_MAP_SHADING].isCreated())
     {
-        qDebug() << "vaoOccluder is not created!";
+        qDebug() << "vaoScene is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    occluderModelMatrix.constData());
-    glBufferSubData(GL_UNIFORM_BUFFER, SIZE_OF_MAT4, SIZE_OF_MAT4,
-                    occluderNormalMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    shadowMapProgram->setUniformValue(uniInstancedDraw[SHADOW_MAP_SHADING], GL_TRUE);
 
+    vaoScene[SHADOW_MAP_SHADING].bind();
+    profiler.countStateChange();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectDrawBuffer);
 
-    /////////////////////////////////////////////////////////////////
-    // set the uniform
-    currentShadingProgram->setUniformValue(uniHasObjTexture[currentShadingMode], GL_FALSE);
+    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], GL_FALSE);
+    multiDrawSceneGroup(SHADOW_MAP_SHADING, DRAW_GROUP_OPAQUE_CASTERS);
 
-    glUniformBlockBinding(currentShadingProgram->programId(), uniMaterial[currentShadingMode],
-                          UBOBindingIndex[BINDING_OCCLUDER_MATERIAL]);
-    glBindBufferBase(GL_UNIFORM_BUFFER, UBOBindingIndex[BINDING_OCCLUDER_MATERIAL],
-                     UBOOccluderMaterial);
+    shadowMapProgram->setUniformValue(uniHasObjTexture[SHADOW_MAP_SHADING], GL_TRUE);
+    billboardTexture->bind(0);
+    multiDrawSceneGroup(SHADOW_MAP_SHADING, DRAW_GROUP_ALPHA_CASTERS);
+    billboardTexture->release();
 
-    /////////////////////////////////////////////////////////////////
-    // render the occluder
-    glDisable(GL_CULL_FACE);
-    vaoCube[currentShadingMode].bind();
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoCube[currentShadingMode].release();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    vaoScene[SHADOW_MAP_SHADING].release();
+
+    shadowMapProgram->setUniformValue(uniInstancedDraw[SHADOW_MAP_SHADING], GL_FALSE);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderProjectedOccluder()
+// the scene vao and the indirect buffer must be bound
+//------------------------------------------------------------------------------------------
+void Renderer::multiDrawSceneGroup(ShadingProgram _shadingMode, SceneDrawGroup _group)
 {
-    if(!vaoCube[PROJECTED_OBJECT_SHADING].isCreated())
+    int numCommands = drawGroupNumCommands[_group];
+    int firstCommand = drawGroupFirstCommand[_group];
+
+    if(numCommands == 0)
     {
-        qDebug() << "vaoOccluder is not created!";
         return;
     }
 
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    occluderModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
+    if(multiDrawFunctions)
+    {
+        multiDrawFunctions->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                                                        (GLvoid*)(firstCommand * sizeof(DrawElementsIndirectCommand)),
+                                                        numCommands, 0);
+        profiler.countDrawCall();
+        return;
+    }
 
     /////////////////////////////////////////////////////////////////
-    // render the cube
-    vaoCube[PROJECTED_OBJECT_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoCube[PROJECTED_OBJECT_SHADING].release();
+    // GL 4.0/4.1 have no base instance, so the instance attributes are
+    // re-pointed to the matrices of each command before drawing it
+    for(int i = firstCommand; i < firstCommand + numCommands; ++i)
+    {
+        const DrawElementsIndirectCommand& command = sceneDrawCommands.at(i);
+
+        initInstanceAttributes(_shadingMode, &vboSceneDrawData,
+                               command.baseInstance * SIZE_OF_INSTANCE_DATA);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_SHORT,
+                                          (GLvoid*)(command.firstIndex * sizeof(GLushort)),
+                                          command.instanceCount, command.baseVertex);
+        profiler.countDrawCall();
+    }
+
+    // the VAO keeps the attributes, they point at the first matrices again for the next user
+    initInstanceAttributes(_shadingMode, &vboSceneDrawData, 0);
 }
 
 //------------------------------------------------------------------------------------------
-void Renderer::renderOccluder2DepthMap()
+void Renderer::applyTextureAnisotropicFiltering()
 {
-    if(!vaoCube[SHADOW_MAP_SHADING].isCreated())
+    if(enabledTextureAnisotropicFiltering)
     {
-        qDebug() << "vaoOccluder is not created!";
-        return;
+        GLfloat fLargest;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &fLargest);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, fLargest);
+    }
+    else
+    {
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, 1.0f);
     }
-
-    /////////////////////////////////////////////////////////////////
-    // flush the model and normal matrices
-    glBindBuffer(GL_UNIFORM_BUFFER, UBOMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, SIZE_OF_MAT4,
-                    occluderModelMatrix.constData());
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-
-    /////////////////////////////////////////////////////////////////
-    // render the cube
-    vaoCube[SHADOW_MAP_SHADING].bind();
-    glDrawElements(GL_TRIANGLES, cubeObject->getNumIndices(), GL_UNSIGNED_SHORT, 0);
-    vaoCube[SHADOW_MAP_SHADING].release();
-
 }
-
@@ -12,11 +12,22 @@
 #include <QtGui>
 #include <QtWidgets>
 #include <QOpenGLFunctions_4_0_Core>
+#include <QOpenGLFunctions_4_3_Core>
 
 #include "unitcube.h"
 #include "unitsphere.h"
 #include "unitplane.h"
 #include "objloader.h"
+#include "frustumculler.h"
+#include "renderqueue.h"
+#include "shadowatlas.h"
+#include "profiler.h"
+#include "commandqueue.h"
+
+class RenderThread;
+class MeshLoader;
+class TextureStreamer;
+struct StreamedTexture;
 
 //------------------------------------------------------------------------------------------
 #define PRINT_ERROR(_errStr) \
@@ -42,11 +53,34 @@
     } \
 }
 
+// called from another thread than the render thread, the enclosing slot posts itself to
+// the command queue and returns, to be run again on the render thread before its next frame
+#define POST_TO_RENDER_THREAD(_call) \
+{ \
+    if(renderThread && !renderThread->isCurrentThread()) \
+    { \
+        commandQueue.post([=]() { _call; }); \
+        emit redrawRequested(); \
+        return; \
+    } \
+}
+
 #define SIZE_OF_MAT4 (4 * 4 *sizeof(GLfloat))
 #define SIZE_OF_VEC4 (4 * sizeof(GLfloat))
+#define SIZE_OF_INSTANCE_DATA (2 * SIZE_OF_MAT4)
 //------------------------------------------------------------------------------------------
 #define MOVING_INERTIA 0.9f
-#define DEPTH_TEXTURE_SIZE 1024
+#define UPDATE_TIME_STEP 10 // ms, the interval MOVING_INERTIA was tuned for
+#define MAX_NUM_UPDATE_STEPS 10
+#define SHADOW_ATLAS_SIZE 4096
+#define MIN_SHADOW_TILE_SIZE 256
+#define MAX_SHADOW_TILE_SIZE 2048
+#define DEFAULT_NUM_SHADOW_LIGHTS 1
+#define MAX_NUM_SHADOW_LIGHTS 4
+#define SIZE_OF_SHADOW_LIGHTS_BLOCK (MAX_NUM_SHADOW_LIGHTS * (SIZE_OF_MAT4 + 3 * SIZE_OF_VEC4) + \
+                                     SIZE_OF_VEC4)
+#define CAMERA_NEAR_PLANE 0.1f
+#define CAMERA_FAR_PLANE 1000.0f
 #define DEFAULT_CAMERA_POSITION QVector3D(0.0f,  6.5f, 25.0f)
 #define DEFAULT_CAMERA_FOCUS QVector3D(0.0f,  6.5f, 0.0f)
 #define DEFAULT_LIGHT_POSITION QVector4D(-2.0f, 12.0f, 6.0f, 1.0f)
@@ -54,22 +88,67 @@
 #define DEFAULT_MESH_OBJECT_POSITION QVector3D(4.5f, 3.0f, -3.0f)
 #define DEFAULT_BILLBOARD_OBJECT_POSITION QVector3D(-1.0f, 1.001f, 0.0f)
 #define DEFAULT_OCCLUDER_POSITION QVector3D(0.0f, 8.001f, 0.0f)
+#define DEFAULT_NUM_INSTANCES 0
+#define MAX_NUM_INSTANCES 4096
+#define MAX_NUM_DRAW_COMMANDS 64
+#define DEFAULT_NUM_POINT_LIGHTS 32
+#define MAX_NUM_POINT_LIGHTS 1024
+#define CLUSTER_TILE_SIZE 64
+#define NUM_CLUSTER_SLICES 16
+#define CLUSTER_TEXTURE_UNIT 5
+#define MAX_NUM_SHADOW_VOLUME_LIGHTS 16
+#define MAX_NUM_RECEIVER_PLANES 32
+#define MIN_MESH_RECEIVER_AREA 0.02f
+
+#ifndef GL_DEPTH_BOUNDS_TEST_EXT
+#define GL_DEPTH_BOUNDS_TEST_EXT 0x8890
+#endif
 
 struct Light
 {
     Light():
         position(10.0f, 10.0f, 10.0f, 1.0f),
         color(1.0f, 1.0f, 1.0f, 1.0f),
-        intensity(1.0f) {}
+        intensity(1.0f),
+        radius(0.0f) {}
 
     int getStructSize()
     {
-        return (2 * 4 + 1) * sizeof(GLfloat);
+        return (2 * 4 + 2) * sizeof(GLfloat);
     }
 
     QVector4D position;
     QVector4D color;
     GLfloat intensity;
+    GLfloat radius; // attenuation radius, 0 for no attenuation
+};
+
+// per-instance data of a light volume drawn by the deferred lighting pass
+struct PointLight
+{
+    PointLight():
+        positionRadius(0.0f, 0.0f, 0.0f, 1.0f),
+        colorIntensity(1.0f, 1.0f, 1.0f, 1.0f) {}
+
+    int getStructSize()
+    {
+        return (2 * 4) * sizeof(GLfloat);
+    }
+
+    QVector4D positionRadius;
+    QVector4D colorIntensity;
+};
+
+// a light casting shadows through its tile of the shadow atlas, the first one is the main light
+struct ShadowLight
+{
+    ShadowLight():
+        position(0.0f, 0.0f, 0.0f, 1.0f),
+        colorIntensity(1.0f, 1.0f, 1.0f, 1.0f) {}
+
+    QVector4D position;
+    QVector4D colorIntensity;
+    QMatrix4x4 shadowMatrix;
 };
 
 struct Material
@@ -106,6 +185,24 @@ struct Material
     GLfloat shininess;
 };
 
+// layout of a command in the GL_DRAW_INDIRECT_BUFFER, as defined by the GL specification
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// location of a mesh inside the shared scene vertex/index buffers
+struct SceneMeshRange
+{
+    GLint baseVertex;
+    GLuint firstIndex;
+    GLuint numIndices;
+};
+
 enum FloorTexture
 {
     CHECKERBOARD1 = 0,
@@ -153,6 +250,11 @@ enum ShadingProgram
     PROJECTED_OBJECT_SHADING,
     SHADOW_MAP_SHADING,
     SHADOW_VOLUME_SHADING,
+    OCCLUSION_QUERY_SHADING,
+    GBUFFER_SHADING,
+    DEFERRED_LIGHTING_SHADING,
+    POINT_LIGHT_SHADING,
+    RECEIVER_ID_SHADING,
     NUM_SHADING_MODE
 };
 
@@ -164,6 +266,102 @@ enum LightingMode
     NUM_LIGHTING_MODES
 };
 
+enum GBufferTarget
+{
+    GBUFFER_ALBEDO = 0,
+    GBUFFER_NORMAL,
+    GBUFFER_SPECULAR,
+    NUM_GBUFFER_TARGETS
+};
+
+enum ClusterTexture
+{
+    CLUSTER_POINT_LIGHTS = 0,
+    CLUSTER_GRID,
+    CLUSTER_LIGHT_INDICES,
+    NUM_CLUSTER_TEXTURES
+};
+
+enum InstancedObject
+{
+    INSTANCED_CUBE = 0,
+    INSTANCED_MESH_OBJECT,
+    INSTANCED_BILLBOARD,
+    NUM_INSTANCED_OBJECTS
+};
+
+enum SceneMesh
+{
+    SCENE_MESH_ROOM = 0,
+    SCENE_MESH_CUBE,
+    SCENE_MESH_OBJECT,
+    SCENE_MESH_BILLBOARD,
+    NUM_SCENE_MESHES
+};
+
+enum SceneObject
+{
+    SCENE_OBJECT_ROOM = 0,
+    SCENE_OBJECT_CUBE,
+    SCENE_OBJECT_MESH,
+    SCENE_OBJECT_OCCLUDER,
+    SCENE_OBJECT_BILLBOARD,
+    NUM_SCENE_OBJECTS
+};
+
+enum SceneDrawGroup
+{
+    DRAW_GROUP_ROOM_WALLS = 0,
+    DRAW_GROUP_FLOOR,
+    DRAW_GROUP_CEILING,
+    DRAW_GROUP_CUBES,
+    DRAW_GROUP_MESH_OBJECTS,
+    DRAW_GROUP_OCCLUDER,
+    DRAW_GROUP_BILLBOARDS,
+    DRAW_GROUP_OPAQUE_CASTERS,
+    DRAW_GROUP_ALPHA_CASTERS,
+    NUM_DRAW_GROUPS
+};
+
+enum RenderLayer
+{
+    LAYER_OPAQUE = 0,
+    LAYER_BACKGROUND,
+    LAYER_ALPHA_TESTED,
+    NUM_RENDER_LAYERS
+};
+
+enum SceneDrawItem
+{
+    DRAW_ITEM_ROOM = 0,
+    DRAW_ITEM_CUBE,
+    DRAW_ITEM_MESH_OBJECT,
+    DRAW_ITEM_OCCLUDER,
+    DRAW_ITEM_BILLBOARD,
+    DRAW_ITEM_CUBE_INSTANCES,
+    DRAW_ITEM_MESH_OBJECT_INSTANCES,
+    DRAW_ITEM_BILLBOARD_INSTANCES,
+    NUM_DRAW_ITEMS
+};
+
+enum CullingPass
+{
+    CAMERA_PASS = 0,
+    LIGHT_PASS,
+    NUM_CULLING_PASSES,
+    UNCULLED_PASS = NUM_CULLING_PASSES
+};
+
+// parts of a frame measured by the GPU timer queries
+enum TimedPass
+{
+    TIMED_SHADOW_PASS = 0,
+    TIMED_MAIN_PASS,
+    TIMED_STENCIL_PASS,
+    NUM_TIMED_PASSES,
+    NO_TIMED_PASS = NUM_TIMED_PASSES
+};
+
 enum UBOBinding
 {
     BINDING_MATRICES = 0,
@@ -173,9 +371,46 @@ enum UBOBinding
     BINDING_MESH_OBJECT_MATERIAL,
     BINDING_BILLBOARD_OBJECT_MATERIAL,
     BINDING_OCCLUDER_MATERIAL,
+    BINDING_SHADOW_LIGHTS,
     NUM_BINDING_POINTS
 };
 
+// draw state compiled as constants into the variants of the phong shading program
+enum ShadingFeature
+{
+    FEATURE_AMBIENT_LIGHT = 1 << 0,
+    FEATURE_DIRECT_LIGHT = 1 << 1,
+    FEATURE_DEPTH_TEXTURE = 1 << 2,
+    FEATURE_OBJ_TEXTURE = 1 << 3,
+    FEATURE_DISCARD_TRANSPARENT = 1 << 4,
+    FEATURE_VERTEX_COLOR = 1 << 5,
+    NUM_SHADING_FEATURES = 6
+};
+
+#define SURFACE_FEATURES (FEATURE_OBJ_TEXTURE | FEATURE_DISCARD_TRANSPARENT | FEATURE_VERTEX_COLOR)
+#define GENERIC_SHADING_VARIANT -1
+
+// a linked variant of the phong shading program with its own uniform locations
+struct ShadingVariant
+{
+    QOpenGLShaderProgram* program;
+    GLint uniMatrices;
+    GLint uniCameraPosition;
+    GLint uniLight;
+    GLint uniShadowLights;
+    GLint uniLightingMode;
+    GLint uniAmbientLight;
+    GLint uniMaterial;
+    GLint uniObjTexture;
+    GLint uniDepthTexture;
+    GLint uniHasObjTexture;
+    GLint uniHasDepthTexture;
+    GLint uniInstancedDraw;
+    GLint uniClusteredLighting;
+    GLint uniClusterGrid;
+    GLint uniClusterParameters;
+};
+
 
 //------------------------------------------------------------------------------------------
 class Renderer : public QOpenGLWidget, QOpenGLFunctions_4_0_Core// QOpenGLFunctions
@@ -212,61 +447,183 @@ public:
     void setCubeColor(float _r, float _g, float _b);
     void setMeshObjectColor(float _r, float _g, float _b);
     void setOccluderColor(float _r, float _g, float _b);
+    void setCamera(const QVector3D& _position, const QVector3D& _focus);
+    void setLightPosition(const QVector3D& _position);
+
+    void setOccluderPosition(const QVector3D& _position);
+
+    void initializeHeadless(QOpenGLContext* _context, const QSize& _frameSize);
+    void renderHeadlessFrame(QOpenGLFramebufferObject* _framebuffer);
+
+    void enableGPUTimers(bool _state);
+    void getGPUPassTimes(double* _passTimes);
+
+    void startTrace();
+    bool writeTrace(const QString& _fileName);
+
+    bool isAnimating();
+
+    void enableRenderThread();
+    qint64 getProfilerTime();
+    void uploadMeshObject(int _meshIndex, QSharedPointer<OBJLoader> _objLoader,
+                          const QVector<PlanarPatch>& _patches, qint64 _loadBegin,
+                          qint64 _loadEnd);
+    void uploadStreamedTexture(const StreamedTexture& _texture);
+    void requestFrame();
+    void renderThreadFrame();
 
 public slots:
     void enableDepthTest(bool _status);
     void enableZAxisRotation(bool _status);
     void enableTextureAnisotropicFiltering(bool _state);
     void enableShowShadowVolume(bool _state);
+    void enableBatchedProjectiveShadow(bool _state);
+    void enablePointLightShadowVolumes(bool _state);
+    void enableMultiDrawIndirect(bool _state);
+    void enableFrustumCulling(bool _state);
+    void enableOcclusionCulling(bool _state);
+    void enableDepthPrePass(bool _state);
+    void enableShadingVariants(bool _state);
+    void enableRenderQueue(bool _state);
+    void enableDeferredShading(bool _state);
+    void enableClusteredShading(bool _state);
+    void enableProfilerOverlay(bool _state);
+    void setNumShadowLights(int _numShadowLights);
     void setMouseTransformationTarget(MouseTransformationTarget _mouseTarget);
     void setShadowMethod(ShadowModes _shadowMode = NO_SHADOW);
     void setRoomSize(int _roomSize);
     void setAmbientLight(int _ambientLight);
     void setLightIntensity(int _intensity);
     void setMeshObject(int _objectIndex);
+    void setNumInstances(int _numInstances);
+    void setNumPointLights(int _numPointLights);
     void resetCameraPosition();
     void resetObjectPositions();
     void resetLightPosition();
 
+signals:
+    void cullingStatisticsChanged(int _numCameraDrawn, int _numCameraCulled,
+                                  int _numLightDrawn, int _numLightCulled);
+    void redrawRequested();
+    void meshObjectLoadProgress(int _percent);
+
 protected:
     void initializeGL();
     void resizeGL(int w, int h);
     void paintGL();
+    void paintEvent(QPaintEvent* _event);
 
     void mousePressEvent(QMouseEvent* _event);
     void mouseMoveEvent(QMouseEvent* _event);
     void mouseReleaseEvent(QMouseEvent* _event);
 
+private slots:
+    void grabContext();
+
 private:
     void checkOpenGLVersion();
+    bool hasGLContext();
+    QOpenGLContext* getGLContext();
+    GLuint getTargetFramebuffer();
+    void switchTimedPass(TimedPass _pass);
+    void renderProfilerOverlay();
+    bool hasInertia();
+    void updateSimulation();
+    void stepSimulation();
+    void startRenderThread();
+    void requestRedraw();
+    void dragMouse(const QVector2D& _mouseMoved, MouseButton _button, SpecialKey _key);
+    void addInertia(const QVector3D& _translation, float _zooming);
+    void toggleTrace();
     void initTestScene();
     void initScene();
     bool initShaderPrograms();
+    QOpenGLShaderProgram* requireShadingProgram(ShadingProgram _shadingMode);
     bool validateShaderPrograms(ShadingProgram _shadingMode);
+    bool addCachedShader(QOpenGLShaderProgram* _program, QOpenGLShader::ShaderType _type,
+                         const QString& _fileName, const QByteArray& _defines = QByteArray());
+    QByteArray getShadingFeatureDefines(int _features);
+    ShadingVariant getShadingVariantLocations(QOpenGLShaderProgram* _program);
+    const ShadingVariant& requireShadingVariant(int _features);
+    void useShadingVariant(const ShadingVariant& _variant);
+    bool usesShadingVariants();
+    void bindShadingProgram(int _lightingMode, bool _hasDepthTexture);
+    void applyShadingProgram();
+    void setSurfaceFeatures(bool _hasObjTexture, bool _discardTransparentPixel = false,
+                            bool _vertexColor = false);
+    void setInstancedDraw(bool _instancedDraw);
+    void bindShadingMaterial(UBOBinding _binding, GLuint _UBOMaterial);
     bool initProgram(ShadingProgram _shadingMode);
     bool initLightShadingProgram();
     bool initProjectedObjectShadingProgram();
     bool initShadowMapShadingProgram();
     bool initShadowVolumeShadingProgram();
+    bool initOcclusionQueryShadingProgram();
+    bool initGBufferShadingProgram();
+    bool initDeferredLightingShadingProgram();
+    bool initPointLightShadingProgram();
+    bool initReceiverIdShadingProgram();
+    void setGBufferSamplers(QOpenGLShaderProgram* _program);
 
     void initSharedBlockUniform();
     void initTexture();
+    QOpenGLTexture* createPlaceholderTexture();
+    void streamTexture(QOpenGLTexture** _texture, const QString& _fileName,
+                       bool _mirrored, bool _mipmapped);
     void initSceneMemory();
     void initLightObjectMemory();
     void initRoomMemory();
     void initCubeMemory();
     void initMeshObjectMemory();
+    void initMeshObjectBuffers();
     void initBillboardMemory();
     void initShadowVolumeMemory();
+    void initInstanceMemory();
+    void initPointLightMemory();
+    void initSceneGeometryMemory();
+    void initSceneDrawMemory();
     void initVertexArrayObjects();
+    void initShadingProgramVAOs(ShadingProgram _shadingMode);
     void initLightVAO();
     void initRoomVAO(ShadingProgram _shadingMode);
     void initCubeVAO(ShadingProgram _shadingMode);
     void initMeshObjectVAO(ShadingProgram _shadingMode);
     void initBillboardVAO(ShadingProgram _shadingMode);
     void initShadowVolumeVAO();
+    void initBoundingBoxVAO();
+    void initPointLightVAO();
+    void initReceiverIdVAO();
+    void initScreenQuadVAO();
+    void initSceneGeometryVAO(ShadingProgram _shadingMode);
+    void initInstanceAttributes(ShadingProgram _shadingMode, QOpenGLBuffer* _vboInstance,
+                                int _offset = 0);
     void initSceneMatrices();
+    void generateInstanceMatrices();
+    void updateBillboardInstanceMatrices();
+    void uploadInstanceMatrices(InstancedObject _object, CullingPass _pass = UNCULLED_PASS);
+    QMatrix4x4 getMeshObjectLocalMatrix(float* _lowestY);
+    QMatrix4x4 getBillboardModelMatrix();
+    void updateSceneDrawData();
+    void appendDrawCommand(SceneMesh _mesh, int _firstIndex, int _numIndices,
+                           int _numInstances, int _baseInstance);
     void initDepthBufferObject();
+    void initGBufferObject();
+    void initReceiverIdObject();
+    void initClusteredLighting();
+    void initClusteredLightingUniforms();
+    void initShadowLights();
+    void generatePointLights();
+    void buildLightClusters();
+    void updateLightClusters();
+    void applyClusteredLightingUniforms();
+    int getClusterSlice(float _viewDepth);
+    void updateShadowLights();
+    float getScreenCoverage(const QVector3D& _center, float _radius);
+    float getShadowReceiverCoverage(const QMatrix4x4& _shadowMatrix);
+    bool getScreenBounds(const QVector3D& _center, float _radius, QVector2D& _ndcMin,
+                         QVector2D& _ndcMax);
+    bool getLightScissor(const QVector4D& _positionRadius, QRect& _scissor,
+                         float& _depthMin, float& _depthMax);
 
     void updateCamera();
     void translateCamera();
@@ -285,17 +642,45 @@ private:
 
     void renderTestScene();
 
+    void cullScene();
+    void selectCullingPass(CullingPass _pass);
+    float getShadowSweepLength();
+    void cullOccludedObjects();
+    float getViewDepth(const QMatrix4x4& _modelMatrix);
+    void sortVisibleInstances(CullingPass _pass);
+    bool isOccluded(int _queryIndex);
+    QMatrix4x4 getOcclusionQueryBox(int _queryIndex, QVector3D* _boxMin, QVector3D* _boxMax);
+    void issueOcclusionQueries();
+    bool isSceneObjectVisible(SceneObject _object);
+
     void renderScene();
     void renderObjectWithoutShadow(int _lightingMode);
     void renderObjectWithProjectiveShadow();
+    void renderObjectWithBatchedProjectiveShadow();
+    void getReceiverPlanes(QVector4D* _planes);
+    int getReceiverPatches(PlanarPatch* _receivers);
+    void renderReceiverIds(const PlanarPatch* _receivers, int _numReceivers);
+    void addReceiverPatches(const QVector<PlanarPatch>& _patches,
+                            const QMatrix4x4& _modelMatrix, bool _flipped,
+                            QVector<PlanarPatch>* _receivers);
+
+    void renderDepthPrePass();
+    void endDepthPrePass();
 
     void generateShadowMap();
     void renderObjectWithShadowMap();
 
-    void generateShadowVolume();
+    void generateShadowVolume(const QVector3D& _lightPosition);
     void renderShadowVolume();
+    void renderShadowVolumeLight(const Light& _light);
     void renderObjectWithShadowVolume();
 
+    void renderObjectWithDeferredShading();
+    void renderGBuffer();
+    void bindGBufferTextures();
+    void renderDeferredLighting(bool _hasShadowMap);
+    void renderPointLights();
+
     void renderLight();
     void renderRoom();
     void renderRoom2DepthMap();
@@ -315,6 +700,21 @@ private:
     void renderProjectedOccluder();
     void renderOccluder2DepthMap();
 
+    void renderInstances(InstancedObject _object);
+    void renderProjectedInstances(InstancedObject _object);
+    void renderInstances2DepthMap(InstancedObject _object);
+
+    void renderSceneObjects(bool _renderRoom);
+    void renderProjectedObjects();
+    void renderObjects2DepthMap();
+
+    void renderSceneObjectsSorted(bool _renderRoom);
+    void renderSceneObjectsIndirect(bool _renderRoom);
+    void renderProjectedObjectsIndirect();
+    void renderObjects2DepthMapIndirect();
+    void multiDrawSceneGroup(ShadingProgram _shadingMode, SceneDrawGroup _group);
+    void applyTextureAnisotropicFiltering();
+
 
     QOpenGLTexture* floorTextures[NUM_FLOOR_TEXTURES];
     QOpenGLTexture* ceilingTexture;
@@ -323,18 +723,37 @@ private:
     QOpenGLTexture* decalTexture;
     UnitPlane* planeObject;
     UnitCube* cubeObject;
-    OBJLoader* objLoader;
+    UnitSphere* sphereObject;
+    QSharedPointer<OBJLoader> objLoader;
+    MeshLoader* meshLoader;
+    TextureStreamer* textureStreamer;
+    GLuint pboTextureUpload;
 
     QMap<ShadingProgram, QString> vertexShaderSourceMap;
     QMap<ShadingProgram, QString> fragmentShaderSourceMap;
+    QMap<ShadingProgram, QString> geometryShaderSourceMap;
     QOpenGLShaderProgram* glslPrograms[NUM_SHADING_MODE];
     QOpenGLShaderProgram* currentShadingProgram;
+
+    // the phong shading program is specialized for each set of features it is drawn
+    // with, the generic program branching on uniforms is kept as GENERIC_SHADING_VARIANT
+    QHash<int, ShadingVariant> shadingVariants;
+    int shadingFeatures;
+    UBOBinding currentMaterialBinding;
+    bool currentInstancedDraw;
+
     QOpenGLShaderProgram* projectedShadowProgram;
     QOpenGLShaderProgram* shadowMapProgram;
     QOpenGLShaderProgram* shadowVolumeProgram;
+    QOpenGLShaderProgram* occlusionQueryProgram;
+    QOpenGLShaderProgram* gBufferProgram;
+    QOpenGLShaderProgram* deferredLightingProgram;
+    QOpenGLShaderProgram* pointLightProgram;
+    QOpenGLShaderProgram* receiverIdProgram;
     GLuint UBOBindingIndex[NUM_BINDING_POINTS];
     GLuint UBOMatrices;
     GLuint UBOLight;
+    GLuint UBOShadowLights;
     GLuint UBORoomMaterial;
     GLuint UBOCubeMaterial;
     GLuint UBOMeshObjectMaterial;
@@ -343,10 +762,16 @@ private:
     GLint attrVertex[NUM_SHADING_MODE];
     GLint attrNormal[NUM_SHADING_MODE];
     GLint attrTexCoord[NUM_SHADING_MODE];
+    GLint attrInstanceModelMatrix[NUM_SHADING_MODE];
+    GLint attrInstanceNormalMatrix[NUM_SHADING_MODE];
+    GLint attrPointLightPosition;
+    GLint attrPointLightColor;
+    GLint attrReceiverId;
 
     GLint uniMatrices[NUM_SHADING_MODE];
     GLint uniCameraPosition[NUM_SHADING_MODE];
     GLint uniLight[NUM_SHADING_MODE];
+    GLint uniShadowLights[NUM_SHADING_MODE];
     GLint uniLightingMode[NUM_SHADING_MODE];
     GLint uniAmbientLight[NUM_SHADING_MODE];
     GLint uniMaterial[NUM_SHADING_MODE];
@@ -354,18 +779,59 @@ private:
     GLint uniDepthTexture[NUM_SHADING_MODE];
     GLint uniHasObjTexture[NUM_SHADING_MODE];
     GLint uniHasDepthTexture[NUM_SHADING_MODE];
+    GLint uniInstancedDraw[NUM_SHADING_MODE];
+    GLint uniInverseViewProjection[NUM_SHADING_MODE];
+    GLint uniClusteredLighting;
+    GLint uniClusterGrid;
+    GLint uniClusterParameters;
     GLint uniPlaneVector;
     GLint uniShadowIntensity;
+    GLint uniPlaneVectors;
+    GLint uniBatchedPlanes;
+    GLint uniNumReceivers;
+    GLint uniReceiverOrigins;
+    GLint uniReceiverAxesU;
+    GLint uniReceiverAxesV;
+    GLint uniBoxMatrix;
+    GLint uniCameraView;
 
     QOpenGLFramebufferObject* FBODepthMap;
     QOpenGLTexture* depthTexture;
 
+    // albedo, normal/shininess and specular targets written by the geometry pass of
+    // deferred shading, its depth is copied to the screen for the lighting passes
+    QOpenGLFramebufferObject* FBOGBuffer;
+    QOpenGLTexture* gBufferDepthTexture;
+    QSize gBufferSize;
+
+    // id of the visible receiver of each pixel, the batched projective shadows are only
+    // kept on the triangles of the receiver they are projected onto
+    QOpenGLFramebufferObject* FBOReceiverId;
+    QSize receiverIdSize;
+
+    // point lights of the forward phong shading, binned every frame into screen tiles x
+    // view depth slices; the clusters hold (offset, count) into the light index list
+    QVector<GLuint> clusterGrid;
+    QVector<GLuint> clusterLightIndices;
+    QVector<int> clusterLightBounds;
+    QOpenGLBuffer vboClusterGrid;
+    QOpenGLBuffer vboClusterLightIndices;
+    GLuint clusterTextures[NUM_CLUSTER_TEXTURES];
+    int numClusterTilesX;
+    int numClusterTilesY;
+    float clusterSliceScale;
+
     QOpenGLVertexArrayObject vaoLight;
     QOpenGLVertexArrayObject vaoShadowVolume;
+    QOpenGLVertexArrayObject vaoBoundingBox;
+    QOpenGLVertexArrayObject vaoPointLight;
+    QOpenGLVertexArrayObject vaoReceiverTriangles;
+    QOpenGLVertexArrayObject vaoScreenQuad;
     QOpenGLVertexArrayObject vaoRoom[NUM_SHADING_MODE];
     QOpenGLVertexArrayObject vaoCube[NUM_SHADING_MODE];
     QOpenGLVertexArrayObject vaoMeshObject[NUM_SHADING_MODE];
     QOpenGLVertexArrayObject vaoBillboard[NUM_SHADING_MODE];
+    QOpenGLVertexArrayObject vaoScene[NUM_SHADING_MODE];
     QOpenGLBuffer vboLight;
     QOpenGLBuffer vboRoom;
     QOpenGLBuffer vboCube;
@@ -376,6 +842,24 @@ private:
     QOpenGLBuffer iboRoom;
     QOpenGLBuffer iboCube;
     QOpenGLBuffer iboBillboard;
+    QOpenGLBuffer vboInstances[NUM_INSTANCED_OBJECTS];
+    QOpenGLBuffer vboPointLightVolume;
+    QOpenGLBuffer vboReceiverTriangles;
+    QOpenGLBuffer iboPointLightVolume;
+    QOpenGLBuffer vboPointLights;
+
+    // all static geometry in one vertex/index buffer pair, drawn by indirect commands
+    QOpenGLBuffer vboSceneGeometry;
+    QOpenGLBuffer iboSceneGeometry;
+    QOpenGLBuffer vboSceneDrawData;
+    GLuint indirectDrawBuffer;
+    SceneMeshRange sceneMeshRanges[NUM_SCENE_MESHES];
+    int numSceneVertices;
+    QVector<DrawElementsIndirectCommand> sceneDrawCommands;
+    int drawGroupFirstCommand[NUM_DRAW_GROUPS];
+    int drawGroupNumCommands[NUM_DRAW_GROUPS];
+    QOpenGLFunctions_4_3_Core* multiDrawFunctions;
+    void (QOPENGLF_APIENTRYP depthBoundsFunction)(GLdouble _zmin, GLdouble _zmax);
 
     Material roomMaterial;
     Material cubeMaterial;
@@ -383,6 +867,10 @@ private:
     Material billboardObjectMaterial;
     Material occluderMaterial;
     Light light;
+    QVector<ShadowLight> shadowLights;
+    int numShadowLights;
+    ShadowAtlas shadowAtlas;
+    QVector<PointLight> pointLights;
 
 
     // data for shadow volume construction
@@ -405,6 +893,61 @@ private:
     QMatrix4x4 occluderModelMatrix;
     QMatrix4x4 occluderNormalMatrix;
 
+    // per-instance data, drawn with one instanced call per object type
+    QVector<QVector3D> instancePositions[NUM_INSTANCED_OBJECTS];
+    QVector<QMatrix4x4> instanceModelMatrices[NUM_INSTANCED_OBJECTS];
+    QVector<QMatrix4x4> instanceNormalMatrices[NUM_INSTANCED_OBJECTS];
+    int numUploadedInstances[NUM_INSTANCED_OBJECTS];
+    int instanceUploadPass[NUM_INSTANCED_OBJECTS];
+
+    // visibility of the objects against the camera and the light frustum
+    FrustumCuller frustumCuller;
+    bool sceneObjectVisible[NUM_CULLING_PASSES][NUM_SCENE_OBJECTS];
+
+    // flat parts of the objects in object space, receiving the batched projective shadows
+    QVector<PlanarPatch> cubePatches;
+    QVector<PlanarPatch> meshObjectPatches;
+    FrustumCuller receiverCuller;
+    QVector<int> visibleInstances[NUM_CULLING_PASSES][NUM_INSTANCED_OBJECTS];
+    // all instances front to back, when the render queue is used without frustum culling
+    QVector<int> unculledInstances[NUM_INSTANCED_OBJECTS];
+    int numDrawnObjects[NUM_CULLING_PASSES];
+    int numCulledObjects[NUM_CULLING_PASSES];
+    int currentCullingPass;
+
+    // bounding box occlusion queries issued after the camera pass, their results cull
+    // the objects of the next frame; the queries are indexed like the scene draw data
+    QVector<GLuint> occlusionQueries;
+    QVector<char> occlusionQueryIssued;
+    QVector<int> issuedOcclusionQueries;
+    QVector<int> occlusionQueryCandidates;
+    int numOccludedObjects;
+
+    // set when the frames are drawn by the headless renderer instead of the widget
+    QOpenGLContext* headlessContext;
+    QOpenGLFramebufferObject* headlessFramebuffer;
+
+    // draws the frames of the widget when started, fed with the slot calls of the other
+    // threads through the command queue; isAnimating() reads the state of the last frame
+    bool enabledRenderThread;
+    RenderThread* renderThread;
+    CommandQueue commandQueue;
+    QAtomicInt animating;
+
+    // scope timings and counters of the frames, shown by the overlay
+    Profiler profiler;
+
+    // GL_TIME_ELAPSED queries of the last frame, one per switch between timed passes
+    bool enabledGPUTimers;
+    QVector<GLuint> timerQueries;
+    QVector<int> timerQueryPasses;
+    int numIssuedTimerQueries;
+    int currentTimedPass;
+
+    // draws of the main pass, sorted by state and depth every frame
+    RenderQueue renderQueue;
+    float instanceGroupDepth[NUM_INSTANCED_OBJECTS];
+
     QMatrix4x4 lightViewMatrix;
     QMatrix4x4 lightProjectionMatrix;
     QMatrix4x4 shadowMatrix;
@@ -415,6 +958,17 @@ private:
     QVector3D cameraFocus;
     QVector3D cameraUpDirection;
 
+    // the camera members above are interpolated between the last two update steps for
+    // rendering, the stepped camera is kept here
+    QElapsedTimer updateTimer;
+    qint64 updateTimeAccumulator;
+    QVector3D previousCameraPosition;
+    QVector3D previousCameraFocus;
+    QVector3D previousCameraUpDirection;
+    QVector3D steppedCameraPosition;
+    QVector3D steppedCameraFocus;
+    QVector3D steppedCameraUpDirection;
+
     QVector2D lastMousePos;
     QVector3D translation;
     QVector3D translationLag;
@@ -426,15 +980,30 @@ private:
 
     ShadingProgram currentShadingMode;
     FloorTexture currentFloorTexture;
-    MeshObject currentMeshObject;
+    QAtomicInt currentMeshObject; // MeshObject
     MouseTransformationTarget currentMouseTransTarget;
     ShadowModes currentShadowMode;
     float ambientLight;
     float roomSize;
+    int numInstances;
+    int numPointLights;
+    float instanceScale;
     bool enabledZAxisRotation;
     bool enabledTextureAnisotropicFiltering;
 //    bool enabledShadowMap;
     bool enabledShowShadowVolume;
+    bool enabledBatchedProjectiveShadow;
+    bool enabledPointLightShadowVolumes;
+    bool enabledMultiDrawIndirect;
+    bool enabledFrustumCulling;
+    bool enabledOcclusionCulling;
+    bool enabledDepthPrePass;
+    bool enabledShadingVariants;
+    bool enabledRenderQueue;
+    bool enabledDeferredShading;
+    bool enabledClusteredShading;
+    bool enabledProfilerOverlay;
+    GLint depthFuncBeforePrePass;
 
     bool initializedScene;
     bool initializedTestScene;
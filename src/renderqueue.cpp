@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "renderqueue.h"
+
+#include <string.h>
+
+RenderQueue::RenderQueue()
+{
+}
+
+//------------------------------------------------------------------------------------------
+// layer: 4 bits, program: 4 bits, material: 8 bits, depth: 32 bits, the lowest 16 bits
+// are left free
+//------------------------------------------------------------------------------------------
+quint64 RenderQueue::makeSortKey(int _layer, int _program, int _material, float _depth)
+{
+    return ((quint64)(_layer & 0xF) << 60) |
+           ((quint64)(_program & 0xF) << 56) |
+           ((quint64)(_material & 0xFF) << 48) |
+           (makeDepthKey(_depth) << 16);
+}
+
+//------------------------------------------------------------------------------------------
+// the bits of a non negative float compare in the same order as the float itself
+//------------------------------------------------------------------------------------------
+quint64 RenderQueue::makeDepthKey(float _depth)
+{
+    float depth = (_depth > 0.0f) ? _depth : 0.0f;
+    quint32 depthBits;
+    memcpy(&depthBits, &depth, sizeof(quint32));
+
+    return (quint64)depthBits;
+}
+
+//------------------------------------------------------------------------------------------
+void RenderQueue::clear()
+{
+    sortKeys.clear();
+    items.clear();
+}
+
+//------------------------------------------------------------------------------------------
+void RenderQueue::push(quint64 _sortKey, int _item)
+{
+    sortKeys.append(_sortKey);
+    items.append(_item);
+}
+
+//------------------------------------------------------------------------------------------
+// stable LSD radix sort, 8 bits per pass; the passes over bytes that are equal for all
+// keys are skipped, so short keys (e.g. depth only) cost only as many passes as they need
+//------------------------------------------------------------------------------------------
+void RenderQueue::sort()
+{
+    int numItems = sortKeys.size();
+
+    if(numItems < 2)
+    {
+        return;
+    }
+
+    tmpSortKeys.resize(numItems);
+    tmpItems.resize(numItems);
+
+    for(int shift = 0; shift < 64; shift += 8)
+    {
+        int counts[256];
+        memset(counts, 0, sizeof(counts));
+
+        for(int i = 0; i < numItems; ++i)
+        {
+            ++counts[(sortKeys[i] >> shift) & 0xFF];
+        }
+
+        if(counts[(sortKeys[0] >> shift) & 0xFF] == numItems)
+        {
+            continue;
+        }
+
+        int offset = 0;
+
+        for(int i = 0; i < 256; ++i)
+        {
+            int count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+
+        for(int i = 0; i < numItems; ++i)
+        {
+            int position = counts[(sortKeys[i] >> shift) & 0xFF]++;
+            tmpSortKeys[position] = sortKeys[i];
+            tmpItems[position] = items[i];
+        }
+
+        sortKeys.swap(tmpSortKeys);
+        items.swap(tmpItems);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+int RenderQueue::size()
+{
+    return items.size();
+}
+
+//------------------------------------------------------------------------------------------
+int RenderQueue::itemAt(int _index)
+{
+    return items[_index];
+}
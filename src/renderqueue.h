@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <QVector>
+
+//------------------------------------------------------------------------------------------
+// A list of draw items ordered by 64-bit sort keys. The key holds, from the most to the
+// least significant bits, the render layer, the program, the material and the view depth,
+// so that sorting groups the draws by state and orders each group front to back.
+//------------------------------------------------------------------------------------------
+class RenderQueue
+{
+public:
+    RenderQueue();
+
+    static quint64 makeSortKey(int _layer, int _program, int _material, float _depth);
+    static quint64 makeDepthKey(float _depth);
+
+    void clear();
+    void push(quint64 _sortKey, int _item);
+    void sort();
+
+    int size();
+    int itemAt(int _index);
+
+private:
+    QVector<quint64> sortKeys;
+    QVector<int> items;
+    QVector<quint64> tmpSortKeys;
+    QVector<int> tmpItems;
+};
+
+#endif // RENDERQUEUE_H
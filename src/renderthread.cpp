@@ -0,0 +1,143 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "renderthread.h"
+#include "renderer.h"
+
+#include <QGuiApplication>
+
+//------------------------------------------------------------------------------------------
+RenderThread::RenderThread(Renderer* _renderer):
+    renderer(_renderer),
+    context(NULL),
+    framePending(0),
+    exiting(false)
+{
+    thread.setObjectName("RenderThread");
+}
+
+//------------------------------------------------------------------------------------------
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------------------
+void RenderThread::start(QOpenGLContext* _context)
+{
+    context.storeRelease(_context);
+    moveToThread(&thread);
+    thread.start();
+}
+
+//------------------------------------------------------------------------------------------
+// a frame waiting for the context is woken up and returns without rendering
+//------------------------------------------------------------------------------------------
+void RenderThread::stop()
+{
+    if(!thread.isRunning())
+    {
+        return;
+    }
+
+    {
+        QMutexLocker lock(&grabMutex);
+        exiting = true;
+        grabCondition.wakeAll();
+    }
+
+    thread.quit();
+    thread.wait();
+}
+
+//------------------------------------------------------------------------------------------
+bool RenderThread::isCurrentThread()
+{
+    return QThread::currentThread() == &thread;
+}
+
+//------------------------------------------------------------------------------------------
+// requests while a frame is pending are merged into it
+//------------------------------------------------------------------------------------------
+void RenderThread::requestFrame()
+{
+    if(framePending.testAndSetOrdered(0, 1))
+    {
+        QMetaObject::invokeMethod(this, "renderFrame", Qt::QueuedConnection);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// called on the GUI thread, which owns the context between the frames
+//------------------------------------------------------------------------------------------
+void RenderThread::handOverContext()
+{
+    QMutexLocker renderLock(&renderMutex);
+    QMutexLocker grabLock(&grabMutex);
+
+    if(exiting)
+    {
+        return;
+    }
+
+    // a context can only be current on one thread
+    QOpenGLContext* renderContext = context.loadAcquire();
+
+    if(QOpenGLContext::currentContext() == renderContext)
+    {
+        renderContext->doneCurrent();
+    }
+
+    renderContext->moveToThread(&thread);
+    grabCondition.wakeAll();
+}
+
+//------------------------------------------------------------------------------------------
+void RenderThread::lockRenderer()
+{
+    renderMutex.lock();
+}
+
+//------------------------------------------------------------------------------------------
+void RenderThread::unlockRenderer()
+{
+    renderMutex.unlock();
+}
+
+//------------------------------------------------------------------------------------------
+void RenderThread::renderFrame()
+{
+    framePending.storeRelease(0);
+
+    QOpenGLContext* renderContext = context.loadAcquire();
+
+    grabMutex.lock();
+
+    if(exiting)
+    {
+        grabMutex.unlock();
+        return;
+    }
+
+    emit contextWanted();
+    grabCondition.wait(&grabMutex);
+
+    QMutexLocker lock(&renderMutex);
+    grabMutex.unlock();
+
+    // woken up by stop()
+    if(renderContext->thread() != &thread)
+    {
+        return;
+    }
+
+    renderer->renderThreadFrame();
+
+    renderContext->moveToThread(qGuiApp->thread());
+    emit frameReady();
+}
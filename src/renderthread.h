@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QOpenGLContext>
+
+class Renderer;
+
+//------------------------------------------------------------------------------------------
+// Renders the frames of a Renderer widget on a thread of its own. The context of the
+// widget is created on the GUI thread; for every frame it is handed over to this thread
+// while the GUI thread is not composing or resizing, the frame is drawn into the widget
+// framebuffer, and the context is handed back before the widget is updated, which only
+// composes the finished framebuffer. Changes of the scene reach this thread through the
+// command queue of the renderer, see POST_TO_RENDER_THREAD.
+//------------------------------------------------------------------------------------------
+class RenderThread : public QObject
+{
+    Q_OBJECT
+
+public:
+    RenderThread(Renderer* _renderer);
+    ~RenderThread();
+
+    void start(QOpenGLContext* _context);
+    void stop();
+    bool isCurrentThread();
+
+    void requestFrame();
+    void handOverContext();
+
+public slots:
+    void lockRenderer();
+    void unlockRenderer();
+
+signals:
+    void contextWanted();
+    void frameReady();
+
+private slots:
+    void renderFrame();
+
+private:
+    Renderer* renderer;
+    QThread thread;
+    QAtomicPointer<QOpenGLContext> context;
+    QAtomicInt framePending;
+
+    // held while a frame is drawn, and by the GUI thread while it composes or resizes
+    QMutex renderMutex;
+
+    // the handover of the context, exiting is guarded by grabMutex
+    QMutex grabMutex;
+    QWaitCondition grabCondition;
+    bool exiting;
+};
+
+#endif // RENDERTHREAD_H
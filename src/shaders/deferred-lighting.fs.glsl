@@ -0,0 +1,144 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// fragment shader, fullscreen lighting pass of deferred shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Matrices
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 shadowMatrix;
+};
+
+layout(std140) uniform Light
+{
+    vec4 position;
+    vec4 color;
+    float intensity;
+} light;
+
+// shadow casting lights, the first one is the main light, see Renderer::updateShadowLights
+// the arrays hold MAX_NUM_SHADOW_LIGHTS entries
+layout(std140) uniform ShadowLights
+{
+    mat4 shadowMatrix[4];
+    vec4 position[4];
+    vec4 colorIntensity[4];
+    vec4 atlasTile[4];
+    int numLights;
+} shadowLights;
+
+uniform sampler2D albedoTex;
+uniform sampler2D normalTex;
+uniform sampler2D specularTex;
+uniform sampler2D sceneDepthTex;
+uniform sampler2DShadow depthTex;
+uniform bool hasDepthTex;
+uniform float ambientLight;
+uniform vec3 cameraPosition;
+uniform mat4 inverseViewProjectionMatrix;
+
+//------------------------------------------------------------------------------------------
+// const
+const mat4 scaleMatrix = mat4(vec4(0.5f, 0.0f, 0.0f, 0.0f),
+                              vec4(0.0f, 0.5f, 0.0f, 0.0f),
+                              vec4(0.0f, 0.0f, 0.5f, 0.0f),
+                              vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+//------------------------------------------------------------------------------------------
+// out variables
+out vec4 fragColor;
+
+//------------------------------------------------------------------------------------------
+// The shadow coordinate is in the [0, 1] texture space of the light, it is moved into the
+// tile of the light in the shadow atlas; a light without a tile casts no shadow. The
+// lookup is kept half a texel inside the tile, so filtering never reads a neighbour tile
+//------------------------------------------------------------------------------------------
+float lookupShadowAtlas(int _light, vec4 _shadowCoord)
+{
+    vec4 tile = shadowLights.atlasTile[_light];
+    vec3 coord = _shadowCoord.xyz / _shadowCoord.w;
+
+    if(tile.w == 0.0f || _shadowCoord.w <= 0.0f ||
+       any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+
+    vec2 halfTexel = 0.5f / vec2(textureSize(depthTex, 0));
+    vec2 atlasCoord = clamp(tile.xy + coord.xy * tile.z, tile.xy + halfTexel,
+                            tile.xy + vec2(tile.z) - halfTexel);
+
+    return texture(depthTex, vec3(atlasCoord, coord.z));
+}
+
+//------------------------------------------------------------------------------------------
+// The other shadow casting lights, each one shadowed through its own atlas tile
+//------------------------------------------------------------------------------------------
+vec3 computeShadowLights(vec3 _worldCoord, vec3 _surfaceColor, vec3 _specularColor,
+                         float _shininess, vec3 _normal, vec3 _viewDir)
+{
+    vec3 color = vec3(0.0f);
+
+    for(int i = 1; i < shadowLights.numLights; ++i)
+    {
+        vec3 lightDir = normalize(shadowLights.position[i].xyz - _worldCoord);
+        vec3 halfDir = normalize(lightDir + _viewDir);
+
+        vec3 diffuse = vec3(max(dot(_normal, lightDir), 0.0f)) * _surfaceColor;
+        vec3 specular = pow(max(dot(halfDir, _normal), 0.0f), _shininess) * _specularColor;
+        float isNoShadow = lookupShadowAtlas(i, shadowLights.shadowMatrix[i] *
+                                                vec4(_worldCoord, 1.0f));
+        vec4 colorIntensity = shadowLights.colorIntensity[i];
+
+        color += isNoShadow * colorIntensity.w * colorIntensity.xyz * (diffuse + specular);
+    }
+
+    return color;
+}
+
+//------------------------------------------------------------------------------------------
+// Ambient and main light, evaluated once per pixel; the background keeps the clear color
+//------------------------------------------------------------------------------------------
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(sceneDepthTex, pixel, 0).x;
+
+    if(depth == 1.0f) discard;
+
+    vec2 screenCoord = gl_FragCoord.xy / vec2(textureSize(sceneDepthTex, 0));
+    vec4 worldCoord = inverseViewProjectionMatrix * vec4(vec3(screenCoord, depth) * 2.0f - 1.0f,
+                                                         1.0f);
+    worldCoord /= worldCoord.w;
+
+    vec3 surfaceColor = texelFetch(albedoTex, pixel, 0).xyz;
+    vec4 normalShininess = texelFetch(normalTex, pixel, 0);
+    vec3 specularColor = texelFetch(specularTex, pixel, 0).xyz;
+
+    vec3 normal = normalize(normalShininess.xyz);
+    vec3 lightDir = normalize(vec3(light.position) - vec3(worldCoord));
+    vec3 viewDir = normalize(cameraPosition - vec3(worldCoord));
+    vec3 halfDir = normalize(lightDir + viewDir);
+
+    vec3 ambient = ambientLight * surfaceColor;
+    vec3 diffuse = vec3(max(dot(normal, lightDir), 0.0f)) * surfaceColor;
+    vec3 specular = pow(max(dot(halfDir, normal), 0.0f), normalShininess.w) * specularColor;
+    vec3 shadowLightsColor = vec3(0.0f);
+    float isNoShadow = 1.0f;
+
+    if(hasDepthTex)
+    {
+        isNoShadow = lookupShadowAtlas(0, scaleMatrix * shadowMatrix * worldCoord);
+        shadowLightsColor = computeShadowLights(vec3(worldCoord), surfaceColor, specularColor,
+                                                normalShininess.w, normal, viewDir);
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    fragColor = vec4(ambient + isNoShadow * light.intensity * (diffuse + specular) +
+                     shadowLightsColor, 1.0f);
+}
@@ -0,0 +1,16 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// vertex shader, fullscreen lighting pass of deferred shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// A single triangle covering the screen, generated from the vertex id
+//------------------------------------------------------------------------------------------
+void main()
+{
+    vec2 coord = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    gl_Position = vec4(2.0f * coord - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,67 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// fragment shader, geometry pass of deferred shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Material
+{
+    vec4 diffuseColor;
+    vec4 specularColor;
+    float reflection;
+    float shininess;
+} material;
+
+uniform sampler2D objTex;
+uniform bool hasObjTex;
+uniform bool discardTransparentPixel;
+
+//------------------------------------------------------------------------------------------
+// in variables
+in VS_OUT
+{
+    vec3 f_color;
+    vec3 f_normal;
+    vec2 f_texCoord;
+};
+
+//------------------------------------------------------------------------------------------
+// out variables, one per G-buffer target
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normalShininess;
+layout(location = 2) out vec4 specular;
+
+//------------------------------------------------------------------------------------------
+// The surface color is resolved the same way as in the phong shader,
+// the lighting is left to the lighting passes
+//------------------------------------------------------------------------------------------
+void main()
+{
+    float alpha = 0.0f;
+    vec3 surfaceColor = vec3(0.0f);
+
+    if(hasObjTex)
+    {
+        vec4 texVal = texture(objTex, f_texCoord);
+        if(discardTransparentPixel && (texVal.w < 0.5f)) discard;
+
+        surfaceColor = texVal.xyz;
+        alpha = texVal.w;
+    }
+
+    if(material.diffuseColor.x > -0.001f)
+    {
+        surfaceColor = mix(vec3(material.diffuseColor), surfaceColor, alpha);
+    }
+    else
+    {
+        surfaceColor = mix(f_color, surfaceColor, alpha);
+    }
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    albedo = vec4(surfaceColor, 1.0f);
+    normalShininess = vec4(normalize(f_normal), material.shininess);
+    specular = vec4(vec3(material.specularColor), 1.0f);
+}
@@ -0,0 +1,59 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// vertex shader, geometry pass of deferred shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Matrices
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 shadowMatrix;
+};
+
+uniform bool instancedDraw;
+
+//------------------------------------------------------------------------------------------
+// in variables
+in vec3 v_coord;
+in vec3 v_color;
+in vec3 v_normal;
+in vec2 v_texCoord;
+in mat4 v_instanceModelMatrix;
+in mat4 v_instanceNormalMatrix;
+
+//------------------------------------------------------------------------------------------
+// out variables
+out VS_OUT
+{
+    vec3 f_color;
+    vec3 f_normal;
+    vec2 f_texCoord;
+};
+
+//------------------------------------------------------------------------------------------
+// If it is drawn by instancing, the model and normal matrices come from the instance buffer
+//------------------------------------------------------------------------------------------
+void main()
+{
+    mat4 objModelMatrix = modelMatrix;
+    mat4 objNormalMatrix = normalMatrix;
+
+    if(instancedDraw)
+    {
+        objModelMatrix = v_instanceModelMatrix;
+        objNormalMatrix = v_instanceNormalMatrix;
+    }
+
+    vec4 worldCoord = objModelMatrix * vec4(v_coord, 1.0);
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    f_color = v_color;
+    f_normal = mat3(objNormalMatrix) * v_normal;
+    f_texCoord = v_texCoord;
+
+    gl_Position = viewProjectionMatrix * worldCoord;
+}
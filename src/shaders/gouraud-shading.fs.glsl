@@ -13,6 +13,17 @@ layout(std140) uniform Material
     float shininess;
 } material;
 
+// shadow casting lights, the first one is the main light, see Renderer::updateShadowLights
+// the arrays hold MAX_NUM_SHADOW_LIGHTS entries
+layout(std140) uniform ShadowLights
+{
+    mat4 shadowMatrix[4];
+    vec4 position[4];
+    vec4 colorIntensity[4];
+    vec4 atlasTile[4];
+    int numLights;
+} shadowLights;
+
 uniform float ambientLight;
 uniform sampler2DShadow depthTex;
 uniform sampler2D objTex;
@@ -36,6 +47,29 @@ in VS_OUT
 // out variables
 out vec4 fragColor;
 
+//------------------------------------------------------------------------------------------
+// The shadow coordinate is in the [0, 1] texture space of the light, it is moved into the
+// tile of the light in the shadow atlas; a light without a tile casts no shadow. The
+// lookup is kept half a texel inside the tile, so filtering never reads a neighbour tile
+//------------------------------------------------------------------------------------------
+float lookupShadowAtlas(int _light, vec4 _shadowCoord)
+{
+    vec4 tile = shadowLights.atlasTile[_light];
+    vec3 coord = _shadowCoord.xyz / _shadowCoord.w;
+
+    if(tile.w == 0.0f || _shadowCoord.w <= 0.0f ||
+       any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+
+    vec2 halfTexel = 0.5f / vec2(textureSize(depthTex, 0));
+    vec2 atlasCoord = clamp(tile.xy + coord.xy * tile.z, tile.xy + halfTexel,
+                            tile.xy + vec2(tile.z) - halfTexel);
+
+    return texture(depthTex, vec3(atlasCoord, coord.z));
+}
+
 //------------------------------------------------------------------------------------------
 // If an object uses texture, it must set "GL_TRUE" to hasObjTex
 //------------------------------------------------------------------------------------------
@@ -64,10 +98,7 @@ void main()
     float isNoShadow = 1.0f;
     if(hasDepthTex)
     {
-        if(any(lessThan(vec3(f_shadowCoord), vec3(0.0))) )
-            isNoShadow = 1.0f;
-        else
-            isNoShadow = textureProj(depthTex, f_shadowCoord);
+        isNoShadow = lookupShadowAtlas(0, f_shadowCoord);
     }
 
     /////////////////////////////////////////////////////////////////
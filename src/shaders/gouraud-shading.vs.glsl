@@ -18,6 +18,7 @@ layout(std140) uniform Light
     vec4 position;
     vec4 color;
     float intensity;
+    float radius;
 } light;
 
 layout(std140) uniform Material
@@ -31,6 +32,7 @@ layout(std140) uniform Material
 uniform int lightingMode;
 uniform float ambientLight;
 uniform vec3 cameraPosition;
+uniform bool instancedDraw;
 //------------------------------------------------------------------------------------------
 // const
 const mat4 scaleMatrix = mat4(vec4(0.5f, 0.0f, 0.0f, 0.0f),
@@ -44,6 +46,8 @@ in vec3 v_coord;
 in vec3 v_color;
 in vec3 v_normal;
 in vec2 v_texCoord;
+in mat4 v_instanceModelMatrix;
+in mat4 v_instanceNormalMatrix;
 
 //------------------------------------------------------------------------------------------
 // out variables
@@ -57,16 +61,31 @@ out VS_OUT
     vec2 f_texCoord;
 };
 
+//------------------------------------------------------------------------------------------
+// must match the depth pre-pass exactly, as the shading pass then tests with GL_EQUAL
+invariant gl_Position;
+
 //------------------------------------------------------------------------------------------
 // If it use vertex color, it must set material.diffuseColor.x to a number < 0.0f
+// If it is drawn by instancing, the model and normal matrices come from the instance buffer
 //------------------------------------------------------------------------------------------
 void main(void)
 {
-    vec4 worldCoord = modelMatrix * vec4(v_coord, 1.0);
+    mat4 objModelMatrix = modelMatrix;
+    mat4 objNormalMatrix = normalMatrix;
 
-    vec3 normal = mat3(normalMatrix) * v_normal;
+    if(instancedDraw)
+    {
+        objModelMatrix = v_instanceModelMatrix;
+        objNormalMatrix = v_instanceNormalMatrix;
+    }
+
+    vec4 worldCoord = objModelMatrix * vec4(v_coord, 1.0);
+
+    vec3 normal = mat3(objNormalMatrix) * v_normal;
     vec3 lightDir = vec3(light.position) - vec3(worldCoord);
     vec3 viewDir = vec3(cameraPosition) - vec3(worldCoord);
+    float lightDistance = length(lightDir);
 
     normal = normalize(normal);
     lightDir = normalize(lightDir);
@@ -88,6 +107,15 @@ void main(void)
 
         vec3 halfDir = normalize(lightDir + viewDir);
         specular = pow(max(dot(halfDir, normal), 0.0f), material.shininess) * vec3(1.0f);
+
+        // a light with a radius falls off to zero there, the main light has none
+        if(light.radius > 0.0f)
+        {
+            float attenuation = max(1.0f - lightDistance / light.radius, 0.0f);
+            attenuation *= attenuation;
+            diffuse *= attenuation * vec3(light.color);
+            specular *= attenuation * vec3(light.color);
+        }
     }
 
     /////////////////////////////////////////////////////////////////
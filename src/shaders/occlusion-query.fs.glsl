@@ -0,0 +1,16 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// fragment shader, occlusion query shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// out variables
+out vec4 fragColor;
+
+//------------------------------------------------------------------------------------------
+void main()
+{
+    /////////////////////////////////////////////////////////////////
+    // output, color writes are disabled while querying
+    fragColor = vec4(1.0, 1.0, 1.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// vertex shader, occlusion query shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+// maps the unit cube onto the bounding box of the tested object, in clip space
+uniform mat4 boxMatrix;
+
+//------------------------------------------------------------------------------------------
+// in variables
+in vec3 v_coord;
+
+//------------------------------------------------------------------------------------------
+void main()
+{
+    /////////////////////////////////////////////////////////////////
+    // output
+    gl_Position = boxMatrix * vec4(v_coord, 1.0);
+}
@@ -10,6 +10,7 @@ layout(std140) uniform Light
     vec4 position;
     vec4 color;
     float intensity;
+    float radius;
 } light;
 
 layout(std140) uniform Material
@@ -20,15 +21,52 @@ layout(std140) uniform Material
     float shininess;
 } material;
 
-// lightingMode: 1 = ambient only, 2 = diffuse+spec only, 0 = all light
-uniform int lightingMode;
+// shadow casting lights, the first one is the main light, see Renderer::updateShadowLights
+// the arrays hold MAX_NUM_SHADOW_LIGHTS entries
+layout(std140) uniform ShadowLights
+{
+    mat4 shadowMatrix[4];
+    vec4 position[4];
+    vec4 colorIntensity[4];
+    vec4 atlasTile[4];
+    int numLights;
+} shadowLights;
+
 uniform float ambientLight;
 uniform sampler2DShadow depthTex;
 uniform sampler2D objTex;
+uniform vec3 cameraPosition;
+
+// a variant has its features defined as constants, see Renderer::getShadingFeatureDefines,
+// so the branches on them are compiled out; otherwise they are uniforms
+#ifdef SHADING_FEATURES
+const bool ambientLighting = bool(FEATURE_AMBIENT_LIGHT);
+const bool directLighting = bool(FEATURE_DIRECT_LIGHT);
+const bool hasDepthTex = bool(FEATURE_DEPTH_TEXTURE);
+const bool hasObjTex = bool(FEATURE_OBJ_TEXTURE);
+const bool discardTransparentPixel = bool(FEATURE_DISCARD_TRANSPARENT);
+const bool vertexColor = bool(FEATURE_VERTEX_COLOR);
+#else
+// lightingMode: 1 = ambient only, 2 = diffuse+spec only, 0 = all light
+uniform int lightingMode;
 uniform bool hasObjTex;
 uniform bool hasDepthTex;
 uniform bool discardTransparentPixel;
 
+#define ambientLighting (lightingMode != 2)
+#define directLighting (lightingMode != 1)
+#define vertexColor (material.diffuseColor.x < -0.001f)
+#endif
+
+// point lights of the cluster containing the fragment, see Renderer::buildLightClusters
+// clusterParameters: camera near plane, camera far plane, slice scale, tile size
+uniform bool clusteredLighting;
+uniform samplerBuffer pointLightTex;
+uniform usamplerBuffer clusterTex;
+uniform usamplerBuffer lightIndexTex;
+uniform ivec3 clusterGrid;
+uniform vec4 clusterParameters;
+
 //------------------------------------------------------------------------------------------
 // in variables
 in VS_OUT
@@ -45,9 +83,112 @@ in VS_OUT
 // out variables
 out vec4 fragColor;
 
+//------------------------------------------------------------------------------------------
+// The shadow coordinate is in the [0, 1] texture space of the light, it is moved into the
+// tile of the light in the shadow atlas; a light without a tile casts no shadow. The
+// lookup is kept half a texel inside the tile, so filtering never reads a neighbour tile
+//------------------------------------------------------------------------------------------
+float lookupShadowAtlas(int _light, vec4 _shadowCoord)
+{
+    vec4 tile = shadowLights.atlasTile[_light];
+    vec3 coord = _shadowCoord.xyz / _shadowCoord.w;
+
+    if(tile.w == 0.0f || _shadowCoord.w <= 0.0f ||
+       any(lessThan(coord.xy, vec2(0.0f))) || any(greaterThan(coord.xy, vec2(1.0f))))
+    {
+        return 1.0f;
+    }
+
+    vec2 halfTexel = 0.5f / vec2(textureSize(depthTex, 0));
+    vec2 atlasCoord = clamp(tile.xy + coord.xy * tile.z, tile.xy + halfTexel,
+                            tile.xy + vec2(tile.z) - halfTexel);
+
+    return texture(depthTex, vec3(atlasCoord, coord.z));
+}
+
+//------------------------------------------------------------------------------------------
+// The other shadow casting lights, each one shadowed through its own atlas tile
+//------------------------------------------------------------------------------------------
+vec3 computeShadowLights(vec3 _worldCoord, vec3 _surfaceColor, vec3 _specularColor,
+                         float _shininess, vec3 _normal, vec3 _viewDir)
+{
+    vec3 color = vec3(0.0f);
+
+    for(int i = 1; i < shadowLights.numLights; ++i)
+    {
+        vec3 lightDir = normalize(shadowLights.position[i].xyz - _worldCoord);
+        vec3 halfDir = normalize(lightDir + _viewDir);
+
+        vec3 diffuse = vec3(max(dot(_normal, lightDir), 0.0f)) * _surfaceColor;
+        vec3 specular = pow(max(dot(halfDir, _normal), 0.0f), _shininess) * _specularColor;
+        float isNoShadow = lookupShadowAtlas(i, shadowLights.shadowMatrix[i] *
+                                                vec4(_worldCoord, 1.0f));
+        vec4 colorIntensity = shadowLights.colorIntensity[i];
+
+        color += isNoShadow * colorIntensity.w * colorIntensity.xyz * (diffuse + specular);
+    }
+
+    return color;
+}
+
+//------------------------------------------------------------------------------------------
+// The cluster is found from the window position and the view depth of the fragment,
+// the light falls off to zero at its radius
+//------------------------------------------------------------------------------------------
+vec3 computeClusteredLights(vec3 _surfaceColor, vec3 _normal, vec3 _viewDir)
+{
+    float near = clusterParameters.x;
+    float far = clusterParameters.y;
+    float ndcDepth = 2.0f * gl_FragCoord.z - 1.0f;
+    float viewDepth = 2.0f * near * far / (far + near - ndcDepth * (far - near));
+    int slice = int(log(viewDepth / near) * clusterParameters.z);
+
+    if(slice >= clusterGrid.z)
+    {
+        return vec3(0.0f);
+    }
+
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterParameters.w), clusterGrid.xy - 1);
+    int cluster = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+    uvec2 lightRange = texelFetch(clusterTex, cluster).xy;
+
+    vec3 worldCoord = cameraPosition - f_viewDir;
+    vec3 color = vec3(0.0f);
+
+    for(uint i = 0u; i < lightRange.y; ++i)
+    {
+        int lightIndex = int(texelFetch(lightIndexTex, int(lightRange.x + i)).x);
+        vec4 positionRadius = texelFetch(pointLightTex, 2 * lightIndex);
+        vec4 colorIntensity = texelFetch(pointLightTex, 2 * lightIndex + 1);
+
+        vec3 lightDir = positionRadius.xyz - worldCoord;
+        float lightDistance = length(lightDir);
+
+        if(lightDistance > positionRadius.w)
+        {
+            continue;
+        }
+
+        lightDir /= lightDistance;
+        vec3 halfDir = normalize(lightDir + _viewDir);
+
+        float attenuation = 1.0f - lightDistance / positionRadius.w;
+        attenuation *= attenuation;
+
+        vec3 diffuse = vec3(max(dot(_normal, lightDir), 0.0f)) * _surfaceColor;
+        vec3 specular = pow(max(dot(halfDir, _normal), 0.0f), material.shininess) *
+                        vec3(material.specularColor);
+
+        color += attenuation * colorIntensity.w * colorIntensity.xyz * (diffuse + specular);
+    }
+
+    return color;
+}
+
 //------------------------------------------------------------------------------------------
 // If an object uses texture, it must set "GL_TRUE" to hasObjTex
-// If it use vertex color, it must set material.diffuseColor.x to a number < 0.0f
+// If it use vertex color, it must set material.diffuseColor.x to a number < 0.0f, or
+// have FEATURE_VERTEX_COLOR
 //------------------------------------------------------------------------------------------
 void main()
 {
@@ -68,7 +209,7 @@ void main()
         alpha = texVal.w;
     }
 
-    if(material.diffuseColor.x > -0.001f)
+    if(!vertexColor)
     {
         surfaceColor = mix(vec3(material.diffuseColor), surfaceColor, alpha);
     }
@@ -80,29 +221,50 @@ void main()
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
     vec3 specular = vec3(0.0f);
+    vec3 shadowLightsColor = vec3(0.0f);
     float isNoShadow = 1.0f;
 
-    if(lightingMode == 1 || lightingMode == 0)
+    if(ambientLighting)
     {
         ambient = ambientLight * surfaceColor;
     }
 
-    if(lightingMode == 2 || lightingMode == 0)
+    if(directLighting)
     {
         diffuse = vec3(max(dot(normal, lightDir), 0.0f)) * surfaceColor;
         vec3 halfDir = normalize(lightDir + viewDir);
         specular = pow(max(dot(halfDir, normal), 0.0f), material.shininess) * vec3(material.specularColor);
+
+        // a light with a radius falls off to zero there, the main light has none
+        if(light.radius > 0.0f)
+        {
+            float attenuation = max(1.0f - length(f_lightDir) / light.radius, 0.0f);
+            attenuation *= attenuation;
+            diffuse *= attenuation * vec3(light.color);
+            specular *= attenuation * vec3(light.color);
+        }
     }
 
     if(hasDepthTex)
     {
-        if(any(lessThan(vec3(f_shadowCoord), vec3(0.0))) )
-            isNoShadow = 1.0f;
-        else
-            isNoShadow = textureProj(depthTex, f_shadowCoord);
+        isNoShadow = lookupShadowAtlas(0, f_shadowCoord);
+
+        if(directLighting)
+        {
+            shadowLightsColor = computeShadowLights(cameraPosition - f_viewDir, surfaceColor,
+                                                    vec3(material.specularColor),
+                                                    material.shininess, normal, viewDir);
+        }
+    }
+
+    // the point lights cast no shadow, they go with the unshadowed pass
+    if(clusteredLighting && ambientLighting)
+    {
+        ambient += computeClusteredLights(surfaceColor, normal, viewDir);
     }
 
     /////////////////////////////////////////////////////////////////
     // output
-    fragColor = vec4(ambient + isNoShadow * light.intensity * (diffuse + specular), alpha);
+    fragColor = vec4(ambient + isNoShadow * light.intensity * (diffuse + specular) +
+                     shadowLightsColor, alpha);
 }
@@ -18,9 +18,11 @@ layout(std140) uniform Light
     vec4 position;
     vec4 color;
     float intensity;
+    float radius;
 } light;
 
 uniform vec3 cameraPosition;
+uniform bool instancedDraw;
 
 //------------------------------------------------------------------------------------------
 // const
@@ -35,6 +37,8 @@ in vec3 v_coord;
 in vec3 v_color;
 in vec3 v_normal;
 in vec2 v_texCoord;
+in mat4 v_instanceModelMatrix;
+in mat4 v_instanceNormalMatrix;
 
 //------------------------------------------------------------------------------------------
 // out variables
@@ -48,16 +52,31 @@ out VS_OUT
     vec2 f_texCoord;
 };
 
+//------------------------------------------------------------------------------------------
+// must match the depth pre-pass exactly, as the shading pass then tests with GL_EQUAL
+invariant gl_Position;
+
+//------------------------------------------------------------------------------------------
+// If it is drawn by instancing, the model and normal matrices come from the instance buffer
 //------------------------------------------------------------------------------------------
 void main()
 {
-    vec4 worldCoord = modelMatrix * vec4(v_coord, 1.0);
+    mat4 objModelMatrix = modelMatrix;
+    mat4 objNormalMatrix = normalMatrix;
+
+    if(instancedDraw)
+    {
+        objModelMatrix = v_instanceModelMatrix;
+        objNormalMatrix = v_instanceNormalMatrix;
+    }
+
+    vec4 worldCoord = objModelMatrix * vec4(v_coord, 1.0);
 
     /////////////////////////////////////////////////////////////////
     // output
     f_shadowCoord = scaleMatrix * shadowMatrix * worldCoord;
     f_color = v_color;
-    f_normal = mat3(normalMatrix) * v_normal;
+    f_normal = mat3(objNormalMatrix) * v_normal;
     f_lightDir = vec3(light.position) - vec3(worldCoord);
     f_viewDir = vec3(cameraPosition) - vec3(worldCoord);
     f_texCoord = v_texCoord;
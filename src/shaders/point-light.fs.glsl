@@ -0,0 +1,67 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// fragment shader, light volumes of the deferred point lights
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+uniform sampler2D albedoTex;
+uniform sampler2D normalTex;
+uniform sampler2D specularTex;
+uniform sampler2D sceneDepthTex;
+uniform vec3 cameraPosition;
+uniform mat4 inverseViewProjectionMatrix;
+
+//------------------------------------------------------------------------------------------
+// in variables
+in VS_OUT
+{
+    flat vec4 f_lightPosition;
+    flat vec4 f_lightColor;
+};
+
+//------------------------------------------------------------------------------------------
+// out variables
+out vec4 fragColor;
+
+//------------------------------------------------------------------------------------------
+// Only the pixels covered by a light volume are shaded, the result is added to the
+// frame buffer; the light falls off to zero at its radius
+//------------------------------------------------------------------------------------------
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(sceneDepthTex, pixel, 0).x;
+
+    if(depth == 1.0f) discard;
+
+    vec2 screenCoord = gl_FragCoord.xy / vec2(textureSize(sceneDepthTex, 0));
+    vec4 worldCoord = inverseViewProjectionMatrix * vec4(vec3(screenCoord, depth) * 2.0f - 1.0f,
+                                                         1.0f);
+    worldCoord /= worldCoord.w;
+
+    vec3 lightDir = f_lightPosition.xyz - vec3(worldCoord);
+    float lightDistance = length(lightDir);
+
+    if(lightDistance > f_lightPosition.w) discard;
+
+    vec3 surfaceColor = texelFetch(albedoTex, pixel, 0).xyz;
+    vec4 normalShininess = texelFetch(normalTex, pixel, 0);
+    vec3 specularColor = texelFetch(specularTex, pixel, 0).xyz;
+
+    vec3 normal = normalize(normalShininess.xyz);
+    vec3 viewDir = normalize(cameraPosition - vec3(worldCoord));
+    lightDir /= lightDistance;
+    vec3 halfDir = normalize(lightDir + viewDir);
+
+    float attenuation = 1.0f - lightDistance / f_lightPosition.w;
+    attenuation *= attenuation;
+
+    vec3 diffuse = vec3(max(dot(normal, lightDir), 0.0f)) * surfaceColor;
+    vec3 specular = pow(max(dot(halfDir, normal), 0.0f), normalShininess.w) * specularColor;
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    fragColor = vec4(attenuation * f_lightColor.w * f_lightColor.xyz * (diffuse + specular),
+                     1.0f);
+}
@@ -0,0 +1,48 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// vertex shader, light volumes of the deferred point lights
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Matrices
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 shadowMatrix;
+};
+
+//------------------------------------------------------------------------------------------
+// const
+// the tessellated sphere lies inside the unit sphere, it is enlarged to enclose it
+const float volumeScale = 1.1f;
+
+//------------------------------------------------------------------------------------------
+// in variables
+in vec3 v_coord;
+in vec4 v_lightPosition;
+in vec4 v_lightColor;
+
+//------------------------------------------------------------------------------------------
+// out variables
+out VS_OUT
+{
+    flat vec4 f_lightPosition;
+    flat vec4 f_lightColor;
+};
+
+//------------------------------------------------------------------------------------------
+// v_lightPosition.w is the radius of the light, v_lightColor.w its intensity
+//------------------------------------------------------------------------------------------
+void main()
+{
+    vec3 worldCoord = v_lightPosition.xyz + volumeScale * v_lightPosition.w * v_coord;
+
+    /////////////////////////////////////////////////////////////////
+    // output
+    f_lightPosition = v_lightPosition;
+    f_lightColor = v_lightColor;
+
+    gl_Position = viewProjectionMatrix * vec4(worldCoord, 1.0f);
+}
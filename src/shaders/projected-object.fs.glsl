@@ -7,9 +7,15 @@
 // uniforms
 uniform float shadowIntensity;
 
+// with batchedPlanes, the id of the visible receiver of each pixel, numbered from 1, see
+// receiver-id.fs.glsl
+uniform bool batchedPlanes;
+uniform sampler2D receiverIdTex;
+
 //----------------------------------------------------------`--------------------------------
 // in variables
 in float f_keepFragment;
+flat in int f_receiver;
 //----------------------------------------------------------`--------------------------------
 // out variables
 out vec4 fragColor;
@@ -20,5 +26,13 @@ void main()
     if(f_keepFragment < 0.5)
        discard;
 
+    if(batchedPlanes)
+    {
+        float receiverId = texelFetch(receiverIdTex, ivec2(gl_FragCoord.xy), 0).r * 255.0;
+
+        if(int(receiverId + 0.5) != f_receiver + 1)
+            discard;
+    }
+
     fragColor = vec4(0, 0, 0, shadowIntensity);
 }
@@ -0,0 +1,94 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// geometry shader, projected object shading
+//------------------------------------------------------------------------------------------
+layout(triangles, invocations = 32) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Matrices
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 shadowMatrix;
+};
+
+layout(std140) uniform Light
+{
+    vec4 position;
+    vec4 color;
+    float intensity;
+} light;
+
+// batchedPlanes: each invocation projects onto its own receiver, clipped to the rectangle
+// spanned from receiverOrigins by the axes, which are divided by their squared length; the
+// fragment shader then keeps the pixels of the receiver triangles only
+// otherwise only the first invocation projects onto planeVector
+// the arrays hold MAX_NUM_RECEIVER_PLANES entries
+uniform vec4 planeVector;
+uniform bool batchedPlanes;
+uniform int numReceivers;
+uniform vec4 planeVectors[32];
+uniform vec3 receiverOrigins[32];
+uniform vec3 receiverAxesU[32];
+uniform vec3 receiverAxesV[32];
+
+//------------------------------------------------------------------------------------------
+// input
+in vec3 g_worldCoord[];
+
+//------------------------------------------------------------------------------------------
+// output
+out float f_keepFragment;
+flat out int f_receiver;
+
+//------------------------------------------------------------------------------------------
+void main()
+{
+    if(gl_InvocationID >= (batchedPlanes ? numReceivers : 1))
+    {
+        return;
+    }
+
+    vec4 plane = batchedPlanes ? planeVectors[gl_InvocationID] : planeVector;
+    vec3 planeNormal = vec3(plane);
+
+    vec3 lightPos = vec3(light.position);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        vec3 objectPos = g_worldCoord[i];
+        vec3 dirLight2Object = objectPos - lightPos;
+
+        vec3 projectedObjectPos = lightPos - (plane.w + dot(planeNormal, lightPos)) / dot(planeNormal, dirLight2Object) * dirLight2Object;
+        vec3 dirLight2ProjectedPos = projectedObjectPos - lightPos;
+        float distObjectPos = length(dirLight2Object);
+        float distProjectedPos = length(dirLight2ProjectedPos);
+
+        /////////////////////////////////////////////////////////////////
+        // output
+        f_keepFragment = 0.0;
+        f_receiver = gl_InvocationID;
+        if((dot(dirLight2Object, dirLight2ProjectedPos) > 0) && (distProjectedPos > distObjectPos))
+            f_keepFragment = 1.0;
+
+        // the clip distances are only enabled for the batched planes
+        if(batchedPlanes)
+        {
+            vec3 toOrigin = projectedObjectPos - receiverOrigins[gl_InvocationID];
+            vec2 rectCoord = vec2(dot(toOrigin, receiverAxesU[gl_InvocationID]),
+                                  dot(toOrigin, receiverAxesV[gl_InvocationID]));
+            gl_ClipDistance[0] = rectCoord.x + 1.0e-3;
+            gl_ClipDistance[1] = 1.0 - rectCoord.x + 1.0e-3;
+            gl_ClipDistance[2] = rectCoord.y + 1.0e-3;
+            gl_ClipDistance[3] = 1.0 - rectCoord.y + 1.0e-3;
+        }
+
+        gl_Position = viewProjectionMatrix * vec4(projectedObjectPos, 1.0);
+        EmitVertex();
+    }
+
+    EndPrimitive();
+}
@@ -13,43 +13,23 @@ layout(std140) uniform Matrices
     mat4 shadowMatrix;
 };
 
-layout(std140) uniform Light
-{
-    vec4 position;
-    vec4 color;
-    float intensity;
-} light;
-
-uniform vec4 planeVector;
+uniform bool instancedDraw;
 
 //------------------------------------------------------------------------------------------
 // input
 in vec3 v_coord;
+in mat4 v_instanceModelMatrix;
 
 //------------------------------------------------------------------------------------------
-// output
-out float f_keepFragment;
+// output, the projection onto the receiver planes is done by the geometry shader
+out vec3 g_worldCoord;
 
 //------------------------------------------------------------------------------------------
 void main()
 {
-    vec4 worldCoord = modelMatrix * vec4(v_coord, 1.0);
-
-    vec3 objectPos = vec3(worldCoord);
-    vec3 lightPos = vec3(light.position);
-    vec3 planeNormal = vec3(planeVector);
-    vec3 dirLight2Object = objectPos - lightPos;
-
-    vec3 projectedObjectPos = lightPos - (planeVector.w + dot(planeNormal, lightPos)) / dot(planeNormal, dirLight2Object) * dirLight2Object;
-    vec3 dirLight2ProjectedPos = projectedObjectPos - lightPos;
-    float distObjectPos = length(dirLight2Object);
-    float distProjectedPos = length(dirLight2ProjectedPos);
+    mat4 objModelMatrix = instancedDraw ? v_instanceModelMatrix : modelMatrix;
 
     /////////////////////////////////////////////////////////////////
     // output
-    f_keepFragment = 0.0;
-    if((dot(dirLight2Object, dirLight2ProjectedPos) > 0) && (distProjectedPos > distObjectPos))
-        f_keepFragment = 1.0;
-
-    gl_Position = viewProjectionMatrix * vec4(projectedObjectPos, 1.0);
+    g_worldCoord = vec3(objModelMatrix * vec4(v_coord, 1.0));
 }
@@ -0,0 +1,20 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// fragment shader, receiver id shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// in variables
+flat in float f_receiverId;
+
+//------------------------------------------------------------------------------------------
+// out variables
+out vec4 fragColor;
+
+//------------------------------------------------------------------------------------------
+void main()
+{
+    /////////////////////////////////////////////////////////////////
+    // output, the receivers are numbered from 1, 0 is left where there is none
+    fragColor = vec4(f_receiverId / 255.0, 0.0, 0.0, 0.0);
+}
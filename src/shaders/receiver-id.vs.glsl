@@ -0,0 +1,32 @@
+#version 410 core
+//------------------------------------------------------------------------------------------
+// vertex shader, receiver id shading
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+// uniforms
+layout(std140) uniform Matrices
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    mat4 viewProjectionMatrix;
+    mat4 shadowMatrix;
+};
+
+//------------------------------------------------------------------------------------------
+// in variables, the triangles of the receivers are given in world space
+in vec3 v_coord;
+in float v_receiverId;
+
+//------------------------------------------------------------------------------------------
+// out variables
+flat out float f_receiverId;
+
+//------------------------------------------------------------------------------------------
+void main()
+{
+    /////////////////////////////////////////////////////////////////
+    // output
+    f_receiverId = v_receiverId;
+    gl_Position = viewProjectionMatrix * vec4(v_coord, 1.0);
+}
@@ -13,21 +13,42 @@ layout(std140) uniform Matrices
     mat4 shadowMatrix;
 };
 
+uniform bool instancedDraw;
+uniform bool cameraView;
+
 //------------------------------------------------------------------------------------------
 // in variables
 in vec3 v_coord;
 in vec2 v_texCoord;
+in mat4 v_instanceModelMatrix;
 //------------------------------------------------------------------------------------------
 // out variables
 out vec2 f_texCoord;
 
+//------------------------------------------------------------------------------------------
+// the depth pre-pass renders from the camera, its depth must match the shading programs
+invariant gl_Position;
+
 //------------------------------------------------------------------------------------------
 void main()
 {
-    vec4 worldCoord = modelMatrix * vec4(v_coord, 1.0);
+    mat4 objModelMatrix = modelMatrix;
+    mat4 projectionMatrix = shadowMatrix;
+
+    if(instancedDraw)
+    {
+        objModelMatrix = v_instanceModelMatrix;
+    }
+
+    if(cameraView)
+    {
+        projectionMatrix = viewProjectionMatrix;
+    }
+
+    vec4 worldCoord = objModelMatrix * vec4(v_coord, 1.0);
 
     /////////////////////////////////////////////////////////////////
     // output
     f_texCoord = v_texCoord;
-    gl_Position = shadowMatrix * worldCoord;
+    gl_Position = projectionMatrix * worldCoord;
 }
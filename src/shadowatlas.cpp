@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include "shadowatlas.h"
+
+#include <math.h>
+
+ShadowAtlas::ShadowAtlas(int _atlasSize, int _minTileSize, int _maxTileSize):
+    atlasSize(_atlasSize),
+    minTileSize(_minTileSize),
+    maxTileSize(_maxTileSize)
+{
+}
+
+//------------------------------------------------------------------------------------------
+int ShadowAtlas::getAtlasSize()
+{
+    return atlasSize;
+}
+
+//------------------------------------------------------------------------------------------
+// the resolution follows the side length of the covered screen part, rounded down to
+// a power of two
+//------------------------------------------------------------------------------------------
+int ShadowAtlas::getTileSize(float _screenCoverage)
+{
+    float coverage = fmin(fmax(_screenCoverage, 0.0f), 1.0f);
+    int tileSize = maxTileSize;
+
+    while(tileSize > minTileSize && (float)tileSize > sqrt(coverage) * maxTileSize)
+    {
+        tileSize /= 2;
+    }
+
+    return tileSize;
+}
+
+//------------------------------------------------------------------------------------------
+// the tiles are allocated in units of the smallest tile, a tile of size s takes the next
+// (s / minTileSize)^2 units of the Z-order curve
+//------------------------------------------------------------------------------------------
+void ShadowAtlas::packTiles(const QVector<int>& _tileSizes)
+{
+    int numTiles = _tileSizes.size();
+    int gridSize = atlasSize / minTileSize;
+    int numUnits = gridSize * gridSize;
+
+    tiles.resize(numTiles);
+    packOrder.resize(numTiles);
+
+    /////////////////////////////////////////////////////////////////
+    // largest tiles first, there are only a few of them
+    for(int i = 0; i < numTiles; ++i)
+    {
+        int j = i;
+
+        while(j > 0 && _tileSizes.at(packOrder.at(j - 1)) < _tileSizes.at(i))
+        {
+            packOrder[j] = packOrder.at(j - 1);
+            --j;
+        }
+
+        packOrder[j] = i;
+    }
+
+    // a halved tile also limits the following ones, to keep them aligned
+    int sizeLimit = maxTileSize;
+    int unit = 0;
+
+    for(int i = 0; i < numTiles; ++i)
+    {
+        int index = packOrder.at(i);
+        int tileSize = qBound(minTileSize, _tileSizes.at(index), sizeLimit);
+        int tileUnits = (tileSize / minTileSize) * (tileSize / minTileSize);
+
+        while(unit + tileUnits > numUnits && tileSize > minTileSize)
+        {
+            tileSize /= 2;
+            tileUnits /= 4;
+        }
+
+        if(unit + tileUnits > numUnits)
+        {
+            // out of space, the tile is left empty and its light casts no shadow
+            tiles[index] = QRect();
+            continue;
+        }
+
+        int x = 0;
+        int y = 0;
+
+        for(int bit = 0; (1 << (2 * bit)) < numUnits; ++bit)
+        {
+            x |= ((unit >> (2 * bit)) & 1) << bit;
+            y |= ((unit >> (2 * bit + 1)) & 1) << bit;
+        }
+
+        tiles[index] = QRect(x * minTileSize, y * minTileSize, tileSize, tileSize);
+        unit += tileUnits;
+        sizeLimit = tileSize;
+    }
+}
+
+//------------------------------------------------------------------------------------------
+QRect ShadowAtlas::getTile(int _index)
+{
+    return tiles.at(_index);
+}
+
+//------------------------------------------------------------------------------------------
+// offset and scale from the [0, 1] texture space of a light to its tile
+//------------------------------------------------------------------------------------------
+QVector4D ShadowAtlas::getTileTransform(int _index)
+{
+    const QRect& tile = tiles.at(_index);
+
+    if(tile.isEmpty())
+    {
+        return QVector4D(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    return QVector4D((float)tile.x() / (float)atlasSize,
+                     (float)tile.y() / (float)atlasSize,
+                     (float)tile.width() / (float)atlasSize,
+                     1.0f);
+}
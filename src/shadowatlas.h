@@ -0,0 +1,42 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef SHADOWATLAS_H
+#define SHADOWATLAS_H
+
+#include <QVector>
+#include <QVector4D>
+#include <QRect>
+
+//------------------------------------------------------------------------------------------
+// Square power of two tiles of one large shadow map. The tiles are placed largest first
+// along a Z-order curve, which keeps every tile aligned to its own size, so that the
+// whole atlas can be repacked every frame without fragmentation. A tile that does not
+// fit anymore is halved until it does.
+//------------------------------------------------------------------------------------------
+class ShadowAtlas
+{
+public:
+    ShadowAtlas(int _atlasSize, int _minTileSize, int _maxTileSize);
+
+    int getAtlasSize();
+    int getTileSize(float _screenCoverage);
+
+    void packTiles(const QVector<int>& _tileSizes);
+    QRect getTile(int _index);
+    QVector4D getTileTransform(int _index);
+
+private:
+    int atlasSize;
+    int minTileSize;
+    int maxTileSize;
+    QVector<QRect> tiles;
+    QVector<int> packOrder;
+};
+
+#endif // SHADOWATLAS_H
@@ -0,0 +1,327 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QImage>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <algorithm>
+
+#include "texturestreamer.h"
+#include "renderer.h"
+
+//------------------------------------------------------------------------------------------
+static const unsigned char KTX_IDENTIFIER[12] =
+{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+static const quint32 KTX_ENDIANNESS = 0x04030201;
+
+// glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat, pixelWidth,
+// pixelHeight, pixelDepth, numberOfArrayElements, numberOfFaces, numberOfMipmapLevels,
+// bytesOfKeyValueData, following the identifier and the endianness
+struct KTXHeader
+{
+    quint32 glType;
+    quint32 glTypeSize;
+    quint32 glFormat;
+    quint32 glInternalFormat;
+    quint32 glBaseInternalFormat;
+    quint32 pixelWidth;
+    quint32 pixelHeight;
+    quint32 pixelDepth;
+    quint32 numberOfArrayElements;
+    quint32 numberOfFaces;
+    quint32 numberOfMipmapLevels;
+    quint32 bytesOfKeyValueData;
+};
+
+//------------------------------------------------------------------------------------------
+TextureStreamer::TextureStreamer(Renderer* _renderer, bool _compressionSupported):
+    renderer(_renderer),
+    compressionSupported(_compressionSupported)
+{
+    QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+    if(!cacheLocation.isEmpty())
+    {
+        cacheDirectory = cacheLocation + "/textures";
+    }
+}
+
+//------------------------------------------------------------------------------------------
+TextureStreamer::~TextureStreamer()
+{
+    threadPool.clear();
+    threadPool.waitForDone();
+}
+
+//------------------------------------------------------------------------------------------
+StreamedTexture TextureStreamer::createRequest(QOpenGLTexture** _texture,
+                                               const QString& _fileName,
+                                               bool _mirrored, bool _mipmapped)
+{
+    StreamedTexture request;
+    request.texture = _texture;
+    request.fileName = _fileName;
+    request.mirrored = _mirrored;
+    request.mipmapped = _mipmapped;
+    request.compressed = false;
+    request.internalFormat = GL_RGBA8;
+
+    return request;
+}
+
+//------------------------------------------------------------------------------------------
+void TextureStreamer::requestTexture(const StreamedTexture& _request)
+{
+    Renderer* target = renderer;
+
+    threadPool.start([this, target, _request]()
+    {
+        StreamedTexture texture = _request;
+
+        if(!loadTexture(&texture))
+        {
+            PRINT_ERROR("Cannot load texture from file.");
+            return;
+        }
+
+        // the renderer posts the upload on to its render thread, if it has one
+        QMetaObject::invokeMethod(target, [target, texture]()
+        {
+            target->uploadStreamedTexture(texture);
+        }, Qt::QueuedConnection);
+    });
+}
+
+//------------------------------------------------------------------------------------------
+// fills in the levels, from the cache if the source file has been compressed before
+//------------------------------------------------------------------------------------------
+bool TextureStreamer::loadTexture(StreamedTexture* _texture)
+{
+    QFile file(_texture->fileName);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QByteArray fileData = file.readAll();
+    file.close();
+
+    if(compressionSupported && !cacheDirectory.isEmpty())
+    {
+        QString hash = QCryptographicHash::hash(fileData, QCryptographicHash::Sha1).toHex();
+        _texture->cacheFileName = QString("%1/%2-%3%4%5.ktx")
+                                  .arg(cacheDirectory)
+                                  .arg(QFileInfo(_texture->fileName).baseName())
+                                  .arg(hash)
+                                  .arg(_texture->mirrored ? "-flip" : "")
+                                  .arg(_texture->mipmapped ? "-mip" : "");
+
+        if(readKTX(_texture->cacheFileName, _texture))
+        {
+            return true;
+        }
+    }
+
+    decodeTexture(fileData, _texture);
+
+    return !_texture->levels.isEmpty();
+}
+
+//------------------------------------------------------------------------------------------
+void TextureStreamer::writeCache(const StreamedTexture& _texture)
+{
+    if(_texture.cacheFileName.isEmpty())
+    {
+        return;
+    }
+
+    QString directory = cacheDirectory;
+
+    threadPool.start([directory, _texture]()
+    {
+        if(!QDir().mkpath(directory) || !writeKTX(_texture.cacheFileName, _texture))
+        {
+            PRINT_ERROR("Cannot write texture cache file.");
+        }
+    });
+}
+
+//------------------------------------------------------------------------------------------
+void TextureStreamer::decodeTexture(const QByteArray& _fileData,
+                                    StreamedTexture* _texture)
+{
+    QImage sourceImage;
+
+    if(!sourceImage.loadFromData(_fileData))
+    {
+        return;
+    }
+
+    QImage image = sourceImage.convertToFormat(QImage::Format_RGBA8888);
+
+    if(_texture->mirrored)
+    {
+        for(int y = 0; y < image.height() / 2; ++y)
+        {
+            uchar* top = image.scanLine(y);
+            std::swap_ranges(top, top + image.bytesPerLine(),
+                             image.scanLine(image.height() - 1 - y));
+        }
+    }
+
+    _texture->compressed = false;
+    _texture->internalFormat = !compressionSupported ? GL_RGBA8 :
+                               (sourceImage.hasAlphaChannel() ?
+                                GL_COMPRESSED_RGBA_S3TC_DXT5_EXT :
+                                GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    _texture->levels.clear();
+
+    int width = image.width();
+    int height = image.height();
+
+    while(true)
+    {
+        QImage levelImage = (width == image.width() && height == image.height()) ?
+                            image :
+                            image.scaled(width, height, Qt::IgnoreAspectRatio,
+                                         Qt::SmoothTransformation);
+
+        StreamedTextureLevel level;
+        level.width = width;
+        level.height = height;
+        level.data = QByteArray((const char*)levelImage.constBits(), 4 * width * height);
+        _texture->levels.append(level);
+
+        if(!_texture->mipmapped || (width == 1 && height == 1))
+        {
+            break;
+        }
+
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+//------------------------------------------------------------------------------------------
+// KTX 1.1, only the compressed 2D textures written by writeKTX() are accepted
+//------------------------------------------------------------------------------------------
+bool TextureStreamer::readKTX(const QString& _fileName, StreamedTexture* _texture)
+{
+    QFile file(_fileName);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    unsigned char identifier[12];
+    quint32 endianness;
+    KTXHeader header;
+
+    if(file.read((char*)identifier, sizeof(identifier)) != sizeof(identifier) ||
+       !std::equal(identifier, identifier + sizeof(identifier), KTX_IDENTIFIER) ||
+       file.read((char*)&endianness, sizeof(endianness)) != sizeof(endianness) ||
+       endianness != KTX_ENDIANNESS ||
+       file.read((char*)&header, sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+
+    if(header.glType != 0 || header.pixelDepth != 0 || header.numberOfFaces != 1 ||
+       header.numberOfArrayElements != 0 || header.numberOfMipmapLevels == 0 ||
+       (header.glInternalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT &&
+        header.glInternalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ||
+       !file.seek(file.pos() + header.bytesOfKeyValueData))
+    {
+        return false;
+    }
+
+    QVector<StreamedTextureLevel> levels;
+
+    for(quint32 i = 0; i < header.numberOfMipmapLevels; ++i)
+    {
+        quint32 imageSize;
+
+        if(file.read((char*)&imageSize, sizeof(imageSize)) != sizeof(imageSize))
+        {
+            return false;
+        }
+
+        StreamedTextureLevel level;
+        level.width = std::max(1, (int)header.pixelWidth >> i);
+        level.height = std::max(1, (int)header.pixelHeight >> i);
+        level.data = file.read(imageSize);
+
+        // the block sizes are multiples of 4 bytes, so there is no mip padding
+        if(level.data.size() != (int)imageSize)
+        {
+            return false;
+        }
+
+        levels.append(level);
+    }
+
+    _texture->compressed = true;
+    _texture->internalFormat = header.glInternalFormat;
+    _texture->levels = levels;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------
+bool TextureStreamer::writeKTX(const QString& _fileName, const StreamedTexture& _texture)
+{
+    if(!_texture.compressed || _texture.levels.isEmpty())
+    {
+        return false;
+    }
+
+    KTXHeader header;
+    header.glType = 0;
+    header.glTypeSize = 1;
+    header.glFormat = 0;
+    header.glInternalFormat = _texture.internalFormat;
+    header.glBaseInternalFormat = (_texture.internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ?
+                                  GL_RGB : GL_RGBA;
+    header.pixelWidth = _texture.levels[0].width;
+    header.pixelHeight = _texture.levels[0].height;
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = _texture.levels.size();
+    header.bytesOfKeyValueData = 0;
+
+    // committed in one go, so a reader never sees half a file
+    QSaveFile file(_fileName);
+
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    file.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    file.write((const char*)&KTX_ENDIANNESS, sizeof(KTX_ENDIANNESS));
+    file.write((const char*)&header, sizeof(header));
+
+    for(int i = 0; i < _texture.levels.size(); ++i)
+    {
+        quint32 imageSize = _texture.levels[i].data.size();
+        file.write((const char*)&imageSize, sizeof(imageSize));
+        file.write(_texture.levels[i].data);
+    }
+
+    return file.commit();
+}
@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------------------
+//
+//
+// Created on: 10/19/2026
+//
+//
+//------------------------------------------------------------------------------------------
+
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QOpenGLTexture>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+class Renderer;
+
+//------------------------------------------------------------------------------------------
+struct StreamedTextureLevel
+{
+    int width;
+    int height;
+    QByteArray data;
+};
+
+//------------------------------------------------------------------------------------------
+// a texture file, decoded or read from the cache, on its way to replace the placeholder
+// in the texture slot
+//------------------------------------------------------------------------------------------
+struct StreamedTexture
+{
+    QOpenGLTexture** texture;
+    QString fileName;
+    bool mirrored;
+    bool mipmapped;
+
+    // the levels are blocks of internalFormat, otherwise RGBA8 texels which the driver
+    // compresses to internalFormat, read back and written to cacheFileName
+    bool compressed;
+    GLenum internalFormat;
+    QString cacheFileName;
+    QVector<StreamedTextureLevel> levels;
+};
+
+//------------------------------------------------------------------------------------------
+// Decodes the textures on a thread pool and hands them to Renderer::uploadStreamedTexture()
+// one by one as they are done, so they appear progressively. With S3TC, the driver
+// compresses a texture on its first upload, and the compressed levels are cached as KTX
+// files keyed by the hash of the source file; later runs read the blocks from there and
+// skip the decode.
+//------------------------------------------------------------------------------------------
+class TextureStreamer
+{
+public:
+    TextureStreamer(Renderer* _renderer, bool _compressionSupported);
+    ~TextureStreamer();
+
+    StreamedTexture createRequest(QOpenGLTexture** _texture, const QString& _fileName,
+                                  bool _mirrored, bool _mipmapped);
+    void requestTexture(const StreamedTexture& _request);
+    bool loadTexture(StreamedTexture* _texture);
+    void writeCache(const StreamedTexture& _texture);
+
+    static bool readKTX(const QString& _fileName, StreamedTexture* _texture);
+    static bool writeKTX(const QString& _fileName, const StreamedTexture& _texture);
+
+private:
+    void decodeTexture(const QByteArray& _fileData, StreamedTexture* _texture);
+
+    Renderer* renderer;
+    bool compressionSupported;
+    QString cacheDirectory;
+    QThreadPool threadPool;
+};
+
+#endif // TEXTURESTREAMER_H
@@ -9,6 +9,7 @@
 #include "unitcube.h"
 
 #include <QMatrix4x4>
+#include <math.h>
 
 
 GLushort UnitCube::indices[] = {0,  1,  2,   // Face 0 - triangle strip ( v0,  v1,  v2,  v3)
@@ -251,6 +252,36 @@ int UnitCube::getNumFaceTriangles()
     return faceList.size();
 }
 
+//------------------------------------------------------------------------------------------
+QVector3D UnitCube::getBoundMin()
+{
+    QVector3D boundMin = vertexList.at(0);
+
+    for(int i = 1; i < vertexList.size(); ++i)
+    {
+        boundMin.setX(fmin(boundMin.x(), vertexList.at(i).x()));
+        boundMin.setY(fmin(boundMin.y(), vertexList.at(i).y()));
+        boundMin.setZ(fmin(boundMin.z(), vertexList.at(i).z()));
+    }
+
+    return boundMin;
+}
+
+//------------------------------------------------------------------------------------------
+QVector3D UnitCube::getBoundMax()
+{
+    QVector3D boundMax = vertexList.at(0);
+
+    for(int i = 1; i < vertexList.size(); ++i)
+    {
+        boundMax.setX(fmax(boundMax.x(), vertexList.at(i).x()));
+        boundMax.setY(fmax(boundMax.y(), vertexList.at(i).y()));
+        boundMax.setZ(fmax(boundMax.z(), vertexList.at(i).z()));
+    }
+
+    return boundMax;
+}
+
 //------------------------------------------------------------------------------------------
 GLfloat* UnitCube::getVertices()
 {
@@ -362,6 +393,15 @@ UnitCube::CubeFaceTriangle UnitCube::getFace(int _faceIndex)
     return faceList.at(_faceIndex);
 }
 
+//------------------------------------------------------------------------------------------
+// the 6 faces, outward facing
+//------------------------------------------------------------------------------------------
+QVector<PlanarPatch> UnitCube::getPlanarPatches()
+{
+    return PlanarPatchExtractor::extractPatches(getVertices(), indices, getNumIndices(),
+                                                0.0f, 6);
+}
+
 //------------------------------------------------------------------------------------------
 void UnitCube::clearData()
 {
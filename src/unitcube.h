@@ -11,6 +11,8 @@
 #include <QVector2D>
 #include <QtGui>
 
+#include "planarpatch.h"
+
 #ifndef UNITCUBE_H
 #define UNITCUBE_H
 
@@ -72,6 +74,8 @@ public:
     int getTexCoordOffset();
     int getIndexOffset();
     int getNumFaceTriangles();
+    QVector3D getBoundMin();
+    QVector3D getBoundMax();
 
 
     GLfloat* getVertices();
@@ -81,6 +85,7 @@ public:
     GLfloat* getTexureCoordinates(float _scale);
     GLushort* getIndices();
     CubeFaceTriangle getFace(int _faceIndex);
+    QVector<PlanarPatch> getPlanarPatches();
 
 
 private:
@@ -6,6 +6,7 @@
 //
 //------------------------------------------------------------------------------------------
 #include <QMatrix4x4>
+#include <math.h>
 
 #include "unitplane.h"
 
@@ -86,6 +87,36 @@ int UnitPlane::getIndexOffset()
     return sizeof(indices);
 }
 
+//------------------------------------------------------------------------------------------
+QVector3D UnitPlane::getBoundMin()
+{
+    QVector3D boundMin = vertexList.at(0);
+
+    for(int i = 1; i < vertexList.size(); ++i)
+    {
+        boundMin.setX(fmin(boundMin.x(), vertexList.at(i).x()));
+        boundMin.setY(fmin(boundMin.y(), vertexList.at(i).y()));
+        boundMin.setZ(fmin(boundMin.z(), vertexList.at(i).z()));
+    }
+
+    return boundMin;
+}
+
+//------------------------------------------------------------------------------------------
+QVector3D UnitPlane::getBoundMax()
+{
+    QVector3D boundMax = vertexList.at(0);
+
+    for(int i = 1; i < vertexList.size(); ++i)
+    {
+        boundMax.setX(fmax(boundMax.x(), vertexList.at(i).x()));
+        boundMax.setY(fmax(boundMax.y(), vertexList.at(i).y()));
+        boundMax.setZ(fmax(boundMax.z(), vertexList.at(i).z()));
+    }
+
+    return boundMax;
+}
+
 //------------------------------------------------------------------------------------------
 GLfloat* UnitPlane::getVertices()
 {
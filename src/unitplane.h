@@ -25,6 +25,8 @@ public:
     int getVertexOffset();
     int getTexCoordOffset();
     int getIndexOffset();
+    QVector3D getBoundMin();
+    QVector3D getBoundMax();
 
 
     GLfloat* getVertices();
@@ -62,20 +62,21 @@ void UnitSphere::generateSphere(int _numStacks, int _numSlices)
         }
     }
 
-    for (int j = -_numStacks; j <= _numStacks; ++j)
+    // triangles are counter-clockwise seen from outside
+    for (int j = 0; j < _numStacks; ++j)
     {
-        for (int i = 0; i <= _numSlices; ++i)
+        for (int i = 0; i < _numSlices; ++i)
         {
             int first = (j * (_numSlices + 1)) + i;
             int second = first + _numSlices + 1;
 
             indicesList.append(first);
-            indicesList.append(second);
             indicesList.append(first + 1);
+            indicesList.append(second);
 
             indicesList.append(second);
-            indicesList.append(second + 1);
             indicesList.append(first + 1);
+            indicesList.append(second + 1);
         }
     }
 